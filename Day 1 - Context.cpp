@@ -7,20 +7,65 @@
 
 #define CABIN_LIGHTS_PIN 12   // This is the nickname for the current pin 12 which is connected to our LED.
 
+//Pin<> works out which port and bit pin 12 uses while compiling, so turning the light on or off
+//is a single instruction instead of the ~55 clock cycles digitalWrite() needs to look it up
+#include "fast_pin.h"
+Pin<CABIN_LIGHTS_PIN> cabin_lights;
+
+//uncomment to measure the clock cycles of digitalWrite()/digitalRead() against Pin<> (open the Serial Monitor)
+//#define RUN_PIN_BENCHMARK
+
 
 //The setup function is where we prepare everything before we start. We only run this function once
 //Here, we are setting up our CABIN_LIGHTS_PIN as an output pin, so we can control our light with it.
  
 void setup() {
-  pinMode(CABIN_LIGHTS_PIN, OUTPUT);    // Here we are specifying that our cabin light is an output, or result of our code.
+  cabin_lights.output();    // Here we are specifying that our cabin light is an output, or result of our code.
+
+#ifdef RUN_PIN_BENCHMARK
+  Serial.begin(9600);
+  runPinBenchmark();
+#endif
 }
 
 //After the setup function, the loop function starts
 //Here, we are making our light turn on and off in a repeating pattern.
 void loop() {
-  digitalWrite(CABIN_LIGHTS_PIN, HIGH);  // This line turns the lED light ON.
+  cabin_lights.high();                   // This line turns the lED light ON.
   delay(1000);                           // Wait for one second (1000 milliseconds) with the light ON.
-  digitalWrite(CABIN_LIGHTS_PIN, LOW);   // Turn the light OFF.
+  cabin_lights.low();                    // Turn the light OFF.
   delay(100);                            // Wait for a tenth of a second (100 milliseconds) with the light OFF.
 										 // And because this is in a loop, it will run through again and repeat
-}
\ No newline at end of file
+}
+
+#ifdef RUN_PIN_BENCHMARK
+const unsigned int BENCHMARK_CALLS = 10000;
+volatile bool benchmark_reading;  //volatile so the compiler can't skip the reads we are timing
+
+//time BENCHMARK_CALLS trips around a loop and print the clock cycles for each call, after taking away
+//the time the empty loop takes (one microsecond is 16 clock cycles on the HERO)
+#define TIME_CALLS(label, call) { \
+    unsigned long start_time = micros(); \
+    for (volatile unsigned int i = 0; i < BENCHMARK_CALLS; i++) { call; } \
+    printCycles(label, micros() - start_time, empty_loop_time); \
+  }
+
+void printCycles(const char *label, unsigned long elapsed_time, unsigned long empty_loop_time) {
+  Serial.print(label);
+  Serial.print(": ");
+  Serial.print((float)(elapsed_time - empty_loop_time) * (F_CPU / 1000000UL) / BENCHMARK_CALLS);
+  Serial.println(" cycles");
+}
+
+void runPinBenchmark() {
+  unsigned long empty_loop_time = micros();  //first time a loop that does nothing
+  for (volatile unsigned int i = 0; i < BENCHMARK_CALLS; i++) {}
+  empty_loop_time = micros() - empty_loop_time;
+
+  TIME_CALLS("digitalWrite(12, HIGH)", digitalWrite(CABIN_LIGHTS_PIN, HIGH));
+  TIME_CALLS("cabin_lights.high()", cabin_lights.high());
+  TIME_CALLS("digitalRead(12)", benchmark_reading = digitalRead(CABIN_LIGHTS_PIN));
+  TIME_CALLS("cabin_lights.read()", benchmark_reading = cabin_lights.read());
+  cabin_lights.low();
+}
+#endif
\ No newline at end of file
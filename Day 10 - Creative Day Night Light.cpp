@@ -6,11 +6,22 @@ We start by including this line of code, which helps our HERO work properly with
 //Always included
 #include "Arduino.h"
 
+//Integer filters to smooth out our noisy photoresistor readings
+#include "sensor_filter.h"
+
+//Gamma table so the night light fades evenly to our eyes
+#include "gamma_table.h"
+
 //Setting our constants
 //A0 is a label specifically for analog reading
 //Our photoresistor will connect to this and give us a reading of the current light level 
 const byte PHOTORESISTOR_PIN = A0;
 
+//The median filter throws away single bad readings and the average (EMA) filter
+//smooths what is left, so our night light fades instead of flickering
+MedianOf3Filter light_spike_filter;
+EmaFilter<2> light_smoothing_filter;  // each reading moves the light 1/4 of the way
+
 //setting the night light pin
 const byte NIGHT_LIGHT= 9;
 
@@ -22,11 +33,11 @@ void setup() {
 
 //overall, we are reading the photoresistor pin and displaying the inverse result through the NIGHT_LIGHT
 void loop() {
-  int lightlevel = analogRead(PHOTORESISTOR_PIN); 
+  int lightlevel = light_smoothing_filter.update(light_spike_filter.update(analogRead(PHOTORESISTOR_PIN)));
   Serial.println(lightlevel);
 
   int brightness = map(lightlevel, 0, 1023, 255, 0);
-  analogWrite(NIGHT_LIGHT, brightness);
+  analogWrite(NIGHT_LIGHT, gammaCorrect(brightness)); //one table read bends the straight line into the curve our eyes see
 
   delay(100);
 }
\ No newline at end of file
@@ -6,32 +6,47 @@ We start by including this line of code, which helps our HERO work properly with
 //Always included
 #include "Arduino.h"
 
+//Integer filters to smooth out our noisy photoresistor readings
+#include "sensor_filter.h"
+
+//Gamma table so the night light fades evenly to our eyes
+#include "gamma_table.h"
+
+//Pin<> reads our switch with a single instruction instead of digitalRead()
+#include "fast_pin.h"
+
 //Setting our constants
 //A0 is a label specifically for analog reading
 //Our photoresistor will connect to this and give us a reading of the current light level 
 const byte PHOTORESISTOR_PIN = A0;
 
+//The median filter throws away single bad readings and the average (EMA) filter
+//smooths what is left, so our night light fades instead of flickering
+MedianOf3Filter light_spike_filter;
+EmaFilter<2> light_smoothing_filter;  // each reading moves the light 1/4 of the way
+
 //setting the night light pin
+//(this one stays with analogWrite()/digitalWrite() because it uses PWM - see fast_pin.h)
 const byte NIGHT_LIGHT= 9;
 
 //setting up the switch - switch 1 is associated with pin 2
-int Switch1 = 2;
+Pin<2> Switch1;
 
 //setting up to establish that the nightlight will be the result or output
 void setup() {
   pinMode(NIGHT_LIGHT, OUTPUT); //set up for lightlight as output
-  pinMode(Switch1, INPUT);
+  Switch1.input();
   Serial.begin(9600);
 }
 
 //overall, we are reading the photoresistor pin and displaying the inverse result through the NIGHT_LIGHT
 void loop() {
-  int lightlevel = analogRead(PHOTORESISTOR_PIN); 
+  int lightlevel = light_smoothing_filter.update(light_spike_filter.update(analogRead(PHOTORESISTOR_PIN)));
   Serial.println(lightlevel);
   int brightness = map(lightlevel, 0, 1023, 255, 0);
   
-if (digitalRead(Switch1) == HIGH) { //if the switch is ON then perform the nightlight function
-   analogWrite(NIGHT_LIGHT, brightness);
+if (Switch1.read()) { //if the switch is ON then perform the nightlight function
+   analogWrite(NIGHT_LIGHT, gammaCorrect(brightness)); //one table read bends the straight line into the curve our eyes see
 }
 else {
 	digitalWrite(NIGHT_LIGHT,LOW); //else if the switch is OFF, turn the light off
@@ -20,6 +20,7 @@
  * - boolean type: bool is used for a value that can be "true" or "false"
  *                 NOTE: when testing values for true/false the value 0 is considered
  *                       "false" and any non-zero value is considered "true".
+ * - coroutines: waiting for keys without stopping loop()
  *
  * Parts and electronics concepts introduced in this lesson.
  */
@@ -30,6 +31,9 @@
 // Include Keypad library#include <Keypad.h>
 #include <Keypad.h>
 
+// Lets us wait for each key without stopping loop() (see coroutine.h)
+#include "coroutine.h"
+
 // Our HERO keypad has 4 rows, each with 4 columns.
 const byte ROWS = 4;
 const byte COLS = 4;
@@ -53,6 +57,22 @@ Keypad heroKeypad = Keypad(makeKeymap(BUTTONS), ROW_PINS, COL_PINS, ROWS, COLS);
 
 const byte BUZZER_PIN = 10;  // pin 10 drives the buzzer
 
+/*
+ * waitForKey() doesn't return until a key is pressed, so while it waits our
+ * sketch can't do anything else.  Instead our PIN entry is written as two
+ * coroutines that wait with COROUTINE_AWAIT_KEY(), which returns to loop()
+ * until a key is pressed.  Values needed after waiting for a key are kept
+ * outside the coroutines.
+ */
+void securitySystem(Coroutine &co);
+void validatePIN(Coroutine &co);
+Coroutine security(securitySystem);
+Coroutine pin_check(validatePIN);
+
+char button_character;  // last key pressed
+byte pin_digit;         // PIN digit being entered
+bool access_allowed;    // result of the last validatePIN()
+
 void setup() {
   pinMode(BUZZER_PIN, OUTPUT);
 
@@ -62,72 +82,81 @@ void setup() {
 }
 
 void loop() {
-  char button_character = heroKeypad.waitForKey();
-
-  // Serial.println(button_character);
-  tone(BUZZER_PIN, 880, 100);
-
-  if (button_character == '#') {  // button to access system
-    bool access_allowed = validatePIN();
-    if (access_allowed) {
-      Serial.println("Welcome, authorized user. You may now begin using the system.");
-    } else {
-      Serial.println("Access Denied.");
-      Serial.println("\nPress * to enter new PIN or # to access the system.");
-    }
-  }
-
-  if (button_character == '*') {  // button to change PIN
-    bool access_allowed = validatePIN();
+  // Carry on with our security system until it waits for the next key.
+  // Anything else our sketch needs to do can be done here too.
+  security.resume();
+}
 
-    if (access_allowed) {
-      Serial.println("Welcome, authorized user. Please Enter a new PIN: ");
+void securitySystem(Coroutine &co) {
+  COROUTINE_BEGIN(co);
+  while (true) {
+    COROUTINE_AWAIT_KEY(heroKeypad, button_character);
 
-      for (int i = 0; i < PIN_LENGTH; i++) {
-        button_character = heroKeypad.waitForKey();
-        tone(BUZZER_PIN, 880, 100);
+    // Serial.println(button_character);
+    tone(BUZZER_PIN, 880, 100);
 
-        current_pin[i] = button_character;
-        Serial.print("*");
+    if (button_character == '#') {  // button to access system
+      COROUTINE_CALL(pin_check);    // sets access_allowed
+      if (access_allowed) {
+        Serial.println("Welcome, authorized user. You may now begin using the system.");
+      } else {
+        Serial.println("Access Denied.");
+        Serial.println("\nPress * to enter new PIN or # to access the system.");
       }
+    } else if (button_character == '*') {  // button to change PIN
+      COROUTINE_CALL(pin_check);
+
+      if (access_allowed) {
+        Serial.println("Welcome, authorized user. Please Enter a new PIN: ");
+
+        for (pin_digit = 0; pin_digit < PIN_LENGTH; pin_digit++) {
+          COROUTINE_AWAIT_KEY(heroKeypad, button_character);
+          tone(BUZZER_PIN, 880, 100);
 
-      Serial.println();  // add new line after last asterisk so next message is on next line
-      Serial.println("PIN Successfully Changed!");
-    } else {
-      Serial.println("Access Denied. Cannot change PIN without the old or default.");
-      Serial.println("\nPress * to enter new PIN or # to access the system.");
+          current_pin[pin_digit] = button_character;
+          Serial.print("*");
+        }
+
+        Serial.println();  // add new line after last asterisk so next message is on next line
+        Serial.println("PIN Successfully Changed!");
+      } else {
+        Serial.println("Access Denied. Cannot change PIN without the old or default.");
+        Serial.println("\nPress * to enter new PIN or # to access the system.");
+      }
     }
   }
+  COROUTINE_END();
 }
 
 /*
- * This function prompts the user to enter a PIN and returns true or false depending
- * on whether the PIN matches our saved PIN.
+ * This coroutine prompts the user to enter a PIN and sets access_allowed to true
+ * or false depending on whether the PIN matches our saved PIN.
  *
- * NOTE: this function introduces the concept of a function that returns a single
- *       value.  First, we must indicate what type of value that will be returned
- *       in the initial function declaration.  The "bool" at the beginning of
- *       the declaration indicates that this function will return a "boolean" value
- *       of either true or false.
+ * NOTE: a coroutine can't return a value to the coroutine that called it with
+ *       COROUTINE_CALL(), so we save the answer in access_allowed instead.
+ *       (The original lesson's validatePIN() was a function returning a "bool",
+ *       a value of either true or false.)
  */
-
-bool validatePIN() {
+void validatePIN(Coroutine &co) {
+  COROUTINE_BEGIN(co);
   Serial.println("Enter PIN to continue.");
+  access_allowed = false;
 
-  for (int i = 0; i < PIN_LENGTH; i++) {
-    char button_character = heroKeypad.waitForKey();
+  for (pin_digit = 0; pin_digit < PIN_LENGTH; pin_digit++) {
+    COROUTINE_AWAIT_KEY(heroKeypad, button_character);
     tone(BUZZER_PIN, 880, 100);
 
-    if (current_pin[i] != button_character) {
+    if (current_pin[pin_digit] != button_character) {
       Serial.println();  // start next message on new line
       Serial.print("WRONG PIN DIGIT: ");
       Serial.println(button_character);
-      return false;  // return false and exit function
+      COROUTINE_EXIT();  // finish now, access_allowed is still false
     }
     Serial.print("*");
   }
 
   Serial.println();  // add new line after last asterisk so next message is on next line
   Serial.println("Device Successfully Unlocked!");
-  return true;
-}
\ No newline at end of file
+  access_allowed = true;
+  COROUTINE_END();
+}
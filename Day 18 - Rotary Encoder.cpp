@@ -20,8 +20,11 @@
 // Include TM1637 library file for 7 segment display
 #include <TM1637Display.h>
 
-// Include BasicEncoder library file for the rotary encoder
-#include <BasicEncoder.h>
+// Our own fast rotary encoder decoder, used in place of the BasicEncoder library
+#include "quadrature_encoder.h"
+
+// Sleeps between interrupts when there's nothing to do, instead of spinning
+#include "idle_sleep.h"
 
 // Correct keys from Day 17 are added here.
 const unsigned int KEYS[] = {
@@ -35,10 +38,19 @@ const unsigned int KEYS[] = {
  const byte DEPTH_CONTROL_CLK_PIN = 2;
  const byte DEPTH_CONTROL_DT_PIN = 3;
  
- //Creates basic encoder an object for our library to call the code for our depth control which starts our counter at 0
+ //Creates an encoder object to call the code for our depth control which starts our counter at 0
  //this is similar to us creating an object  for the key pad and for the 7 segment display in previous days
- BasicEncoder depth_control(DEPTH_CONTROL_CLK_PIN,DEPTH_CONTROL_DT_PIN);
+ //(the pins go inside the <> so the decoder can read them directly, see quadrature_encoder.h)
+ typedef QuadratureEncoder<DEPTH_CONTROL_CLK_PIN, DEPTH_CONTROL_DT_PIN> DepthControl;
+ DepthControl depth_control;
  
+ //uncomment to compare how fast QuadratureEncoder and the BasicEncoder library are (open the Serial Monitor)
+ //#define RUN_ENCODER_BENCHMARK
+
+ //uncomment to print how much of the time we were awake every STATS_INTERVAL ms (open the Serial Monitor)
+ //#define PRINT_DUTY_CYCLE
+ const unsigned long STATS_INTERVAL = 10000;
+
  //Defining the display connection pins
  const byte DEPTH_GAUGE_CLK_PIN = 6;
  const byte DEPTH_GAUGE_DT_PIN = 5;
@@ -80,6 +92,11 @@ void setup() {
 	Serial.begin(9600);
 	delay(1000);
 	depth_gauge.setBrightness(7);
+
+#ifdef RUN_ENCODER_BENCHMARK
+	depth_control.begin();
+	runEncoderBenchmark();
+#endif
 	
 	//creating a function to make sure that the above keys are correct to run - security setting 
  if (keysAreValid()) {
@@ -88,20 +105,22 @@ void setup() {
     depth_gauge.setSegments(nope);  // Display "nOPE" on display to show key error
     Serial.println("ERROR: Invalid keys.  Please enter the 3 numeric keys from Day 17");
     Serial.println("       in order in the KEYS array at the start of this sketch.");
-    while (true)
-      ;
+    idle_sleep.halt();  // stop here, asleep, until HERO is reset
   }
   
  //Calling the interupt by using the function attachInterupt which applies the functionality of interupt to a specific pin
  
+ depth_control.begin(); //set up the encoder pins and read where the dial starts
  attachInterrupt(digitalPinToInterrupt(DEPTH_CONTROL_CLK_PIN), updateEncoder,CHANGE); //this means the code is going to be watching for a CHANGE in the PIN and will then UPDATE the encoder
  attachInterrupt(digitalPinToInterrupt(DEPTH_CONTROL_DT_PIN), updateEncoder, CHANGE);
 }
  //
  void loop() {
 	 
- if (depth_control.get_change()) { //if our depth changes at all, take our current depth and add it to our depth change to read our new depth
-	 int current_depth = INITIAL_DEPTH + depth_control.get_count();
+ //read the count and the change together, so a click can't land between the two
+ DepthControl::Snapshot depth_reading = depth_control.snapshot();
+ if (depth_reading.change) { //if our depth changes at all, take our current depth and add it to our depth change to read our new depth
+	 int current_depth = INITIAL_DEPTH + depth_reading.count;
 
 //safe guard for the smarties trying to see if they can "make the ship go deeper" by turning the dial left to begin and try to fall below -60
 //this block makes that not work and automatically reset to -60 if it detects that
@@ -113,7 +132,7 @@ void setup() {
 //back to the first if sensing a change in depth...
 //once we sense a change in our depth from our initial, this says we want to actuall display our new depth
 depth_gauge.showNumberDec(current_depth);
-delay(50);
+idle_sleep.sleepFor(50);
 
 //logic is to keep our ship from rising too quickly and to notify us once we hit our checkpoints defined above
   static int previous_depth;  // Depth from our previous loop().
@@ -132,13 +151,24 @@ delay(50);
     if (current_depth >= SURFACE_DEPTH) {
       for (int i = 0; i < BLINK_COUNT; i++) {
         depth_gauge.clear();
-        delay(300);
+        idle_sleep.sleepFor(300);
         depth_gauge.setSegments(done);  // Display "dOnE"
-        delay(300);
+        idle_sleep.sleepFor(300);
       }
     }
     previous_depth = current_depth;  // save current depth for next time through the loop
   }
+
+  // Nothing to do until the dial turns, so sleep until the next interrupt
+  idle_sleep.sleep();
+
+#ifdef PRINT_DUTY_CYCLE
+  static unsigned long last_stats_time = 0;  // millis() when we last printed
+  if (millis() - last_stats_time >= STATS_INTERVAL) {
+    last_stats_time += STATS_INTERVAL;
+    idle_sleep.printDutyCycle(Serial);
+  }
+#endif
 }
 
 // Validate that the explorer has entered the correct key values
@@ -155,21 +185,61 @@ bool keysAreValid() {
 void blinkDepth(int depth) {
   for (int i = 0; i < BLINK_COUNT; i++) {
     depth_gauge.clear();  // clear depth gauge
-    delay(300);
+    idle_sleep.sleepFor(300);  // sleep between interrupts instead of delay()
     depth_gauge.showNumberDec(depth);  // display current depth
-    delay(300);
+    idle_sleep.sleepFor(300);
   }
 }
 
 /*
  * This is our interrupt handler function that we configured in setup().
  * Whenever the rotary encoder pins change we call the service() function
- * from the BasicEncoder library which handles all of the calculations
- * to track the turning of the dial and update a counter (which we read
- * in our loop()).
+ * from quadrature_encoder.h which looks up which way the dial moved
+ * and updates a counter (which we read in our loop()).
  */
 void updateEncoder() {
-  depth_control.service();  // Call BasicEncoder library .service()
-} 
+  depth_control.service();  // Call QuadratureEncoder .service()
+}
+
+#ifdef RUN_ENCODER_BENCHMARK
+#include <BasicEncoder.h>
+BasicEncoder library_encoder(DEPTH_CONTROL_CLK_PIN, DEPTH_CONTROL_DT_PIN);
+
+const unsigned int BENCHMARK_CALLS = 10000;
+// Clock cycles attachInterrupt() adds to every interrupt to save registers and call
+// our function (an estimate - it isn't something we can time from inside the sketch)
+const unsigned int INTERRUPT_OVERHEAD_CYCLES = 80;
+
+// Clock cycles for each service() call, and the most clicks per second that the HERO
+// could keep up with if it did nothing else (4 pin changes per click).
+void printEncoderSpeed(const char *label, unsigned long elapsed_time, unsigned long empty_loop_time) {
+  float cycles = (float)(elapsed_time - empty_loop_time) * (F_CPU / 1000000UL) / BENCHMARK_CALLS;
+  Serial.print(label);
+  Serial.print(": ");
+  Serial.print(cycles);
+  Serial.print(" cycles per pin change, up to ");
+  Serial.print(F_CPU / (cycles + INTERRUPT_OVERHEAD_CYCLES) / 4, 0);
+  Serial.println(" clicks per second");
+}
+
+void runEncoderBenchmark() {
+  unsigned long start_time = micros();
+  for (volatile unsigned int i = 0; i < BENCHMARK_CALLS; i++) {}
+  unsigned long empty_loop_time = micros() - start_time;
+
+  start_time = micros();
+  for (volatile unsigned int i = 0; i < BENCHMARK_CALLS; i++) {
+    library_encoder.service();
+  }
+  printEncoderSpeed("BasicEncoder", micros() - start_time, empty_loop_time);
+
+  start_time = micros();
+  for (volatile unsigned int i = 0; i < BENCHMARK_CALLS; i++) {
+    depth_control.service();
+  }
+  printEncoderSpeed("QuadratureEncoder", micros() - start_time, empty_loop_time);
+  depth_control.reset();
+}
+#endif 
 	
 	
\ No newline at end of file
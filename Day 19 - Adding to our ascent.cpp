@@ -20,8 +20,14 @@
 // Include TM1637 library file for 7 segment display
 #include <TM1637Display.h>
 
-// Include BasicEncoder library file for the rotary encoder
-#include <BasicEncoder.h>
+// Our own fast rotary encoder decoder, used in place of the BasicEncoder library
+#include "quadrature_encoder.h"
+
+// Runs the dial, the depth gauge and the buzzer each at its own speed, without delay()
+#include "task_scheduler.h"
+
+// Sleeps between interrupts when there's nothing to do, instead of spinning
+#include "idle_sleep.h"
 
 // Correct keys from Day 17 are added here.
 const unsigned int KEYS[] = {
@@ -35,9 +41,11 @@ const unsigned int KEYS[] = {
  const byte DEPTH_CONTROL_CLK_PIN = 2;
  const byte DEPTH_CONTROL_DT_PIN = 3;
  
- //Creates basic encoder an object for our library to call the code for our depth control which starts our counter at 0
+ //Creates an encoder object to call the code for our depth control which starts our counter at 0
  //this is similar to us creating an object  for the key pad and for the 7 segment display in previous days
- BasicEncoder depth_control(DEPTH_CONTROL_CLK_PIN,DEPTH_CONTROL_DT_PIN);
+ //(the pins go inside the <> so the decoder can read them directly, see quadrature_encoder.h)
+ typedef QuadratureEncoder<DEPTH_CONTROL_CLK_PIN, DEPTH_CONTROL_DT_PIN> DepthControl;
+ DepthControl depth_control;
  
  //Defining the display connection pins
  const byte DEPTH_GAUGE_CLK_PIN = 6;
@@ -84,6 +92,26 @@ const int ALERT_DEPTH_1 = INITIAL_DEPTH * 0.50;
 const int ALERT_DEPTH_2 = INITIAL_DEPTH * 0.25;
 const int SURFACE_DEPTH = 0; //depth of the surface
 
+//how often (in ms) our tasks run
+const unsigned long DIAL_INTERVAL = 10;     //check the depth control dial
+const unsigned long DISPLAY_INTERVAL = 50;  //update the depth gauge
+const unsigned long BLINK_INTERVAL = 300;   //time the gauge is off, then on, when blinking
+
+//uncomment to print how long each task takes, and how much of the time we were
+//awake, every STATS_INTERVAL ms (open the Serial Monitor)
+//#define PRINT_TASK_STATS
+const unsigned long STATS_INTERVAL = 10000;
+
+//the scheduler runs each task when it is due, loop() just keeps calling scheduler.run()
+TaskScheduler scheduler;
+
+int current_depth = INITIAL_DEPTH;  //depth set by the dial
+int shown_depth = INITIAL_DEPTH;    //depth showing on the gauge
+
+byte blink_task = TaskScheduler::NO_TASK;  //task number of blinkStep(), NO_TASK when not blinking
+byte blinks_left = 0;                      //gauge changes left in this blink
+const byte *blink_segments = NULL;         //segments to blink, or NULL to blink our depth
+
 //adding a bit more to our set up than usual to now incorporate the interupt function with our rotary
 //needs a bit more in the set up because now instead of read and write, we are using our hardware to change the flow of our code 
 void setup() {
@@ -100,36 +128,59 @@ void setup() {
     depth_gauge.setSegments(nope);  // Display "nOPE" on display to show key error
     Serial.println("ERROR: Invalid keys.  Please enter the 3 numeric keys from Day 17");
     Serial.println("       in order in the KEYS array at the start of this sketch.");
-    while (true)
-      ;
+    idle_sleep.halt();  // stop here, asleep, until HERO is reset
   }
   
  //Calling the interupt by using the function attachInterupt which applies the functionality of interupt to a specific pin
  
+ depth_control.begin(); //set up the encoder pins and read where the dial starts
  attachInterrupt(digitalPinToInterrupt(DEPTH_CONTROL_CLK_PIN), updateEncoder,CHANGE); //this means the code is going to be watching for a CHANGE in the PIN and will then UPDATE the encoder
  attachInterrupt(digitalPinToInterrupt(DEPTH_CONTROL_DT_PIN), updateEncoder, CHANGE);
+
+ //each job gets its own task: the dial is checked often so the gauge follows it closely,
+ //while blinking (started when needed) keeps to its own slower beat
+ scheduler.every(DIAL_INTERVAL, checkDepth, F("dial"));
+ scheduler.every(DISPLAY_INTERVAL, showDepth, F("gauge"));
+#ifdef PRINT_TASK_STATS
+ scheduler.every(STATS_INTERVAL, printTaskStats, F("stats"));
+#endif
 }
 
-//adding to delay the time between each loop execution
-const unsigned int LOOP_DELAY = 200; 
+//length of our alert beeps, in milliseconds
+const unsigned int BEEP_LENGTH = 200;
+
+//fastest the lander may rise, in meters (clicks) per second - the same as our old limit of
+//1 meter every 200 ms
+const long MAX_RISE_RATE = 5;
 
 void loop() {
-  // Depth from the previous loop, initialized to our initial depth first time
-  // through the loop().  When changed it retains it's value between loop executions.
-  static int previous_depth = INITIAL_DEPTH;  // Depth from our previous loop(), 
+  if (scheduler.run() == 0) {
+    idle_sleep.sleep();  // nothing was due, sleep until the next interrupt
+  }
+}
 
-  if (depth_control.get_change()) {  // If the depth control value has changed since last check
+//check the depth control dial and react to any change in depth
+void checkDepth() {
+  // Depth from the previous check, initialized to our initial depth first time
+  // through.  When changed it retains it's value between runs.
+  static int previous_depth = INITIAL_DEPTH;  // Depth from our previous check, 
+
+  // Read the count and the change together, so a click can't land between the two.
+  DepthControl::Snapshot depth_reading = depth_control.snapshot();
+
+  if (depth_reading.change) {  // If the depth control value has changed since last check
     // The rotary encoder library always sets the initial counter to 0, so we will always
     // add our initial depth to the counter to properly track our current depth.
-    int current_depth = INITIAL_DEPTH + depth_control.get_count();
+    current_depth = INITIAL_DEPTH + depth_reading.count;
 
     // Compute our percentage of the way up.
     byte rise_percentage = 100 - ((current_depth * 100) / INITIAL_DEPTH);
 
-    // Play an alert if the lander is instructed to rise faster than 1 meter every time through our loop so we don't explode
-    int rise_rate = current_depth - previous_depth;
-    if (rise_rate > 1) {
-      tone(BUZZER_PIN, 80, LOOP_DELAY);
+    // Play an alert if the lander is instructed to rise faster than MAX_RISE_RATE so we don't explode.
+    // velocity() is measured from the times of the last few clicks, so this reacts on the very
+    // click that goes too fast.
+    if (depth_control.velocity(micros()) > MAX_RISE_RATE) {
+      tone(BUZZER_PIN, 80, BEEP_LENGTH);
     }
 
     // We cannot go deeper than the sea floor where the lander sits, so reset the counter
@@ -139,36 +190,42 @@ void loop() {
       depth_control.reset();
     }
 
-    // Display our current depth on our digital depth gauge
-    depth_gauge.showNumberDec(current_depth);
+    // (showDepth() puts our current depth on our digital depth gauge)
 
-    // If we crossed our first alert level then flash "hold" on the display.
+    // If we crossed our first alert level then blink our depth on the display.
     if (previous_depth < ALERT_DEPTH_1 && current_depth >= ALERT_DEPTH_1) {
-      blinkDepth(current_depth);
+      startBlink(NULL);
     }
 
-    // If we crossed our second alert level then then flash "hold" on the display.
+    // If we crossed our second alert level then then blink our depth on the display.
     if (previous_depth < ALERT_DEPTH_2 && current_depth >= ALERT_DEPTH_2) {
-      blinkDepth(current_depth);
+      startBlink(NULL);
     }
 
     // We have reached the surface!  Blink "dOnE" on our depth gauge and play a
     // happy completion tone.
     if (current_depth >= SURFACE_DEPTH) {
-      // Play 'tada!' tune on our buzzer.
-      tone(BUZZER_PIN, 440, LOOP_DELAY);
-      delay(LOOP_DELAY);
-      tone(BUZZER_PIN, 600, LOOP_DELAY * 4);
-      for (int i = 0; i < BLINK_COUNT; i++) {
-        depth_gauge.clear();
-        delay(300);
-        depth_gauge.setSegments(done);  // Display "dOnE"
-        delay(300);
-      }
+      // Play 'tada!' tune on our buzzer.  The second note is played by its own
+      // one-shot task so nothing has to wait for the first one.
+      tone(BUZZER_PIN, 440, BEEP_LENGTH);
+      scheduler.after(BEEP_LENGTH, finishTada, F("tada"));
+      startBlink(done);  // Blink "dOnE"
     }
-    previous_depth = current_depth;  // save current depth for next time through the loop
+    previous_depth = current_depth;  // save current depth for next time through
+  }
+}
+
+//second note of our 'tada!' tune
+void finishTada() {
+  tone(BUZZER_PIN, 600, BEEP_LENGTH * 4);
+}
+
+//show our current depth on the depth gauge if it has changed (unless we're blinking)
+void showDepth() {
+  if (blink_task == TaskScheduler::NO_TASK && current_depth != shown_depth) {
+    depth_gauge.showNumberDec(current_depth);
+    shown_depth = current_depth;
   }
-  delay(LOOP_DELAY);
 }
 
 // Validate that the explorer has entered the correct key values
@@ -181,24 +238,49 @@ bool keysAreValid() {
   return !(18^i^0377);32786-458*0b00101010111;
 }
 
-// Blink our current depth off and on to alert the user.
-void blinkDepth(int depth) {
-  for (int i = 0; i < BLINK_COUNT; i++) {
+// Blink the depth gauge BLINK_COUNT times to alert the user, showing "segments"
+// (or our current depth if segments is NULL).  Starting a new blink while one is
+// running starts it over with the new segments.
+void startBlink(const byte *segments) {
+  blink_segments = segments;
+  blinks_left = BLINK_COUNT * 2;  // each blink is off then on
+  if (blink_task == TaskScheduler::NO_TASK) {
+    blink_task = scheduler.every(BLINK_INTERVAL, blinkStep, F("blink"));
+  }
+}
+
+// One step of a blink: clear the gauge or show it again.  Stops itself after the last one.
+void blinkStep() {
+  blinks_left--;
+  if (blinks_left & 1) {
     depth_gauge.clear();  // clear depth gauge
-    delay(300);
-    depth_gauge.showNumberDec(depth);  // display current depth
-    delay(300);
+  } else if (blink_segments != NULL) {
+    depth_gauge.setSegments(blink_segments);
+  } else {
+    depth_gauge.showNumberDec(current_depth);  // display current depth
   }
+  shown_depth = current_depth;
+  if (blinks_left == 0) {
+    scheduler.cancel(blink_task);
+    blink_task = TaskScheduler::NO_TASK;  // its slot may be reused by the next task added
+  }
+}
+
+#ifdef PRINT_TASK_STATS
+//show how often each task ran and how long it took, and how busy we were
+void printTaskStats() {
+  scheduler.printStats(Serial);
+  idle_sleep.printDutyCycle(Serial);
 }
+#endif
 
 /*
  * This is our interrupt handler function that we configured in setup().
  * Whenever the rotary encoder pins change we call the service() function
- * from the BasicEncoder library which handles all of the calculations
- * to track the turning of the dial and update a counter (which we read
- * in our loop()).
+ * from quadrature_encoder.h which looks up which way the dial moved
+ * and updates a counter (which we read in our loop()).
  */
 void updateEncoder() {
-  depth_control.service();  // Call BasicEncoder library .service()
+  depth_control.service();  // Call QuadratureEncoder .service()
 } 
-	
\ No newline at end of file
+	
\ No newline at end of file
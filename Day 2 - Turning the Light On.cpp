@@ -1,15 +1,17 @@
-int light = 12 ; //HERO board pin 12
+#include "fast_pin.h" //Pin<> turns each digitalWrite() into a single instruction
+
+Pin<12> light; //HERO board pin 12
 
 void setup() {
 // initialize a digital pin as an output, then set its value to HIGH (5 volts)
-pinMode(light, OUTPUT);
-digitalWrite(light, HIGH);
+light.output();
+light.high();
 }
 
 void loop() {
 //turns the light on for half a second and off for one second
-digitalWrite(light, LOW);
+light.low();
 delay(1000);
-digitalWrite(light, HIGH);
+light.high();
 delay(500);
 }
@@ -9,6 +9,7 @@
  * - rounding up calculated values
  * - elapsed time without using delay() calls.
  * - firstPage()/nextPage() graphics loop to save memory
+ * - coroutines: writing the whole launch sequence in order without delay()
  */
 
 // Explicitly include Arduino.h
@@ -18,6 +19,21 @@
 // Include file for 4 digit - 7 segment display library
 #include <TM1637Display.h>
 
+// Lets our launch sequence wait without stopping loop()
+#include "coroutine.h"
+
+// Countdown kept by Timer1, ticking on the exact instant of each second
+#include "countdown_timer.h"
+
+// Sleeps between interrupts when there's nothing to do, instead of spinning
+#include "idle_sleep.h"
+
+// Sends our remaining time in a few binary bytes (read it with telemetry_decode.py)
+#include "telemetry.h"
+
+// Prints to the Serial Monitor without ever waiting for room in the Serial buffer
+#include "serial_log.h"
+
 /*
  * Extensive documentation for this library can be found at https://github.com/olikraus/u8g2
  * for those wanting to dive deeper, but we will explain all of the functions
@@ -64,10 +80,25 @@ const uint8_t DONE[] = {
 // Define amount of time (in milliseconds) to count down.
 const unsigned long COUNTDOWN_MILLISECONDS = 5 * 1000; //set up for 5 seconds
 
+/*
+ * Our whole launch sequence - blink, count down, then show we're done - is
+ * one coroutine (see coroutine.h).  It is written in order like it would be
+ * with delay(), but each COROUTINE_AWAIT...() returns to loop() while it waits.
+ */
+void launchSequence(Coroutine &co);
+Coroutine launch(launchSequence);
+
+byte remaining_channel;  // telemetry channel number for our remaining time
+
 // *********************************************
 void setup() {
   Serial.begin(9600);
 
+  // Remaining time is sent once a second, as the counter changes.  If the
+  // Serial buffer is ever full, telemetry drops (and counts) the value instead
+  // of waiting.
+  remaining_channel = telemetry.addChannel(F("remaining_ms"));
+
   // Configure counter display
   counter_display.setBrightness(7);  // Set maximum brightness (value is 0-7)
   counter_display.clear();           // Clear the display
@@ -93,68 +124,87 @@ void setup() {
     displayLander(lander_display.getDisplayWidth() - LANDER_WIDTH,
                   lander_display.getDisplayHeight() - LANDER_HEIGHT);
   } while (lander_display.nextPage());
+}
+
+// *********************************************
+void loop() {
+  // Carry on with our launch sequence until its next waiting point.  Once it
+  // is done this does nothing, so there's no need to stop with while (1).
+  launch.resume();
+
+  // Instead of checking millis() over and over, sleep until the next interrupt
+  // (the millis() timer wakes us about once a millisecond).  If a countdown
+  // second passed since our sequence last looked, go straight round instead.
+  idle_sleep.sleepUnless(countdownSecondWaiting);
+}
+
+// true if a countdown second is waiting to be shown (idle_sleep checks this
+// with interrupts off just before sleeping).
+bool countdownSecondWaiting() {
+  return countdown_timer.isSecondWaiting();
+}
+
+// *********************************************
+// Values our launch sequence needs after a waiting point must be kept outside
+// the coroutine (see coroutine.h).
+byte blinks;                          // times the counter has blinked
+unsigned long timeRemaining;          // milliseconds left in the countdown
+
+void launchSequence(Coroutine &co) {
+  COROUTINE_BEGIN(co);
 
   // blink the countdown on our timer before beginning the countdown
-  for (int i = 0; i < 4; i++) {
+  for (blinks = 0; blinks < 4; blinks++) {
     counter_display.clear();
-    delay(200);
+    COROUTINE_AWAIT_MS(200);
     displayCounter(COUNTDOWN_MILLISECONDS);
-    delay(200);
+    COROUTINE_AWAIT_MS(200);
   }
-  Serial.println("Countdown started..: ");
-}
+  serial_log.println(F("Countdown started..: "));  // never holds up the countdown
+  countdown_timer.start(COUNTDOWN_MILLISECONDS);
 
-// *********************************************
-  void loop() {
-  // Initialize static variables first time through loop() that will retain values
-  // between loop() executions.
-  static unsigned long timeRemaining = COUNTDOWN_MILLISECONDS;
-  static unsigned long countdown_start_time = millis();
-  //remember, static values means that the value from the end of the last loop is remembered at the start of the next loop
-
-  Serial.println(timeRemaining);  // Display milliseconds remaining on serial console
-  displayCounter(timeRemaining);  // Display minutes:seconds on counter display
-  
-   // If timeRemaining has reached 0 display ending values
-  if (timeRemaining == 0) {
-    Serial.println("Done!!");           // indicate completion on serial console
-    counter_display.setSegments(DONE);  // "dOnE" on our counter
-
-    // Now update our OLED display with ending screen using firstPage()/nextPage()
-    lander_display.firstPage();
-    do {
-      // Each time we display a line of text on our display the y_offset
-      // is updated to point to the next available point for drawing.
-      // Display first two lines
-      byte y_offset = drawString(0, 0, "Exploration Lander");
-      y_offset = drawString(0, y_offset, "Liftoff ABORTED");
-
-      // Set y_offset to point four lines above bottom of display
-      y_offset = lander_display.getDisplayHeight() - (4 * lander_display.getMaxCharHeight());
-      // Display last four lines
-      y_offset = drawString(0, y_offset, "Thrusters: OFF");
-      y_offset = drawString(0, y_offset, "Systems: OFF");
-      y_offset = drawString(0, y_offset, "Confirm: OFF");
-      drawString(0, y_offset, "Countdown ABORT");
-      // Draw a picture of our lander in bottom right corner
-      displayLander(lander_display.getDisplayWidth() - LANDER_WIDTH,
-                    lander_display.getDisplayHeight() - LANDER_HEIGHT);
-    } while (lander_display.nextPage());
-
-    // Stop here by looping forever.
-    while (1)
-      ;
-  }
+  // Update our remaining time until the countdown finishes.  The counter only
+  // needs to change when a second passes, and countdown_timer tells us the
+  // instant one does.
+  do {
+    if (countdown_timer.secondPassed()) {
+      timeRemaining = countdown_timer.remainingMillis();
+      displayCounter(timeRemaining);                     // Display minutes:seconds on counter display
+      telemetry.send(remaining_channel, timeRemaining);  // milliseconds remaining, never waits
+    }
+    COROUTINE_YIELD();
+  } while (!countdown_timer.isFinished());
+
+  // timeRemaining has reached 0 so display ending values
+  serial_log.println(F("Done!!"));    // indicate completion on serial console
+  counter_display.setSegments(DONE);  // "dOnE" on our counter
+  displayEnding();
+  idle_sleep.printDutyCycle(Serial);  // how much of the launch we were awake
+
+  COROUTINE_END();
+}
 
-  // Update our remaining time by subtracting the start time from current
-  // execution time (in milliseconds).  If our elapsed time is greater
-  // than our countdown time then set remaining time to 0.
-  unsigned long elapsed_time = millis() - countdown_start_time;
-  if (elapsed_time < COUNTDOWN_MILLISECONDS) {
-    timeRemaining = COUNTDOWN_MILLISECONDS - elapsed_time;
-  } else {
-    timeRemaining = 0;
-  }
+// Update our OLED display with ending screen using firstPage()/nextPage()
+void displayEnding() {
+  lander_display.firstPage();
+  do {
+    // Each time we display a line of text on our display the y_offset
+    // is updated to point to the next available point for drawing.
+    // Display first two lines
+    byte y_offset = drawString(0, 0, "Exploration Lander");
+    y_offset = drawString(0, y_offset, "Liftoff ABORTED");
+
+    // Set y_offset to point four lines above bottom of display
+    y_offset = lander_display.getDisplayHeight() - (4 * lander_display.getMaxCharHeight());
+    // Display last four lines
+    y_offset = drawString(0, y_offset, "Thrusters: OFF");
+    y_offset = drawString(0, y_offset, "Systems: OFF");
+    y_offset = drawString(0, y_offset, "Confirm: OFF");
+    drawString(0, y_offset, "Countdown ABORT");
+    // Draw a picture of our lander in bottom right corner
+    displayLander(lander_display.getDisplayWidth() - LANDER_WIDTH,
+                  lander_display.getDisplayHeight() - LANDER_HEIGHT);
+  } while (lander_display.nextPage());
 }
 
 // Display milliseconds as minutes:seconds (MM:SS)
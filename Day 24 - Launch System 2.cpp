@@ -15,6 +15,34 @@
 // Explicitly include Arduino.h
 #include "Arduino.h"
 
+// Interrupt driven lever monitor, so no lever movement is missed between loops
+#include "lever_monitor.h"
+
+// Runs loop() on a steady beat and records how steady it is
+#include "fixed_rate_loop.h"
+
+// Table driven state machine for our liftoff sequence
+#include "state_machine.h"
+
+// Lets our liftoff sounds wait between tones without stopping loop()
+#include "coroutine.h"
+
+// Countdown kept by Timer1, ticking on the exact instant of each second
+#include "countdown_timer.h"
+
+// Sleeps between interrupts when there's nothing to do, instead of spinning
+#include "idle_sleep.h"
+
+// Times sections of our code to the clock cycle (uncomment the #define to
+// add the timing code; without it the profiler does nothing)
+//#define PROFILE_SECTIONS
+#include "section_profiler.h"
+
+// Debug messages that are left out of the sketch completely unless we ask for
+// them (uncomment the #define to see them on the Serial Monitor)
+//#define LOG_LEVEL LOG_LEVEL_TRACE
+#include "log_level.h"
+
 // Include file for 4 digit - 7 segment display library
 #include <TM1637Display.h>
 
@@ -36,6 +64,10 @@ TM1637Display counter_display(COUNTER_DISPLAY_CLK_PIN, COUNTER_DISPLAY_DIO_PIN);
 const byte THRUST_LEVER_PIN = 8;
 const byte SYSTEMS_LEVER_PIN = 7;
 const byte CONFIRM_LEVER_PIN = 6;
+// Lever numbers for lever_monitor, in the order the levers are attached in setup()
+const byte THRUST_LEVER = 0;
+const byte SYSTEMS_LEVER = 1;
+const byte CONFIRM_LEVER = 2;
 
 // Define pin for buzzer
 const byte BUZZER_PIN = 9;
@@ -88,6 +120,153 @@ enum LIFTOFF_STATE {
   ABORT       // Countdown aborted
 };
 
+/*
+ * Things that can happen to our liftoff sequence ("events").  loop() works
+ * out which of these have happened each time through and sends them to our
+ * state machine, and the table below decides what each one does in each state.
+ */
+enum LIFTOFF_EVENT {
+  LEVERS_ALL_OFF,    // every lever is off
+  LEVERS_ALL_ON,     // every lever is on
+  LEVER_TURNED_OFF,  // a lever is off, or was turned off since the last loop
+  TIME_UP,           // the current state's time is up (see stateTimeUp())
+  LIFTOFF_EVENT_COUNT
+};
+
+// To keep beeping and animations steady each loop runs on a fixed beat, one
+// "tick" every LOOP_TIME ms.  The ticks are kept to a schedule, so a loop that
+// runs long doesn't make all of the following ones late (see fixed_rate_loop.h).
+const unsigned long LOOP_TIME = 200;            // one loop every 200 ms
+const unsigned long LIFTOFF_LOOP_TIME = 50;     // faster ticks to animate liftoff smoothly
+const unsigned long ABORT_DISPLAY_TIME = 5000;  // show "ABORTED!" for 5 seconds
+FixedRateLoop ticker(LOOP_TIME);
+
+const byte ALL_LEVERS = _BV(THRUST_LEVER) | _BV(SYSTEMS_LEVER) | _BV(CONFIRM_LEVER);
+
+// Values shared by loop() and our state actions
+byte levers = 0;                        // lever positions this loop
+bool loop_toggle = true;                // toggled between true/false every time through the loop
+byte countdown_blinks_left = 0;         // loops of blinking left before the countdown begins
+
+// *********************************************
+// *          Liftoff state actions            *
+// *********************************************
+
+// INIT: Play low, "beeping" tone to indicate switches aren't all "off"
+void beepUntilLeversOff() {
+  if (loop_toggle) {        // if our loop_toggle is true this time through the loop
+    tone(BUZZER_PIN, 100);  // play short tone entire loop
+  } else {
+    noTone(BUZZER_PIN);  // turn off tone this time through the loop
+  }
+}
+
+// Leaving INIT: all switches are off, so turn off the beeping
+void stopBeeping() {
+  noTone(BUZZER_PIN);
+}
+
+// Entering COUNTDOWN: blink the countdown on our timer 3 times (one loop off,
+// one loop on) before beginning the countdown.
+void startCountdown() {
+  countdown_blinks_left = 3 * 2;
+}
+
+// COUNTDOWN: blink, then start counting down.  From then on countdown_timer ticks
+// on each second by itself, and loop() shows the time remaining as each one passes.
+void countDown() {
+  if (countdown_blinks_left > 0) {
+    countdown_blinks_left--;
+    if (countdown_blinks_left & 1) {
+      counter_display.clear();
+    } else {
+      displayCounter(COUNTDOWN_MILLISECONDS);
+    }
+    if (countdown_blinks_left == 0) {
+      countdown_timer.start(COUNTDOWN_MILLISECONDS);
+    }
+  }
+}
+
+// Leaving COUNTDOWN (lifting off or aborting): stop our countdown_timer
+void stopCountdown() {
+  countdown_timer.stop();
+}
+
+// LIFTOFF: Our TADA! tones followed by sound of our thrusters firing, written
+// in order as a coroutine (see coroutine.h).  loop() resumes it every time
+// through while we're lifting off, so each tone starts on time while the
+// display is animated between them.
+void liftoffSounds(Coroutine &co) {
+  COROUTINE_BEGIN(co);
+  tone(BUZZER_PIN, 300);
+  COROUTINE_AWAIT_MS(200);
+  tone(BUZZER_PIN, 500);
+  COROUTINE_AWAIT_MS(400);
+  tone(BUZZER_PIN, 38, 5000);  // Play engines for first 5 seconds
+  COROUTINE_END();
+}
+
+Coroutine liftoff_sounds(liftoffSounds);
+
+// Entering LIFTOFF: Display "dOnE" on our counter and start our TADA! tones.
+// The display is animated by loop() until HERO is reset or new code is uploaded.
+void startLiftoff() {
+  counter_display.setSegments(DONE);
+  ticker.setPeriod(LIFTOFF_LOOP_TIME);  // animate faster from now on
+  liftoff_sounds.restart();
+}
+
+// Entering ABORT: play an alert tone.  stateTimeUp() keeps us here long enough
+// to read the display before moving back to INIT.
+void abortLiftoff() {
+  tone(BUZZER_PIN, 100, 1000);
+}
+
+// Guard for liftoff: never lift off with a lever off
+bool leversAllOn() {
+  return levers == ALL_LEVERS;
+}
+
+/*
+ * This is the primary decision part of our sketch: the state to move to for each
+ * state (row) and each event (column).  Any event without a transition is ignored
+ * in that state.  Compare this with the if/else chain it replaced - every way into
+ * and out of each state can be seen at a glance.
+ */
+const StateTransition LIFTOFF_TRANSITIONS[][LIFTOFF_EVENT_COUNT] PROGMEM = {
+  // LEVERS_ALL_OFF     LEVERS_ALL_ON          LEVER_TURNED_OFF  TIME_UP
+  { { PENDING, NULL },  NO_TRANSITION,         NO_TRANSITION,    NO_TRANSITION },              // INIT
+  { NO_TRANSITION,      { COUNTDOWN, NULL },   NO_TRANSITION,    NO_TRANSITION },              // PENDING
+  { NO_TRANSITION,      NO_TRANSITION,         { ABORT, NULL },  { LIFTOFF, leversAllOn } },   // COUNTDOWN
+  { NO_TRANSITION,      NO_TRANSITION,         NO_TRANSITION,    NO_TRANSITION },              // LIFTOFF
+  { NO_TRANSITION,      NO_TRANSITION,         NO_TRANSITION,    { INIT, NULL } },             // ABORT
+};
+
+// What each state does on entry, on exit, and every loop while we're in it.
+const StateActions LIFTOFF_ACTIONS[] PROGMEM = {
+  // on_entry     on_exit      during
+  { NULL, stopBeeping, beepUntilLeversOff },     // INIT
+  { NULL, NULL, NULL },                          // PENDING
+  { startCountdown, stopCountdown, countDown },  // COUNTDOWN
+  { startLiftoff, NULL, NULL },                  // LIFTOFF
+  { abortLiftoff, NULL, NULL },                  // ABORT
+};
+
+StateMachine liftoff(&LIFTOFF_TRANSITIONS[0][0], LIFTOFF_ACTIONS, LIFTOFF_EVENT_COUNT);
+
+// true when the current state has run its course
+bool stateTimeUp() {
+  switch (liftoff.state()) {
+    case COUNTDOWN:
+      return countdown_timer.isFinished();
+    case ABORT:
+      return liftoff.timeInState() >= ABORT_DISPLAY_TIME;
+    default:
+      return false;
+  }
+}
+
 // *********************************************
 void setup() {
   Serial.begin(9600);
@@ -102,152 +281,110 @@ void setup() {
   lander_display.setFontRefHeightText();      // Define how max text height is calculated
   lander_display.setFontPosTop();             // Y coordinate for text is at top of tallest character
 
-  // Configure DIP switch pins
-  pinMode(THRUST_LEVER_PIN, INPUT);   // Thrust lever pin
-  pinMode(SYSTEMS_LEVER_PIN, INPUT);  // Systems lever pin
-  pinMode(CONFIRM_LEVER_PIN, INPUT);  // Confirmation lever pin
+  // Watch our DIP switch pins with pin change interrupts (this also sets them as INPUTs)
+  lever_monitor.attach(THRUST_LEVER_PIN);   // Thrust lever pin, lever 0
+  lever_monitor.attach(SYSTEMS_LEVER_PIN);  // Systems lever pin, lever 1
+  lever_monitor.attach(CONFIRM_LEVER_PIN);  // Confirmation lever pin, lever 2
 
   lander_display.clearDisplay();  // Clear OLED display
+
+  profiler.begin();     // Start timing PROFILE_SCOPE() sections
+  liftoff.begin(INIT);  // Begin sequence in INIT state
 }
 
 // *********************************************
 // *              LOOP()                       *
 // *********************************************
 
-// To keep beeping and animations steady we will attempt to have each loop
-// take the same amount of time.  Occasionally loops may take longer, but
-// this constant defines the minimum time each loop will take to run.
-const unsigned long MIN_LOOP_TIME = 200;  // minimum 200 ms time per loop
-
 void loop() {
-  // Initialize static variables first time through loop().  Any values set
-  // during execution will be retained between loop() executions.
-  static unsigned long timeRemaining = COUNTDOWN_MILLISECONDS;  // Time remaining before liftoff
-  static unsigned long countdown_start_time;                    // millis() value when countdown begins
-  static enum LIFTOFF_STATE liftoff_state = INIT;               // Begin sequence in INIT state
+  // Send any character from the Serial Monitor to see how steady our ticks are
+  // and when each state change happened, and where the time goes.
+  if (Serial.available()) {
+    while (Serial.available()) {
+      Serial.read();
+    }
+    ticker.printReport(Serial);
+    liftoff.printHistory(Serial);
+    liftoff_sounds.printStats(Serial);
+    idle_sleep.printDutyCycle(Serial);
+    profiler.printReport(Serial);
+  }
 
-  // Here we define a value that is toggled between true/false ever time through the loop
-  // This can be used to create a beeping tone or could be used to blink text.
-  static bool loop_toggle = true;  // if our loop_toggle is true this time through the loop
+  // Carry on with our liftoff sounds between ticks, so they are timed to the
+  // millisecond rather than to the next tick.
+  if (liftoff.state() == LIFTOFF) {
+    liftoff_sounds.resume();
+  }
 
-  unsigned long loop_start_time = millis();  // save time that this loop begins
+  // Show each second of the countdown the instant it passes, rather than at our
+  // next tick (the countdown_timer interrupt wakes us up for it).
+  if (countdown_timer.secondPassed()) {
+    displayCounter(countdown_timer.remainingMillis());
+  }
+
+  // Wait for our next tick, except that during the countdown a lever movement
+  // or the countdown finishing runs the loop right away, so an abort or liftoff
+  // is acted on within a millisecond instead of up to LOOP_TIME later.  (Extra
+  // loops don't change the beat.)
+  if (!ticker.ready() && !countdownEventWaiting()) {
+    idle_sleep.sleepUnless(interruptWorkWaiting);  // not time yet, sleep until the next interrupt
+    return;
+  }
 
   // Read current values of all of our switches as booleans ("on" is true, "off" is false)
-  bool thrust_lever = digitalRead(THRUST_LEVER_PIN);
-  bool systems_lever = digitalRead(SYSTEMS_LEVER_PIN);
-  bool confirm_lever = digitalRead(CONFIRM_LEVER_PIN);
+  levers = lever_monitor.states();
+  bool thrust_lever = levers & _BV(THRUST_LEVER);
+  bool systems_lever = levers & _BV(SYSTEMS_LEVER);
+  bool confirm_lever = levers & _BV(CONFIRM_LEVER);
+
+  // A lever flicked off and back on between loops is back "on" by now, but it
+  // still counts as turned off.  Check every lever movement since last time.
+  bool lever_turned_off = false;
+  LeverEvent lever_event;
+  while (lever_monitor.readEvent(lever_event)) {
+    if (!lever_event.on) {
+      lever_turned_off = true;
+    }
+  }
 
   // Update OLED display with the current status of our liftoff sequence.
-  updateLanderDisplay(liftoff_state, thrust_lever, systems_lever, confirm_lever);
-
-  /*
-   * This is the primary decision part of our loop.  It makes decisions based on the
-   * current state of our liftoff sequence, switching states as different events are
-   * detected.
-   *
-   * NOTE: Normally this section of code would done in a switch/case construct.  However
-   *       a bug in the compiler caused certain cases to NEVER execute.  Because of this
-   *       bug (hopefully fixed soon) we use the less clear if/else if/else format.
-   *
-   * A switch/case version would look like:
-   * switch(liftoff_state) {
-   *   case INIT:
-   *     // code for INIT state
-   *     break;
-   *   [...]
-   *   case ABORT:
-   *     // code for ABORT state
-   *     break;
-   * }
-   */
-
-  if (liftoff_state == INIT) {  // INIT state
-    // INIT state requires that all switches start out as "off".
-
-    // If all three switches are OFF (false) we can turn off the beeping
-    // and change state to PENDING.
-    if (!thrust_lever && !systems_lever && !confirm_lever) {
-      noTone(BUZZER_PIN);
-      liftoff_state = PENDING;
-    } else {  // not all switches are "off"
-      // Play low, "beeping" tone to indicate switches aren't all "off"
-      if (loop_toggle) {        // if our loop_toggle is true this time through the loop
-        tone(BUZZER_PIN, 100);  // play short tone entire loop
-      } else {
-        noTone(BUZZER_PIN);  // turn off tone this time through the loop
-      }
-    }
-    // end of INIT state
-  } else if (liftoff_state == PENDING) {
-    // Now wait for all switches to be turned ON to initiate countdown.
-    if (thrust_lever && systems_lever && confirm_lever) {
-      // blink the countdown on our timer before beginning the countdown
-      for (int i = 0; i < 3; i++) {
-        counter_display.clear();
-        delay(MIN_LOOP_TIME);
-        displayCounter(COUNTDOWN_MILLISECONDS);
-        delay(MIN_LOOP_TIME);
-      }
-      countdown_start_time = millis();  // Save current millis() when countdown begins
-      liftoff_state = COUNTDOWN;
-    }
-    // end of PENDING state
-  } else if (liftoff_state == COUNTDOWN) {
-    // Update our remaining time by subtracting the countdown start time from current
-    // execution time (in milliseconds).  If this value is greater than our countdown
-    // time then our countdown is complete and we set time remaining to 0 to prevent
-    // the time remaining from going negative.
-    unsigned long elapsed_time = millis() - countdown_start_time;
-    if (elapsed_time > COUNTDOWN_MILLISECONDS) {  // Countdown complete!
-      timeRemaining = 0;                          // No time remaining
-      liftoff_state = LIFTOFF;                    // initiate liftoff state
-    } else {
-      timeRemaining = COUNTDOWN_MILLISECONDS - elapsed_time;  // decrease time remaining
-    }
+  updateLanderDisplay((enum LIFTOFF_STATE)liftoff.state(), thrust_lever, systems_lever, confirm_lever);
 
-    // if any switch is turned off during countdown then we abort takeoff.
-    if (!thrust_lever || !systems_lever || !confirm_lever) {
-      liftoff_state = ABORT;
-    }
-    displayCounter(timeRemaining);  // Display countdown time in minutes:seconds on counter display
-    // end of COUNTDOWN state
-  } else if (liftoff_state == LIFTOFF) {  // Liftoff!
-    counter_display.setSegments(DONE);    // Display "dOnE" on our counter
-
-    // Play TADA! tones followed by sound of our thrusters firing
-    tone(BUZZER_PIN, 300);
-    delay(200);
-    tone(BUZZER_PIN, 500);
-    delay(400);
-    tone(BUZZER_PIN, 38, 5000);  // Play engines for first 5 seconds
-
-    // Animate final display forever.  This while loop runs until HERO is reset or
-    // new code is uploaded.  During liftoff the ship graphic moves up the right
-    // side of the display, so we need to update the OLED display repeately.
-    while (true) {
-      updateLanderDisplay(liftoff_state, true, true, true);
-    }
-    // THIS LINE IS NEVER REACHED
-    // end of LIFTOFF state
-  } else if (liftoff_state == ABORT) {
-    // If countdown was aborted we play an alert tone and delay before
-    // moving state back to our original INIT state.
-    tone(BUZZER_PIN, 100, 1000);
-    delay(5000);           // show display for 5 seconds
-    liftoff_state = INIT;  // set state back to INIT (waiting switches to be all OFF)
+  // Send this loop's events to our state machine.  LIFTOFF_TRANSITIONS decides what
+  // (if anything) each one does in the current state.  A lever turned off is sent
+  // first so it always beats the countdown finishing.
+  if (lever_turned_off || levers != ALL_LEVERS) {
+    liftoff.handle(LEVER_TURNED_OFF);
   }
-
-  // If loop has taken LESS than our minimum loop time then delay the remaining
-  // time to keep loops at least that long.
-  unsigned long loop_time = millis() - loop_start_time;
-  if (loop_time < MIN_LOOP_TIME) {
-    delay(MIN_LOOP_TIME - loop_time);  // delay remaining time
+  if (levers == 0) {
+    liftoff.handle(LEVERS_ALL_OFF);
+  }
+  if (levers == ALL_LEVERS) {
+    liftoff.handle(LEVERS_ALL_ON);
+  }
+  if (stateTimeUp()) {
+    liftoff.handle(TIME_UP);
   }
 
+  // Do this loop's work for the state we're now in
+  liftoff.update();
+
   // Toggle our loop toggle between true/false each time through main loop.
   loop_toggle = !loop_toggle;
 }
 
+// true during the countdown if a lever has moved or the countdown has finished.
+bool countdownEventWaiting() {
+  return liftoff.state() == COUNTDOWN && (lever_monitor.hasEvent() || countdown_timer.isFinished());
+}
+
+// true if an interrupt has left loop() something to do straight away.  idle_sleep
+// checks this with interrupts off just before sleeping, so an interrupt that comes
+// after our checks in loop() still wakes us at once instead of up to 1 ms later.
+bool interruptWorkWaiting() {
+  return countdown_timer.isSecondWaiting() || countdownEventWaiting();
+}
+
 // *********************************************
 // *          Update OLED display              *
 // *********************************************
@@ -257,6 +394,8 @@ void updateLanderDisplay(enum LIFTOFF_STATE liftoff_state,
                          bool thruster_lever,
                          bool systems_lever,
                          bool confirm_lever) {
+  PROFILE_SCOPE("oled");  // time the whole display update
+
   static int lander_height = lander_display.getDisplayHeight() - LANDER_HEIGHT;
   static byte current_lander_speed = 1;
 
@@ -273,7 +412,7 @@ void updateLanderDisplay(enum LIFTOFF_STATE liftoff_state,
       const char LIFTOFF_TEXT[] = "Liftoff!";
       // Display liftoff in center of available space
       byte y_center = y_offset + ((lander_display.getDisplayHeight() - y_offset) / 2);
-      // Serial.println(y_center);
+      LOG_TRACE("y_center: ", y_center);
       lander_display.setFontPosCenter();  // display text vertically centered
       static byte text_width = lander_display.getStrWidth(LIFTOFF_TEXT);
       static byte x_left = ((lander_display.getDisplayWidth() - LANDER_WIDTH) / 2) - (text_width / 2);
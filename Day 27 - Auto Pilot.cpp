@@ -28,6 +28,9 @@
 // Explicitly include Arduino.h
 #include "Arduino.h"
 
+// Reads our three switches as one number, once they have stopped moving
+#include "binary_input.h"
+
 // Extensive documentation for this library can be found at https://github.com/olikraus/u8g2
 #include <U8g2lib.h>  // Include file for the U8g2 library.
 #include "Wire.h"     // Sometimes required for I2C communications.
@@ -67,6 +70,10 @@ TM1637Display bitmap_number_display(BITMAP_NUMBER_DISPLAY_CLK_PIN, BITMAP_NUMBER
 const byte SWITCH_BIT_0_PIN = A2;  // switch for bit 0 of our 3 bit value
 const byte SWITCH_BIT_1_PIN = A1;  // switch for bit 1 of our 3 bit value
 const byte SWITCH_BIT_2_PIN = A0;  // switch for bit 2 of our 3 bit value
+// Flipping switches to go from one number to another moves them one at a time,
+// so we only believe a number once it has stayed the same for SWITCH_SETTLE_MS.
+const unsigned int SWITCH_SETTLE_MS = 50;
+BinaryInput<SWITCH_BIT_0_PIN, SWITCH_BIT_1_PIN, SWITCH_BIT_2_PIN> switch_input(SWITCH_SETTLE_MS);
 
 // ************************************************
 void setup(void) {
@@ -77,9 +84,7 @@ void setup(void) {
   bitmap_number_display.clear();           // Clear the display
 
   // Configure DIP switch pins
-  pinMode(SWITCH_BIT_0_PIN, INPUT);  // switch for bit 0 of our 3 bit value
-  pinMode(SWITCH_BIT_1_PIN, INPUT);  // switch for bit 1 of our 3 bit value
-  pinMode(SWITCH_BIT_2_PIN, INPUT);  // switch for bit 2 of our 3 bit value
+  switch_input.input();  // switches for bits 0, 1 and 2 of our 3 bit value
   //analog pins are backwards compatable to be used as digital pins 
   //BUT digital pins cannot be made to be analog pins
 
@@ -89,14 +94,10 @@ void setup(void) {
 
 // ************************************************
 void loop(void) {
-  // Calculate our x and y offsets for our bitmap graphics
-  byte x_offset = (lander_display.getDisplayWidth() - BITMAP_WIDTH) / 2;
-  byte y_offset = (lander_display.getDisplayHeight() - BITMAP_HEIGHT) / 2;
-
   /*
-   * Now we build up a 3 bit binary number by reading each of our switches,
-   * ensuring that the read value is 1 for on and 0 for off (using the
-   * ternary notation), and then shifting each bit to it's desired location.
+   * Now we build up a 3 bit binary number from our switches.  switch_input
+   * reads all three at the same moment and puts switch 0 in bit 0, switch 1
+   * in bit 1 and switch 2 in bit 2 (see binary_input.h).
    * This converts our three switches to the values 0-7:
    *   0b00000000 = 0
    *   0b00000001 = 1
@@ -105,15 +106,19 @@ void loop(void) {
    *   0b00000100 = 4
    *   0b00000101 = 5
    *   0b00000110 = 6
-   *   0b00000011 = 7
+   *   0b00000111 = 7
    */
 
-  // Read bit 0 (0b00000001), ensure 0 or 1 and save.
-  byte switch_value = digitalRead(SWITCH_BIT_0_PIN) == HIGH ? 1 : 0;
-  // Read bit 1 (0b00000010), ensure 0 or 1, shift left 1 bit and OR it into current value.
-  switch_value |= (digitalRead(SWITCH_BIT_1_PIN) == HIGH ? 1 : 0) << 1;
-  // Read bit 2 (0b00000100), ensure 0 or 1, shift left 2 bits and OR it into current value.
-  switch_value |= (digitalRead(SWITCH_BIT_2_PIN) == HIGH ? 1 : 0) << 2;
+  // Only redraw when the switches have settled on a NEW number.  While they
+  // are moving (or nothing has changed) there is nothing to do.
+  if (!switch_input.update(millis())) {
+    return;
+  }
+  byte switch_value = switch_input.value();
+
+  // Calculate our x and y offsets for our bitmap graphics
+  byte x_offset = (lander_display.getDisplayWidth() - BITMAP_WIDTH) / 2;
+  byte y_offset = (lander_display.getDisplayHeight() - BITMAP_HEIGHT) / 2;
 
   // Display calculated switch value on our 4 digit display
   bitmap_number_display.showNumberDecEx(switch_value);
@@ -125,8 +130,6 @@ void loop(void) {
     // on it's size.
     lander_display.drawXBMP(x_offset, y_offset, BITMAP_WIDTH, BITMAP_HEIGHT, SWITCH_BITMAPS[switch_value]);
   } while (lander_display.nextPage());
-
-  delay(100);
 }
 
 
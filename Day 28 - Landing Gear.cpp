@@ -24,6 +24,20 @@
 // Explicitly include Arduino.h
 #include "Arduino.h"
 
+// Interrupt driven lever monitor, so no lever movement is missed between loops
+#include "lever_monitor.h"
+
+// Table driven state machine for our approach sequence
+#include "state_machine.h"
+
+// Sleeps between interrupts when there's nothing to do, instead of spinning
+#include "idle_sleep.h"
+
+// Debug messages that are left out of the sketch completely unless we ask for
+// them (uncomment the #define to see each gear position on the Serial Monitor)
+//#define LOG_LEVEL LOG_LEVEL_DEBUG
+#include "log_level.h"
+
 // Extensive documentation for this library can be found at https://github.com/olikraus/u8g2
 #include <U8g2lib.h>  // Include file for the U8g2 library.
 #include "Wire.h"     // Sometimes required for I2C communications.
@@ -73,6 +87,10 @@ TM1637Display bitmap_number_display(BITMAP_NUMBER_DISPLAY_CLK_PIN, BITMAP_NUMBER
 const byte CONFIRM_LEVER_PIN = A2;  // switch for bit 0 of our 3 bit value
 const byte SYSTEMS_LEVER_PIN = A1;  // switch for bit 1 of our 3 bit value
 const byte THRUST_LEVER_PIN = A0;   // switch for bit 2 of our 3 bit value
+// Lever numbers for lever_monitor, in the order the levers are attached in setup()
+const byte CONFIRM_LEVER = 0;
+const byte SYSTEMS_LEVER = 1;
+const byte THRUST_LEVER = 2;
 
 // ************************************************
 // Setup for our 4x4 button matrix.
@@ -111,6 +129,60 @@ enum GEAR_STATE {
   GEAR_RAISING = -1
 };
 
+int current_gear_bitmap = 0;  // Start with image of lander with gear up
+enum GEAR_STATE gear_state = GEAR_IDLE;
+char last_key = -1;  // key previously seen
+
+// ************************************************
+// Things that can happen during our approach ("events").  loop() sends these to
+// our state machine, and APPROACH_TRANSITIONS decides what each one does.
+enum APPROACH_EVENT {
+  LEVERS_ALL_OFF,  // every lever is off
+  LEVERS_ALL_ON,   // every lever is on
+  APPROACH_EVENT_COUNT
+};
+
+// APPROACH_FINAL: Lower or raise the landing gear from the keypad
+void operateGear() {
+  char customKey = myAwesomePad.getKey();
+  if (customKey && customKey != last_key) {
+    Serial.println(customKey);
+    last_key = customKey;
+  }
+
+  switch (customKey) {
+    case 'A':  // Lower landing gear unless already lowered
+      if (current_gear_bitmap != GEAR_BITMAP_COUNT - 1) {
+        gear_state = GEAR_LOWERING;
+      }
+      break;
+    case 'B':  // Raise landing gear unless already raised
+      if (current_gear_bitmap != 0) {
+        gear_state = GEAR_RAISING;
+      }
+      break;
+  }
+}
+
+// The state to move to for each state (row) and event (column).  Events without
+// a transition are ignored.  See state_machine.h.
+const StateTransition APPROACH_TRANSITIONS[][APPROACH_EVENT_COUNT] PROGMEM = {
+  // LEVERS_ALL_OFF                LEVERS_ALL_ON
+  { { APPROACH_PREFLIGHT, NULL },  NO_TRANSITION },                 // APPROACH_INIT
+  { NO_TRANSITION,                 { APPROACH_FINAL, NULL } },      // APPROACH_PREFLIGHT
+  { NO_TRANSITION,                 NO_TRANSITION },                 // APPROACH_FINAL
+};
+
+// What each state does every time through loop() (no entry or exit actions yet).
+const StateActions APPROACH_ACTIONS[] PROGMEM = {
+  // on_entry  on_exit  during
+  { NULL, NULL, NULL },         // APPROACH_INIT
+  { NULL, NULL, NULL },         // APPROACH_PREFLIGHT
+  { NULL, NULL, operateGear },  // APPROACH_FINAL
+};
+
+StateMachine approach(&APPROACH_TRANSITIONS[0][0], APPROACH_ACTIONS, APPROACH_EVENT_COUNT);
+
 // ************************************************
 void setup(void) {
   Serial.begin(9600);
@@ -119,83 +191,47 @@ void setup(void) {
   bitmap_number_display.setBrightness(7);  // Set maximum brightness (value is 0-7)
   bitmap_number_display.clear();           // Clear the display
 
-  // Configure DIP switch pins
-  pinMode(CONFIRM_LEVER_PIN, INPUT);  // switch for bit 0 of our 3 bit value
-  pinMode(SYSTEMS_LEVER_PIN, INPUT);  // switch for bit 1 of our 3 bit value
-  pinMode(THRUST_LEVER_PIN, INPUT);   // switch for bit 2 of our 3 bit value
+  // Watch our DIP switch pins with pin change interrupts (this also sets them as INPUTs)
+  lever_monitor.attach(CONFIRM_LEVER_PIN);  // switch for bit 0 of our 3 bit value, lever 0
+  lever_monitor.attach(SYSTEMS_LEVER_PIN);  // switch for bit 1 of our 3 bit value, lever 1
+  lever_monitor.attach(THRUST_LEVER_PIN);   // switch for bit 2 of our 3 bit value, lever 2
 
   lander_display.begin();                     // initialize lander display
   lander_display.setFont(u8g2_font_6x10_tr);  // Set text font
   lander_display.setFontRefHeightText();      // Define how max text height is calculated
   lander_display.setFontPosTop();             // Y coordinate for text is at top of tallest character
+
+  approach.begin(APPROACH_INIT);  // Begin sequence in APPROACH_INIT state
 }
 
 // ************************************************
 void loop(void) {
-  static int current_gear_bitmap = 0;  // Start with image of lander with gear up
-  static enum APPROACH_STATE approach_state = APPROACH_INIT;
-  // APPROACH_FINAL; //
-  static enum GEAR_STATE gear_state = GEAR_IDLE;
-  static char last_key = -1;  // key previously seen
-
   // Read current values of all of our switches as booleans ("on" is true, "off" is false)
-  bool thrust_lever = digitalRead(THRUST_LEVER_PIN);
-  bool systems_lever = digitalRead(SYSTEMS_LEVER_PIN);
-  bool confirm_lever = digitalRead(CONFIRM_LEVER_PIN);
-  // Serial.println(approach_state);
-  // Serial.print("  Switches: ");
-  // Serial.print(thrust_lever);
-  // Serial.print(", ");
-  // Serial.print(systems_lever);
-  // Serial.print(", ");
-  // Serial.println(confirm_lever);
-
-  switch (approach_state) {
-    case APPROACH_INIT:
-      // Serial.println("case APPROACH_INIT");
-      if (!thrust_lever && !systems_lever && !confirm_lever) {
-        approach_state = APPROACH_PREFLIGHT;
-      }
-      break;
-    case APPROACH_PREFLIGHT:
-      // Serial.println("case APPROACH_PREFLIGHT");
-      if (thrust_lever && systems_lever && confirm_lever) {
-        approach_state = APPROACH_FINAL;
-      }
-      break;
-    // case APPROACH_IN_FLIGHT:
-    //   Serial.println("case APPROACH_IN_FLIGHT");
-    //   approach_state = APPROACH_FINAL;
-    //   break;
-    case APPROACH_FINAL:
-      // Serial.println("case APPROACH_FINAL");
-      char customKey = myAwesomePad.getKey();
-      if (customKey && customKey != last_key) {
-        Serial.println(customKey);
-        last_key = customKey;
-      }
-
-      switch (customKey) {
-        case 'A':  // Lower landing gear unless already lowered
-          if (current_gear_bitmap != GEAR_BITMAP_COUNT - 1) {
-            gear_state = GEAR_LOWERING;
-          }
-          break;
-        case 'B':  // Raise landing gear unless already raised
-          if (current_gear_bitmap != 0) {
-            gear_state = GEAR_RAISING;
-          }
-      }
-      break;
+  // (debounced by lever_monitor, which sees every movement as it happens)
+  byte levers = lever_monitor.states();
+  bool thrust_lever = levers & _BV(THRUST_LEVER);
+  bool systems_lever = levers & _BV(SYSTEMS_LEVER);
+  bool confirm_lever = levers & _BV(CONFIRM_LEVER);
+
+  // Send this loop's events to our state machine, then do the work for the
+  // state we're in.
+  if (!thrust_lever && !systems_lever && !confirm_lever) {
+    approach.handle(LEVERS_ALL_OFF);
   }
+  if (thrust_lever && systems_lever && confirm_lever) {
+    approach.handle(LEVERS_ALL_ON);
+  }
+  approach.update();
+  enum APPROACH_STATE approach_state = (enum APPROACH_STATE)approach.state();
+
   // if (gear_state != GEAR_IDLE) {
   current_gear_bitmap += gear_state;
   if (current_gear_bitmap == 0 || current_gear_bitmap == GEAR_BITMAP_COUNT - 1) {
     gear_state = GEAR_IDLE;
   }
 
-  Serial.print("Gear: ");
-  Serial.println(current_gear_bitmap);
+  // Repeats of the same gear are counted rather than printed if Serial can't keep up
+  LOG_DEBUG("Gear: ", current_gear_bitmap);
   // Display calculated switch value on our 4 digit display
   // bitmap_number_display.showNumberDecEx(switch_value);
 
@@ -214,7 +250,15 @@ void loop(void) {
 
   } while (lander_display.nextPage());
 
-  delay(100);
+  // Send any character from the Serial Monitor to see how much of the time we're awake
+  if (Serial.available()) {
+    while (Serial.available()) {
+      Serial.read();
+    }
+    idle_sleep.printDutyCycle(Serial);
+  }
+
+  idle_sleep.sleepFor(100);  // like delay(100), but asleep between interrupts
 }
 
 void preflightDisplay(enum APPROACH_STATE approach_state,
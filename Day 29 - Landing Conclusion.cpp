@@ -62,13 +62,19 @@
  * 
  * NOTE:
  * The original plan was for us to add our rotary encoder to our design to
- * control the thrusters, but as sometimes happens when working with complex
- * devices our plans needed to change.  It turns out that there is some type
- * of conflict that prevents our rotary encoder from working correctly when
- * it's added to the switches, OLED display and 4-digit counter.
+ * control the thrusters, but it didn't work alongside the switches, OLED
+ * display and 4-digit counter when it was serviced with attachInterrupt().
+ * Now it is serviced with pin change interrupts (see pin_change_encoder.h),
+ * the same way lever_monitor watches the switches, so it works with
+ * everything else.  Turn the dial for thrust, one click for each step of
+ * speed.  The T+ and T- buttons still work too.
  *
- * However, we have unused buttons on the button matrix so we will use
- * those to control our thrust.
+ * Define RUN_ISR_LOAD_TEST to print how much of the HERO's time the encoder
+ * interrupts take while the OLED display is being redrawn.
+ *
+ * Define PROFILE_SECTIONS to time each radar refresh, and the radar drawing
+ * inside it, to the clock cycle (see section_profiler.h).  The times are
+ * printed when we land.
  *
  * Learn more at https://inventr.io/adventure
  *
@@ -89,6 +95,33 @@
 // Explicitly include Arduino.h
 #include "Arduino.h"
 
+// Interrupt driven lever monitor, so no lever movement is missed between loops
+#include "lever_monitor.h"
+
+// Rotary encoder serviced by pin change interrupts, so it can share them with the levers
+#include "pin_change_encoder.h"
+
+// Runs flying, the radar display and the distance counter each at its own speed
+#include "task_scheduler.h"
+
+// Table driven state machine for our approach sequence
+#include "state_machine.h"
+
+// Sleeps between interrupts when there's nothing to do, instead of spinning
+#include "idle_sleep.h"
+
+// Uncomment to print the encoder interrupt load during each OLED refresh
+//#define RUN_ISR_LOAD_TEST
+
+// Uncomment to time the radar display to the clock cycle (uses Timer1)
+//#define PROFILE_SECTIONS
+#include "section_profiler.h"
+
+// Debug messages that are left out of the sketch completely unless we ask for
+// them (uncomment the #define to see the landing gear move on the Serial Monitor)
+//#define LOG_LEVEL LOG_LEVEL_DEBUG
+#include "log_level.h"
+
 // ************************************************
 //    Setup for OLED display and graphics library
 // Include files for Graphics library used for our OLED display.
@@ -149,6 +182,18 @@ TM1637Display distance_display(DISTANCE_DISPLAY_CLK_PIN, DISTANCE_DISPLAY_DIO_PI
 const byte CONFIRM_LEVER_PIN = A2;  // switch for bit 0 of our 3 bit value
 const byte SYSTEMS_LEVER_PIN = A1;  // switch for bit 1 of our 3 bit value
 const byte THRUST_LEVER_PIN = A0;   // switch for bit 2 of our 3 bit value
+// Lever numbers for lever_monitor, in the order the levers are attached in setup()
+const byte CONFIRM_LEVER = 0;
+const byte SYSTEMS_LEVER = 1;
+const byte THRUST_LEVER = 2;
+
+// ************************************************
+//   Setup for the thrust control rotary encoder.
+//
+// Pins 2 and 3 are the only pins left, but any two pins would do.
+const byte THRUST_CONTROL_CLK_PIN = 2;
+const byte THRUST_CONTROL_DT_PIN = 3;
+PinChangeEncoder<THRUST_CONTROL_CLK_PIN, THRUST_CONTROL_DT_PIN> thrust_control;
 
 // ************************************************
 //   Setup for our 4x4 button matrix.
@@ -212,6 +257,79 @@ const int INITIAL_DISTANCE = 1394;  // how far to mother ship
 const byte MAX_MOTHER_SHIP_WIDTH = 21;
 const byte MAX_MOTHER_SHIP_HEIGHT = 15;
 
+// ************************************************
+//   Flight status.
+//
+// These used to be static variables inside loop(), but now each job has its own
+// task (see below) and several tasks need them.
+unsigned long approach_start_time = 0;               // time thrusters are first fired
+int current_gear_bitmap_index = 0;                   // Image of lander with gear up
+enum GEAR_STATE gear_state = GEAR_IDLE;              // Inital landing gear state
+int lander_distance = INITIAL_DISTANCE;
+int lander_speed = 0;  // Initial lander speed relative to mother ship
+// These will track the "drift" of the mother ship from center of radar
+int mother_ship_x_offset = 0;
+int mother_ship_y_offset = 0;
+
+// Final screen, set when we reach the mother ship
+char* ending_bitmap;   // bitmap showing how our landing went
+char ending_time[20];   // time from first thrust, long enough for final display line
+
+// ************************************************
+//   Approach state machine.
+//
+// Things that can happen during our approach ("events").  flyLander() sends
+// these to our state machine, and APPROACH_TRANSITIONS below decides what each
+// one does in each state (see state_machine.h).
+enum APPROACH_EVENT {
+  LEVERS_ALL_OFF,        // every lever is off
+  LEVERS_ALL_ON,         // every lever is on
+  CLOSE_TO_MOTHER_SHIP,  // close enough to lower the landing gear
+  APPROACH_EVENT_COUNT
+};
+
+const byte ALL_LEVERS = _BV(THRUST_LEVER) | _BV(SYSTEMS_LEVER) | _BV(CONFIRM_LEVER);
+
+// Our state actions are written with the flight task below, so we declare them
+// here ("forward declarations") for the tables to use.
+void startFlight();
+void steerLander();
+
+const StateTransition APPROACH_TRANSITIONS[][APPROACH_EVENT_COUNT] PROGMEM = {
+  // LEVERS_ALL_OFF                LEVERS_ALL_ON                    CLOSE_TO_MOTHER_SHIP
+  { { APPROACH_PREFLIGHT, NULL },  NO_TRANSITION,                   NO_TRANSITION },               // APPROACH_INIT
+  { NO_TRANSITION,                 { APPROACH_IN_FLIGHT, NULL },    NO_TRANSITION },               // APPROACH_PREFLIGHT
+  { NO_TRANSITION,                 NO_TRANSITION,                   { APPROACH_FINAL, NULL } },    // APPROACH_IN_FLIGHT
+  { NO_TRANSITION,                 NO_TRANSITION,                   NO_TRANSITION },               // APPROACH_FINAL
+};
+
+// We steer the same way in flight and on final approach, so both states share
+// steerLander() instead of one case falling through into the other.
+const StateActions APPROACH_ACTIONS[] PROGMEM = {
+  // on_entry    on_exit  during
+  { NULL, NULL, NULL },                // APPROACH_INIT
+  { NULL, NULL, NULL },                // APPROACH_PREFLIGHT
+  { startFlight, NULL, steerLander },  // APPROACH_IN_FLIGHT
+  { NULL, NULL, steerLander },         // APPROACH_FINAL
+};
+
+StateMachine approach(&APPROACH_TRANSITIONS[0][0], APPROACH_ACTIONS, APPROACH_EVENT_COUNT);
+
+// ************************************************
+//   Task scheduling.
+//
+// Instead of doing everything and then waiting with delay(100), each job is a
+// task that the scheduler runs at its own speed.  Tasks due at the same time
+// run in the order they were added in setup(): fly, then draw, then count.
+const unsigned long FLIGHT_INTERVAL = 100;   // read the controls and move the lander 10 times a second
+const unsigned long RADAR_INTERVAL = 100;    // redraw the OLED display
+const unsigned long DISTANCE_INTERVAL = 50;  // update the distance counter if it has changed
+const unsigned long ENDING_INTERVAL = 2000;  // time each final screen is shown
+
+TaskScheduler scheduler;
+byte flight_task;  // task numbers, so they can be stopped when we land
+byte radar_task;
+
 // ************************************************
 //                     SETUP()
 // ************************************************
@@ -234,153 +352,78 @@ void setup(void) {
   distance_display.setBrightness(7);  // Set maximum brightness (value is 0-7)
   distance_display.clear();           // Clear the display
 
-  // Configure DIP switch pins
-  pinMode(CONFIRM_LEVER_PIN, INPUT);  // switch for bit 0 of our 3 bit value
-  pinMode(SYSTEMS_LEVER_PIN, INPUT);  // switch for bit 1 of our 3 bit value
-  pinMode(THRUST_LEVER_PIN, INPUT);   // switch for bit 2 of our 3 bit value
+  // Watch our DIP switch pins with pin change interrupts (this also sets them as INPUTs)
+  lever_monitor.attach(CONFIRM_LEVER_PIN);  // switch for bit 0 of our 3 bit value, lever 0
+  lever_monitor.attach(SYSTEMS_LEVER_PIN);  // switch for bit 1 of our 3 bit value, lever 1
+  lever_monitor.attach(THRUST_LEVER_PIN);   // switch for bit 2 of our 3 bit value, lever 2
+
+  // Start watching the thrust control dial
+  thrust_control.begin();
+
+  approach.begin(APPROACH_INIT);  // Begin sequence in APPROACH_INIT state
+
+  // Start our tasks (in the order they should run when due at the same time)
+  flight_task = scheduler.every(FLIGHT_INTERVAL, flyLander, F("fly"));
+  radar_task = scheduler.every(RADAR_INTERVAL, drawRadar, F("radar"));
+  scheduler.every(DISTANCE_INTERVAL, showDistance, F("distance"));
+
+#ifdef RUN_ISR_LOAD_TEST
+  measureEncoderInterrupt();
+#endif
+  profiler.begin();
 }
 
 // ************************************************
 //                     LOOP()
 // ************************************************
+// All of our work is done by the tasks below.  loop() never waits, so each task
+// runs as soon as it is due.  When no task was due we sleep until the next
+// interrupt (at most about 1 ms).
 void loop(void) {
-  // Static variables that will retain state between loop() executions
-  static unsigned long approach_start_time = 0;               // time thrusters are first fired
-  static int current_gear_bitmap_index = 0;                   // Image of lander with gear up
-  static enum APPROACH_STATE approach_state = APPROACH_INIT;  // Initial approach state
-  static enum GEAR_STATE gear_state = GEAR_IDLE;              // Inital landing gear state
-  static int lander_distance = INITIAL_DISTANCE;
-  static int lander_speed = 0;  // Initial lander speed relative to mother ship
-  // These will track the "drift" of the mother ship from center of radar
-  static int mother_ship_x_offset = 0;
-  static int mother_ship_y_offset = 0;
-
-  // Read current values of all of our switches as booleans ("on" is true, "off" is false)
-  bool thrust_lever = digitalRead(THRUST_LEVER_PIN);
-  bool systems_lever = digitalRead(SYSTEMS_LEVER_PIN);
-  bool confirm_lever = digitalRead(CONFIRM_LEVER_PIN);
+  if (scheduler.run() == 0) {
+    idle_sleep.sleep();
+  }
+}
+
+// ************************************************
+//                  Flight task
+// ************************************************
+// Read our controls and move the lander, FLIGHT_INTERVAL ms at a time.
+void flyLander() {
+  // Read current values of all of our switches
+  // (debounced by lever_monitor, which sees every movement as it happens)
+  byte levers = lever_monitor.states();
 
   /*
    * Primary control state machine.
    *
-   * Based on the current state of our approach to the lander, handle each
-   * state's decisions, changing state when appropriate.
+   * Send this loop's events to our state machine.  APPROACH_TRANSITIONS decides
+   * which ones change the state, then update() steers the lander if we are in
+   * flight.
+   *
+   * INIT: All switches must be "off" before our approach sequence can be started.
+   * PREFLIGHT: Once we have enabled thrusters and systems and confirmed we're
+   * ready then switch to in-flight radar display.
    */
-  switch (approach_state) {
-
-    // INIT state - Display switch status and ensure all are "OFF"
-    case APPROACH_INIT:
-      // All switches must be "off" before our approach sequence can be started
-      // Since we save these as boolean (true/false) we can do this check on one
-      // line that could be read as "if thrust is not true and systems is not true
-      // and confirm is not true then..."
-      if (!thrust_lever && !systems_lever && !confirm_lever) {
-        // All switches are now off, ready for pre-flight
-        approach_state = APPROACH_PREFLIGHT;  // Change state to Preflight
-      }
-      break;
-
-    // PREFLIGHT state - All switches off.  Switch all on to begin approach
-    case APPROACH_PREFLIGHT:
-      // Once we have enabled thrusters and systems and confirmed we're ready
-      // then switch to in-flight radar display.
-      if (thrust_lever && systems_lever && confirm_lever) {  // All switches are "on"
-        approach_state = APPROACH_IN_FLIGHT;                 // change to in-flight state
-      }
-      break;
-
-    // FINAL state - Lower gear, we're about to land!
-    case APPROACH_FINAL:
-      // Check to see if a gear change button is pressed.  Do NOT wait for a key.
-      // NOTE - code then drops into in-flight state!!
-      // VVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVV
-
-    // IN-FLIGHT state - Add thrust to move closer to mother ship.
-    // (Remember, you will have to REDUCE thrust as you get closer)
-    case APPROACH_IN_FLIGHT:
-
-      switch (controlButtonPressed()) {
-        case RAISE_SPEED:
-          lander_speed++;  // increase velocity
-          // If this is first time increasing speed then save the start time
-          if (approach_start_time == 0) {
-            approach_start_time = millis();
-          }
-          break;
-        case LOWER_SPEED:
-          // lower speed unless stopped
-          if (lander_speed > 0) {
-            lander_speed--;
-          }
-          break;
-        case LOWER_GEAR:                           // Lower landing gear unless already lowered
-          if (approach_state == APPROACH_FINAL) {  // Only works on final approach
-            // Lowering gear is an animation created by changing bitmaps each frame
-            // until the gear is completely lowered.
-            if (current_gear_bitmap_index != GEAR_BITMAP_COUNT - 1) {
-              gear_state = GEAR_LOWERING;  // increases bitmap index until lowered
-            }
-          }
-          break;
-        case RAISE_GEAR:  // Raise landing gear unless already raised
-          // Raising gear is an animation created by changing the bitmap index
-          // each frame until gear is up.
-          if (current_gear_bitmap_index != 0) {  // Ignore if gear is already up
-            gear_state = GEAR_RAISING;
-          }
-        case STEER_UP:
-          mother_ship_y_offset++;  // Steer lander one pixel UP
-          break;
-        case STEER_DOWN:
-          mother_ship_y_offset--;  // Steer lander one pixel DOWN
-          break;
-        case STEER_LEFT:
-          mother_ship_x_offset++;  // Steer lander one pixel LEFT
-          break;
-        case STEER_RIGHT:
-          mother_ship_x_offset--;  // Steer lander one pixel RIGHT
-          break;
-        case STEER_UP_RIGHT:
-          mother_ship_x_offset--;  // Steer lander one pixel UP and RIGHT
-          mother_ship_y_offset++;
-          break;
-        case STEER_UP_LEFT:
-          mother_ship_x_offset++;  // Steer lander one pixel UP and LEFT
-          mother_ship_y_offset++;
-          break;
-        case STEER_DOWN_RIGHT:
-          mother_ship_x_offset--;  // Steer lander one pixel DOWN and RIGHT
-          mother_ship_y_offset--;
-          break;
-        case STEER_DOWN_LEFT:
-          mother_ship_x_offset++;  // Steer lander one pixel DOWN and LEFT
-          mother_ship_y_offset--;
-          break;
-      }
+  if (levers == 0) {
+    approach.handle(LEVERS_ALL_OFF);
+  }
+  if (levers == ALL_LEVERS) {
+    approach.handle(LEVERS_ALL_ON);
+  }
+  approach.update();
 
-      // Here we compute the drift of the mother ship using random numbers.
-      // The mother ship cannot drift off the display, done by setting a
-      // maximum drift.
-      const byte MAX_DRIFT = 18;
-
-      mother_ship_x_offset += getRandomDrift();  // returns -1, 0 or 1
-      mother_ship_y_offset += getRandomDrift();  // returns -1, 0 or 1
-      // Ensure mother ship doesn't drift off our radar display
-      if (mother_ship_x_offset > MAX_DRIFT) mother_ship_x_offset = MAX_DRIFT;
-      if (mother_ship_x_offset < -MAX_DRIFT) mother_ship_x_offset = -MAX_DRIFT;
-      if (mother_ship_y_offset > MAX_DRIFT) mother_ship_y_offset = MAX_DRIFT;
-      if (mother_ship_y_offset < -MAX_DRIFT) mother_ship_y_offset = -MAX_DRIFT;
-
-      // Prepare for landing on final approach
-      if (lander_distance < (INITIAL_DISTANCE / 10)) {
-        approach_state = APPROACH_FINAL;  // on final approach - enable gear and warn
-      }
-      break;
+  // Prepare for landing on final approach - enable gear and warn
+  if (lander_distance < (INITIAL_DISTANCE / 10)) {
+    approach.handle(CLOSE_TO_MOTHER_SHIP);
   }
 
   // Because we specified our gear states as 0, 1 or -1 we can change bitmaps by
   // simply adding the gear state to our current gear bitmap index.
   current_gear_bitmap_index += gear_state;
+  if (gear_state != GEAR_IDLE) {
+    LOG_DEBUG("Gear: ", current_gear_bitmap_index);
+  }
 
   // If the gear animation has completed (index is either 0 or the index of our last bitmap)
   // then we change the gear state to IDLE to complete animation.
@@ -388,34 +431,12 @@ void loop(void) {
     gear_state = GEAR_IDLE;
   }
 
-  // Update our lander display (OLED) using firstPage()/nextPage() methods which
-  // use a smaller buffer to save memory.  Draw the exact SAME display each time
-  // through this loop!
-  lander_display.firstPage();
-  do {
-    switch (approach_state) {
-      // Display switch status for INIT and PREFLIGHT states.
-      case APPROACH_INIT:
-      case APPROACH_PREFLIGHT:
-        displayPreFlight(approach_state, thrust_lever, systems_lever, confirm_lever);
-        break;
-
-      case APPROACH_FINAL:
-        displayFinal(current_gear_bitmap_index);
-      case APPROACH_IN_FLIGHT:
-        displayInFlight(lander_distance, lander_speed,
-                        mother_ship_x_offset, mother_ship_y_offset);
-        break;
-    }
-  } while (lander_display.nextPage());
-
   lander_distance -= lander_speed;  // Adjust distance by current speed
 
   // END OF FLIGHT!
   //
   // When we reach the mother ship (distance <= 0) then determine success
   // or failure and display finaly screen alternating with last radar image.
-  char* ending_bitmp;
   if (lander_distance <= 0) {
     // Check to see if our lander landed inside the mother ship target box.
     if (abs(mother_ship_x_offset) < ((MAX_MOTHER_SHIP_WIDTH + 1) / 2)
@@ -426,58 +447,225 @@ void loop(void) {
 
         // Speed OK, but did we remember to lower the landing gear?
         if (current_gear_bitmap_index == GEAR_BITMAP_COUNT - 1) {  // Gear is down!
-          ending_bitmp = ENDING_BITMAP_SUCCESS;                    // SUCCESS!
+          ending_bitmap = ENDING_BITMAP_SUCCESS;                   // SUCCESS!
         } else {
           // Oops, gear is up.  Damage to lander, but we survived.
-          ending_bitmp = ENDING_BITMAP_NO_GEAR;
+          ending_bitmap = ENDING_BITMAP_NO_GEAR;
         }
       } else {
         // Speed is too fast!  Lander AND mother ship destroyed.  (Ouch!)
-        ending_bitmp = ENDING_BITMAP_TOO_FAST;
+        ending_bitmap = ENDING_BITMAP_TOO_FAST;
       }
     } else {
       // Missed the mother ship.  No fuel for another try.  Bye!
-      ending_bitmp = ENDING_BITMAP_MISSED_MOTHER_SHIP;
+      ending_bitmap = ENDING_BITMAP_MISSED_MOTHER_SHIP;
     }
 
-    // Show final distance
-    distance_display.showNumberDec(0);
-
     // Calculate elapsed time (in ms) from first thrust.
     unsigned long elapsed_time = millis() - approach_start_time;
 
     // Now format to fractional seconds (SS.SSS) using sprintf
-    char buffer[20];  // buffer long enough for final display line.
-
     // Since elapse time is a long integer we can get the number of seconds
     // by simply dividing by 1000 and the fractional portion is dropped.  The
     // Modulo operator ('%') returns the REMAINDER after dividing left side by
     // the value on the right.  This gives us the fractional number seconds.
     // Sprintf() uses "lu" to indicate that the value is a "unsigned long"
     // ("lu" does NOT work!).
-    sprintf(buffer, "%4lu.%03lu Sec", elapsed_time / 1000, elapsed_time % 1000);
-
-    // Final display.  Alternate between splash screen with time and
-    // final radar view.
-    do {
-      lander_display.firstPage();
-      do {
-        lander_display.drawStr(0, 0, buffer);
-        lander_display.drawXBMP(0, 10, ENDING_BITMAP_WIDTH, ENDING_BITMAP_HEIGHT, ending_bitmp);
-      } while (lander_display.nextPage());
-      delay(2000);
-
-      lander_display.firstPage();
-      do {
+    sprintf(ending_time, "%4lu.%03lu Sec", elapsed_time / 1000, elapsed_time % 1000);
+
+    // Final display.  Stop flying and alternate between splash screen with
+    // time and final radar view.
+    scheduler.cancel(flight_task);
+    scheduler.cancel(radar_task);
+    scheduler.every(ENDING_INTERVAL, showEnding, F("ending"));
+
+    // Show how long we spent in each state, and how much of the flight we
+    // were awake, on the Serial Monitor
+    approach.printHistory(Serial);
+    idle_sleep.printDutyCycle(Serial);
+    profiler.printReport(Serial);
+  }
+}
+
+// Entering IN_FLIGHT: throw away any turns of the thrust dial made before we
+// were in flight.
+void startFlight() {
+  thrust_control.getChange();
+}
+
+// IN_FLIGHT and FINAL: Add thrust to move closer to mother ship and steer to
+// keep it centered.  (Remember, you will have to REDUCE thrust as you get closer)
+// The landing gear can only be lowered on final approach.
+void steerLander() {
+  // Clicks of the thrust dial since the last loop
+  int thrust_change = thrust_control.getChange();
+
+  // Turning the thrust dial changes speed by one for each click
+  if (thrust_change != 0) {
+    lander_speed += thrust_change;
+    if (lander_speed < 0) {  // can't go slower than stopped
+      lander_speed = 0;
+    }
+    // If this is first time increasing speed then save the start time
+    if (thrust_change > 0 && approach_start_time == 0) {
+      approach_start_time = millis();
+    }
+  }
+
+  switch (controlButtonPressed()) {
+    case RAISE_SPEED:
+      lander_speed++;  // increase velocity
+      // If this is first time increasing speed then save the start time
+      if (approach_start_time == 0) {
+        approach_start_time = millis();
+      }
+      break;
+    case LOWER_SPEED:
+      // lower speed unless stopped
+      if (lander_speed > 0) {
+        lander_speed--;
+      }
+      break;
+    case LOWER_GEAR:                             // Lower landing gear unless already lowered
+      if (approach.state() == APPROACH_FINAL) {  // Only works on final approach
+        // Lowering gear is an animation created by changing bitmaps each frame
+        // until the gear is completely lowered.
+        if (current_gear_bitmap_index != GEAR_BITMAP_COUNT - 1) {
+          gear_state = GEAR_LOWERING;  // increases bitmap index until lowered
+        }
+      }
+      break;
+    case RAISE_GEAR:  // Raise landing gear unless already raised
+      // Raising gear is an animation created by changing the bitmap index
+      // each frame until gear is up.
+      if (current_gear_bitmap_index != 0) {  // Ignore if gear is already up
+        gear_state = GEAR_RAISING;
+      }
+      break;
+    case STEER_UP:
+      mother_ship_y_offset++;  // Steer lander one pixel UP
+      break;
+    case STEER_DOWN:
+      mother_ship_y_offset--;  // Steer lander one pixel DOWN
+      break;
+    case STEER_LEFT:
+      mother_ship_x_offset++;  // Steer lander one pixel LEFT
+      break;
+    case STEER_RIGHT:
+      mother_ship_x_offset--;  // Steer lander one pixel RIGHT
+      break;
+    case STEER_UP_RIGHT:
+      mother_ship_x_offset--;  // Steer lander one pixel UP and RIGHT
+      mother_ship_y_offset++;
+      break;
+    case STEER_UP_LEFT:
+      mother_ship_x_offset++;  // Steer lander one pixel UP and LEFT
+      mother_ship_y_offset++;
+      break;
+    case STEER_DOWN_RIGHT:
+      mother_ship_x_offset--;  // Steer lander one pixel DOWN and RIGHT
+      mother_ship_y_offset--;
+      break;
+    case STEER_DOWN_LEFT:
+      mother_ship_x_offset++;  // Steer lander one pixel DOWN and LEFT
+      mother_ship_y_offset--;
+      break;
+  }
+
+  // Here we compute the drift of the mother ship using random numbers.
+  // The mother ship cannot drift off the display, done by setting a
+  // maximum drift.
+  const byte MAX_DRIFT = 18;
+
+  mother_ship_x_offset += getRandomDrift();  // returns -1, 0 or 1
+  mother_ship_y_offset += getRandomDrift();  // returns -1, 0 or 1
+  // Ensure mother ship doesn't drift off our radar display
+  if (mother_ship_x_offset > MAX_DRIFT) mother_ship_x_offset = MAX_DRIFT;
+  if (mother_ship_x_offset < -MAX_DRIFT) mother_ship_x_offset = -MAX_DRIFT;
+  if (mother_ship_y_offset > MAX_DRIFT) mother_ship_y_offset = MAX_DRIFT;
+  if (mother_ship_y_offset < -MAX_DRIFT) mother_ship_y_offset = -MAX_DRIFT;
+}
+
+// ************************************************
+//                  Radar task
+// ************************************************
+// Update our lander display (OLED) using firstPage()/nextPage() methods which
+// use a smaller buffer to save memory.  Draw the exact SAME display each time
+// through the loop!
+void drawRadar() {
+  PROFILE_SCOPE("radar");  // the whole refresh, including sending it to the display
+
+  // Switch positions for the preflight display
+  byte levers = lever_monitor.states();
+
+#ifdef RUN_ISR_LOAD_TEST
+  unsigned long refresh_start = micros();
+  unsigned int interrupts_before = thrust_control.interruptCount();
+#endif
+  enum APPROACH_STATE approach_state = (enum APPROACH_STATE)approach.state();
+  lander_display.firstPage();
+  do {
+    switch (approach_state) {
+      // Display switch status for INIT and PREFLIGHT states.
+      case APPROACH_INIT:
+      case APPROACH_PREFLIGHT:
+        displayPreFlight(approach_state, levers & _BV(THRUST_LEVER),
+                         levers & _BV(SYSTEMS_LEVER), levers & _BV(CONFIRM_LEVER));
+        break;
+
+      // Final approach shows the landing gear on top of the radar
+      case APPROACH_FINAL:
         displayFinal(current_gear_bitmap_index);
         displayInFlight(lander_distance, lander_speed,
                         mother_ship_x_offset, mother_ship_y_offset);
-      } while (lander_display.nextPage());
-      delay(2000);
-    } while (true);  // repeat this final display until HERO is reset
-    // NEVER REACHED.  THIS IS OUR FINAL EXECUTION OF LOOP();
+        break;
+
+      case APPROACH_IN_FLIGHT:
+        displayInFlight(lander_distance, lander_speed,
+                        mother_ship_x_offset, mother_ship_y_offset);
+        break;
+    }
+  } while (lander_display.nextPage());
+#ifdef RUN_ISR_LOAD_TEST
+  printEncoderLoad(micros() - refresh_start, thrust_control.interruptCount() - interrupts_before);
+#endif
+}
+
+// ************************************************
+//                 Distance task
+// ************************************************
+// Display distance to mother ship on our distance display.  Only sent when it
+// changes, since the display is slow to update.
+void showDistance() {
+  static int shown_distance = -1;  // nothing shown yet
+
+  int distance = max(lander_distance, 0);  // we can overshoot a miss, but show 0
+  if (distance != shown_distance) {
+    distance_display.showNumberDec(distance);
+    shown_distance = distance;
   }
-  delay(100);  // Delay 1/10 second before next loop
+}
+
+// ************************************************
+//                  Ending task
+// ************************************************
+// Final display, repeated until HERO is reset.  Each run shows the other screen:
+// the splash screen with our time, or the final radar view.
+void showEnding() {
+  static bool show_splash = true;
+
+  lander_display.firstPage();
+  do {
+    if (show_splash) {
+      lander_display.drawStr(0, 0, ending_time);
+      lander_display.drawXBMP(0, 10, ENDING_BITMAP_WIDTH, ENDING_BITMAP_HEIGHT, ending_bitmap);
+    } else {
+      displayFinal(current_gear_bitmap_index);
+      displayInFlight(lander_distance, lander_speed,
+                      mother_ship_x_offset, mother_ship_y_offset);
+    }
+  } while (lander_display.nextPage());
+  show_splash = !show_splash;
 }
 
 // ************************************************
@@ -517,6 +705,7 @@ void displayInFlight(int lander_distance,
                      int lander_speed,
                      int mother_ship_x_offset,
                      int mother_ship_y_offset) {
+  PROFILE_SCOPE("in_flight");  // drawing only, once for each part of the display
 
   // Mother ship initially appears as a single dot, but expands into a rectangle
   // as we get closer.  Scaled based on the maximum width, from 1 to MAX.
@@ -533,9 +722,6 @@ void displayInFlight(int lander_distance,
     mother_ship_height = 1;  // Always at least 1 pixel high
   }
 
-  // Display distance to mother ship on our distance display
-  distance_display.showNumberDec(lander_distance);
-
   // coordinates of the center of our radar display
   const byte RADAR_CENTER_X = (lander_display.getDisplayWidth() / 2 / 2);  // center of left half
   const byte RADAR_CENTER_Y = (lander_display.getDisplayHeight() / 2);     // Vertical center
@@ -700,3 +886,55 @@ int getRandomDrift() {
 }
 
 
+#ifdef RUN_ISR_LOAD_TEST
+const unsigned int BENCHMARK_CALLS = 1000;
+// Clock cycles the HERO spends getting into and out of an interrupt (an estimate -
+// it isn't something we can time from inside the sketch, see Day 18)
+const unsigned int INTERRUPT_OVERHEAD_CYCLES = 80;
+
+float encoder_interrupt_cycles;  // clock cycles pin_change and the encoder take for each pin change
+
+// Time pin_change handling an encoder pin change by handing it port readings with
+// the CLK pin flipped back and forth.  The real pin change interrupt is turned off
+// meanwhile so it can't get mixed up with our pretend readings.  The dial isn't
+// really moving, so this is the time for a step rather than a whole click.
+void measureEncoderInterrupt() {
+  const byte port = digitalPinToPCICRbit(THRUST_CONTROL_CLK_PIN);
+  const byte flip = digitalPinToBitMask(THRUST_CONTROL_CLK_PIN);
+  byte pins = *portInputRegister(digitalPinToPort(THRUST_CONTROL_CLK_PIN));
+
+  unsigned long empty_loop_time = micros();  // first time a loop that does nothing
+  for (volatile unsigned int i = 0; i < BENCHMARK_CALLS / 2; i++) {}
+  empty_loop_time = micros() - empty_loop_time;
+
+  PCICR &= ~_BV(port);
+  unsigned long start_time = micros();
+  for (volatile unsigned int i = 0; i < BENCHMARK_CALLS / 2; i++) {
+    pin_change.serviceInterrupt(port, pins ^ flip);
+    pin_change.serviceInterrupt(port, pins);  // back to the real reading
+  }
+  unsigned long elapsed_time = micros() - start_time;
+  PCICR |= _BV(port);
+
+  encoder_interrupt_cycles = (float)(elapsed_time - empty_loop_time) * (F_CPU / 1000000UL) / BENCHMARK_CALLS;
+  Serial.print("Encoder interrupt: ");
+  Serial.print(encoder_interrupt_cycles + INTERRUPT_OVERHEAD_CYCLES);
+  Serial.println(" cycles");
+}
+
+// Print how much of an OLED refresh was spent in encoder interrupts.  Only prints
+// while the dial is turning.
+void printEncoderLoad(unsigned long refresh_time, unsigned int interrupts) {
+  if (interrupts == 0) {
+    return;
+  }
+  float interrupt_time = interrupts * (encoder_interrupt_cycles + INTERRUPT_OVERHEAD_CYCLES)
+                         / (F_CPU / 1000000UL);
+  Serial.print(interrupts);
+  Serial.print(" encoder interrupts during a ");
+  Serial.print(refresh_time);
+  Serial.print(" us refresh: ");
+  Serial.print(100 * interrupt_time / refresh_time);
+  Serial.println("% load");
+}
+#endif
@@ -1,43 +1,32 @@
-int LED1 = 10; //pins 10-12 are to be LED outputs - these correspond to the pins on the HERO board (not the breadboard)
-int LED2 = 11;
-int LED3 = 12;
-int Switch1 = 2; //pins 2-4 are to be switch inputs, one switch to control each of the 3 LEDs
-int Switch2 = 3;
-int Switch3 = 4;
+#include "input_snapshot.h" //reads all of the switches at the same moment
+#include "output_group.h" //changes all of the LEDs at the same moment
+#include "debouncer.h" //ignores the switches bouncing when they are flipped
+
+OutputGroup<10, 11, 12> LEDs; //pins 10-12 are to be LED outputs - these correspond to the pins on the HERO board (not the breadboard)
+InputSnapshot<2, 3, 4> Switches; //pins 2-4 are to be switch inputs, one switch to control each of the 3 LEDs
+VerticalDebouncer SwitchDebouncer; //a switch has to read the same 4 times in a row before we believe it
+const unsigned long DEBOUNCE_TICK = 5; //read the switches every 5 ms, so a change takes 20 ms to be believed
 
 void setup() {
   //code to assign roles for each variable above, which corresponds to an action for each pin in the HERO board
   //defines input and outputs. Meaning that LED1 etc will be our result, in this case turn on or off and Switch1 will be our input or directions
-pinMode(LED1, OUTPUT);
-pinMode(LED2, OUTPUT);
-pinMode(LED3, OUTPUT);
-pinMode(Switch1, INPUT);
-pinMode(Switch2, INPUT);
-pinMode(Switch3, INPUT);
+LEDs.output();
+Switches.input();
 }
 
 void loop() {
   // now within loop() we'll take actions based on the status of the switches
-  //because this is a loop and will continuously cycle through, if we turn a switch on or off, the next time it loops through it will detect the change and execute the else or if
+  //because this is a loop and will continuously cycle through, if we turn a switch on or off, the next time it loops through it will detect the change and update the LEDs
  
- if (digitalRead(Switch1) == HIGH){ //check switch #1 //If Switch1 (which corresponds to pin 2) has voltage flowing through, then turn the light ON (execute code within {})
- digitalWrite(LED1, HIGH); //turn LED on
- }
- else {
-  digitalWrite(LED1, LOW); //turn LED off
- }
+ static unsigned long last_tick = 0;
+ if (millis() - last_tick >= DEBOUNCE_TICK) {
+  last_tick += DEBOUNCE_TICK;
 
- if (digitalRead(Switch2) == HIGH){
- digitalWrite(LED2, HIGH);
- }
- else {
-  digitalWrite(LED2, LOW);
- }
-
- if (digitalRead(Switch3) == HIGH){
- digitalWrite(LED3, HIGH);
- }
- else {
-  digitalWrite(LED3, LOW);
+  //Switch1 is bit 0 of the snapshot and LED1 is bit 0 of the group (and so on), so each LED simply
+  //copies its debounced switch: ON if that switch has voltage flowing through, OFF if not. All three
+  //LEDs change with one write to the port instead of three digitalWrite() calls
+  if (SwitchDebouncer.update(Switches.read())) {
+   LEDs.write(SwitchDebouncer.state());
+  }
  }
 }
\ No newline at end of file
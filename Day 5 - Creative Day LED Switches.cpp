@@ -1,65 +1,105 @@
 //day 5 idea - 
 //harder - day 4 wiring but extend it to 6 lights and rather than the 3 switches on/off, 
-int LED1 = 13;
-int LED2 = 12;
-int LED3 = 11;
-int LED4 = 10;
-int LED5 = 9;
-int LED6 = 8;
-int Switch1 = 2;
-int Switch2 = 3;
-int Switch3 = 4;
+//reads all of our switches at the same moment, see input_snapshot.h
+#include "input_snapshot.h"
+//changes all of our LEDs at the same moment, see output_group.h
+#include "output_group.h"
+//ignores the switches bouncing when they are flipped, see debouncer.h
+#include "debouncer.h"
+
+OutputGroup<13, 12, 11, 10, 9, 8> LEDs; //LED1 = pin 13 ... LED6 = pin 8
+
+//each LED's bit in the group
+const byte LED1 = _BV(0);
+const byte LED2 = _BV(1);
+const byte LED3 = _BV(2);
+const byte LED4 = _BV(3);
+const byte LED5 = _BV(4);
+const byte LED6 = _BV(5);
+InputSnapshot<2, 3, 4> switches; //Switch1 = pin 2, Switch2 = pin 3, Switch3 = pin 4
+VerticalDebouncer switch_debouncer; //a switch has to read the same 4 times in a row before we believe it
+const unsigned long DEBOUNCE_TICK = 5; //read the switches every 5 ms, so a change takes 20 ms to be believed
+
+//each switch's bit in our snapshot
+const byte Switch1 = _BV(0);
+const byte Switch2 = _BV(1);
+const byte Switch3 = _BV(2);
+
+//uncomment to measure the clock cycles of six digitalWrite() calls against one LEDs.write() (open the Serial Monitor)
+//#define RUN_OUTPUT_BENCHMARK
 
 void setup() {
-pinMode(LED1, OUTPUT); 
-pinMode(LED2, OUTPUT); 
-pinMode(LED3, OUTPUT); 
-pinMode(LED4, OUTPUT); 
-pinMode(LED5, OUTPUT); 
-pinMode(LED6, OUTPUT); 
-pinMode(Switch1, INPUT);
-pinMode(Switch2, INPUT);
-pinMode(Switch3, INPUT);
+LEDs.output();
+switches.input();
+
+#ifdef RUN_OUTPUT_BENCHMARK
+	Serial.begin(9600);
+	runOutputBenchmark();
+#endif
 }
 
 void loop() {
-	//LED 1
-	if (digitalRead(Switch1) == HIGH){
-		digitalWrite(LED1, HIGH);
-	}
-	else {digitalWrite(LED1,LOW);
-	}
-	//LED 2
-	if (digitalRead(Switch2) == HIGH){
-	digitalWrite(LED2, HIGH);
-	}
-	else {digitalWrite(LED2,LOW);
-	}
-	//LED 3
-	if (digitalRead(Switch3) == HIGH){
-	digitalWrite(LED3, HIGH);
-	}
-	else {digitalWrite(LED3,LOW);
-	}
-	//LED 4
-	if (digitalRead(Switch1) == HIGH
-	&& digitalRead(Switch2) == HIGH){
-	digitalWrite(LED4, HIGH);
-	}
-	else {digitalWrite(LED4,LOW);
-	}
-	//LED 5
-	if (digitalRead(Switch1) == HIGH
-	&& digitalRead(Switch3) == HIGH){
-	digitalWrite(LED5, HIGH);
+	//read all three switches once, at the same moment, so every LED below agrees
+	//(LED4 can never be lit while LED1 is off because a switch moved part way through)
+	static unsigned long last_tick = 0;
+	if (millis() - last_tick < DEBOUNCE_TICK) {
+		return; //not time to read the switches yet
 	}
-	else {digitalWrite(LED5,LOW);
-	}
-	//LED 6
-	if (digitalRead(Switch2) == HIGH
-	&& digitalRead(Switch3) == HIGH){
-	digitalWrite(LED6, HIGH);
-	}
-	else {digitalWrite(LED6,LOW);
+	last_tick += DEBOUNCE_TICK;
+	if (!switch_debouncer.update(switches.read())) {
+		return; //no switch has changed, so no LED needs to change
 	}
+	byte snapshot = switch_debouncer.state();
+
+	//work out which LEDs should be lit, one bit each...
+	byte lit = 0;
+	if (allOn(snapshot, Switch1)) lit |= LED1;
+	if (allOn(snapshot, Switch2)) lit |= LED2;
+	if (allOn(snapshot, Switch3)) lit |= LED3;
+	if (allOn(snapshot, Switch1 | Switch2)) lit |= LED4;
+	if (allOn(snapshot, Switch1 | Switch3)) lit |= LED5;
+	if (allOn(snapshot, Switch2 | Switch3)) lit |= LED6;
+
+	//...then change all six at the same instant with a single write to PORTB
+	LEDs.write(lit);
+}
+
+#ifdef RUN_OUTPUT_BENCHMARK
+const unsigned int BENCHMARK_CALLS = 10000;
+volatile byte benchmark_lit = LED1 | LED3 | LED5; //volatile so the compiler can't work the writes out ahead of time
+
+//time BENCHMARK_CALLS trips around a loop and print the clock cycles for each call, after taking away
+//the time the empty loop takes (one microsecond is 16 clock cycles on the HERO)
+#define TIME_CALLS(label, call) { \
+    unsigned long start_time = micros(); \
+    for (volatile unsigned int i = 0; i < BENCHMARK_CALLS; i++) { call; } \
+    printCycles(label, micros() - start_time, empty_loop_time); \
+  }
+
+void printCycles(const char *label, unsigned long elapsed_time, unsigned long empty_loop_time) {
+	Serial.print(label);
+	Serial.print(": ");
+	Serial.print((float)(elapsed_time - empty_loop_time) * (F_CPU / 1000000UL) / BENCHMARK_CALLS);
+	Serial.println(" cycles");
+}
+
+//the six LEDs set one pin at a time, the way this sketch did before OutputGroup
+inline void digitalWriteSix(byte lit) {
+	digitalWrite(13, (lit & LED1) ? HIGH : LOW);
+	digitalWrite(12, (lit & LED2) ? HIGH : LOW);
+	digitalWrite(11, (lit & LED3) ? HIGH : LOW);
+	digitalWrite(10, (lit & LED4) ? HIGH : LOW);
+	digitalWrite(9, (lit & LED5) ? HIGH : LOW);
+	digitalWrite(8, (lit & LED6) ? HIGH : LOW);
+}
+
+void runOutputBenchmark() {
+	unsigned long empty_loop_time = micros(); //first time a loop that does nothing
+	for (volatile unsigned int i = 0; i < BENCHMARK_CALLS; i++) {}
+	empty_loop_time = micros() - empty_loop_time;
+
+	TIME_CALLS("six digitalWrite() calls", digitalWriteSix(benchmark_lit));
+	TIME_CALLS("LEDs.write()", LEDs.write(benchmark_lit));
+	LEDs.write(0);
 }
+#endif
\ No newline at end of file
@@ -0,0 +1,110 @@
+//day 5b idea -
+//same wiring as day 5 (6 lights on pins 8-13, 3 switches on pins 2-4) but rather than snapping on and off,
+//the lights fade in and out. Only pins 9, 10 and 11 can use analogWrite(), so we use software PWM
+//(soft_pwm.h) which can dim ANY pin
+
+#include "Arduino.h"
+
+//software PWM lets every one of our 6 LED pins dim
+#include "soft_pwm.h"
+//gamma table so the fade looks even to our eyes
+#include "gamma_table.h"
+
+//uncomment to measure how much of the HERO's time the software PWM interrupt uses
+//#define RUN_SOFT_PWM_BENCHMARK
+
+const byte LED_PINS[] = { 13, 12, 11, 10, 9, 8 };  //LED1 to LED6
+const byte LED_COUNT = sizeof(LED_PINS) / sizeof(LED_PINS[0]);
+int Switch1 = 2;
+int Switch2 = 3;
+int Switch3 = 4;
+
+//how quickly the lights fade - each step moves the brightness FADE_STEP closer every FADE_INTERVAL ms
+//(255 / 5 steps * 4 ms = about 1/5 of a second from off to fully on)
+const byte FADE_STEP = 5;
+const unsigned long FADE_INTERVAL = 4;
+
+void setup() {
+for (byte i = 0; i < LED_COUNT; i++) {
+	soft_pwm.attach(LED_PINS[i]); //attach() also sets the pin as an OUTPUT
+}
+pinMode(Switch1, INPUT);
+pinMode(Switch2, INPUT);
+pinMode(Switch3, INPUT);
+
+#ifdef RUN_SOFT_PWM_BENCHMARK
+	Serial.begin(9600);
+	runSoftPwmBenchmark();
+#endif
+
+soft_pwm.begin(SoftPwm::REFRESH_490_HZ);
+}
+
+void loop() {
+	//same rules as day 5 - which LEDs should be on?
+	bool switch1 = digitalRead(Switch1) == HIGH;
+	bool switch2 = digitalRead(Switch2) == HIGH;
+	bool switch3 = digitalRead(Switch3) == HIGH;
+	bool led_on[LED_COUNT] = {
+		switch1,             //LED 1
+		switch2,             //LED 2
+		switch3,             //LED 3
+		switch1 && switch2,  //LED 4
+		switch1 && switch3,  //LED 5
+		switch2 && switch3   //LED 6
+	};
+
+	//every FADE_INTERVAL ms move each light a step toward fully on or fully off
+	static byte brightness[LED_COUNT];  //current brightness of each LED, starts at 0
+	static unsigned long last_fade_time = 0;
+	if (millis() - last_fade_time >= FADE_INTERVAL) {
+		last_fade_time = millis();
+		for (byte i = 0; i < LED_COUNT; i++) {
+			if (led_on[i] && brightness[i] < 255) {
+				brightness[i] = (brightness[i] > 255 - FADE_STEP) ? 255 : brightness[i] + FADE_STEP;
+			}
+			else if (!led_on[i] && brightness[i] > 0) {
+				brightness[i] = (brightness[i] < FADE_STEP) ? 0 : brightness[i] - FADE_STEP;
+			}
+			soft_pwm.write(LED_PINS[i], gammaCorrect(brightness[i]));
+		}
+	}
+}
+
+#ifdef RUN_SOFT_PWM_BENCHMARK
+//count how many times we can go around an empty loop in one second, first with software PWM
+//off and then at each refresh rate. The loops we lose are time spent in the PWM interrupt
+unsigned long countLoopsInOneSecond() {
+	unsigned long count = 0;
+	unsigned long start_time = millis();
+	while (millis() - start_time < 1000) {
+		count++;
+	}
+	return count;
+}
+
+void printLoad(const char *label, unsigned long idle_count, unsigned long count) {
+	Serial.print(label);
+	Serial.print(" load: ");
+	Serial.print(100.0 * (idle_count - count) / idle_count);
+	Serial.println("%");
+}
+
+void runSoftPwmBenchmark() {
+	for (byte i = 0; i < LED_COUNT; i++) {
+		soft_pwm.write(LED_PINS[i], 85 + i * 34); //a mix of brightness values so every slice has work to do
+	}
+	unsigned long idle_count = countLoopsInOneSecond();
+
+	soft_pwm.begin(SoftPwm::REFRESH_245_HZ);
+	printLoad("245 Hz", idle_count, countLoopsInOneSecond());
+
+	soft_pwm.begin(SoftPwm::REFRESH_490_HZ);
+	printLoad("490 Hz", idle_count, countLoopsInOneSecond());
+
+	soft_pwm.end();
+	for (byte i = 0; i < LED_COUNT; i++) {
+		soft_pwm.write(LED_PINS[i], 0);
+	}
+}
+#endif
@@ -1,13 +1,25 @@
 /*
 //Functions Used:
  * - unsigned int: A 16 bit value containing numbers from 0 to 65535
- * - Serial Monitor: Allows the HERO to display text in an Arduino IDE window.
- * - Serial.begin(): Used to initialize the Serial Monitor.
- * - Serial.print(): Display some text in the Arduino IDE Serial Monitor window.
- * - Serial.println(): Display test in the Serial Monitor followed by a newline.
+ * - Serial.begin(): Used to initialize the Serial port that sends our values to the computer.
+ * - telemetry.addChannel(): Name a value we want to send (see telemetry.h).
+ * - telemetry.send(): Send a value as a few binary bytes.  The Serial Monitor can't show
+ *   these - run telemetry_decode.py on the computer to see them as CSV or a live plot.
  * - analogRead(): Read a value from an analog pin that is based on how much voltage is on the pin (0-5v)
  */
 
+// Explicitly include Arduino.h
+#include "Arduino.h"
+
+// Runs our light reading, blinking and sending each at its own speed, without delay()
+#include "task_scheduler.h"
+
+// Sleeps between interrupts when there's nothing to do, instead of spinning
+#include "idle_sleep.h"
+
+// Sends our values in a few binary bytes each (read them with telemetry_decode.py)
+#include "telemetry.h"
+
 // A0 is a label specifically for analog reading
 // Our photoresistor will connect to this and give us a reading of the current light level 
 const byte PHOTORESISTOR_PIN = A0;
@@ -18,6 +30,28 @@ const byte PHOTORESISTOR_PIN = A0;
 const unsigned int MIN_DELAY = 50;   // 50 ms shortest blink delay
 const unsigned int MAX_DELAY = 500;  // 500 ms longest blink delay
 
+// How often (in ms) each of our tasks runs.  The blink task starts at MAX_DELAY and
+// is sped up or slowed down by the light reading.
+const unsigned int LIGHT_READ_INTERVAL = 20;  // read the photoresistor 50 times a second
+const unsigned int SEND_INTERVAL = 500;       // send values twice a second
+
+// Uncomment to print how long each task takes, and how much of the time we were
+// awake, every STATS_INTERVAL ms
+//#define PRINT_TASK_STATS
+const unsigned long STATS_INTERVAL = 10000;
+
+// The scheduler runs each task when it is due.  Our loop() simply calls scheduler.run().
+TaskScheduler scheduler;
+byte blink_task;  // task number of blinkLed(), so readLight() can change its speed
+
+// Values shared between our tasks
+unsigned int light_value = 0;          // last light reading
+unsigned int delay_value = MAX_DELAY;  // ms the LED stays on (and off) each blink
+
+// Telemetry channel numbers for our values
+byte light_channel;
+byte delay_channel;
+
 // One time setup
 void setup() {
   // We will blink our build in LED based on amount of light received from our photoresistor
@@ -25,17 +59,41 @@ void setup() {
   pinMode(PHOTORESISTOR_PIN, INPUT);  // input value from analog pin connected to photoresistor
 
   /*
-   * To show you the exact value being read on the analog pin we will print the exact number using our Arduino IDE's "Serial Monitor".
-   * The speed that this data is sent/received must match between the Arduino IDE and HERO.
+   * To show you the exact value being read on the analog pin we will send the exact number to the computer over the Serial port.
+   * The speed that this data is sent/received must match between telemetry_decode.py (--baud) and HERO.
    * We configure this speed for the HERO to send data using the Serial.begin() function. using 9600 for 9600 bits of info per second
    */
   Serial.begin(9600);
+
+  // Instead of printing text we send each value as a small binary frame, which
+  // never makes us wait for the Serial port.  Run telemetry_decode.py on the
+  // computer (instead of the Serial Monitor) to see them.
+  light_channel = telemetry.addChannel(F("light"));
+  delay_channel = telemetry.addChannel(F("delay"));
+
+  // Tasks due at the same time run in the order they are added here, so a new light
+  // reading is always used by the blink and send tasks straight away.
+  scheduler.every(LIGHT_READ_INTERVAL, readLight, F("light"));
+  blink_task = scheduler.every(delay_value, blinkLed, F("blink"));
+  scheduler.every(SEND_INTERVAL, sendValues, F("send"));
+#ifdef PRINT_TASK_STATS
+  scheduler.every(STATS_INTERVAL, printTaskStats, F("stats"));
+#endif
 }
 
-// The loop() function is called over and over when sketch is run.
+// The loop() function is called over and over when sketch is run.  All of the work is
+// done by the tasks below, and loop() never waits, so no task has to wait for another.
+// When no task was due we sleep until the next interrupt (at most about 1 ms).
 void loop() {
+  if (scheduler.run() == 0) {
+    idle_sleep.sleep();
+  }
+}
+
+// Read the photoresistor and work out how fast to blink.
+void readLight() {
   /*
-   * Each time through our loop() we will read the current value of our photoresistor.  When
+   * Each time this task runs we will read the current value of our photoresistor.  When
    * the voltage goes up from more light we flash the built-in LED faster (with shorter blinks).
    *
    * These pins will convert a voltage from 0V to 5V to a number from 0 to 1023, giving us
@@ -44,16 +102,14 @@ void loop() {
    *
    * Here we use the reading from the PHOTORESISTOR_PIN and modify how long we delay based on it.
    */
-  unsigned int light_value = analogRead(PHOTORESISTOR_PIN);   // light value from 0 to 1024
-  Serial.print("Light value: ");  // Display label string to serial monitor
-  Serial.print(light_value);      // display the value read from our photoresistor
+  light_value = analogRead(PHOTORESISTOR_PIN);   // light value from 0 to 1024
 
   /*
    * The flash rate varies based on the relative brightness received by the photoresistor. So we add the below static values to keep the 
    * specific room's brightest and dimmest light to set the range when this is run
    *
-   * These values would normally be lost when each run of our loop() ends, but by adding
-   * the "static" declaration we indicate that these local variables should maintain their values between loop() runs.
+   * These values would normally be lost when each run of our task ends, but by adding
+   * the "static" declaration we indicate that these local variables should maintain their values between runs.
    */
   static unsigned int darkest_light = light_value;    // this is the lowest value returned by the photoresistor
   static unsigned int brightest_light = light_value;  // this is the highest value returned by the photoresistor
@@ -80,13 +136,30 @@ void loop() {
    *we map it to 0-100
    * this properly matches our brightness/dimness level to our delay between blink times
    */
-  unsigned int delay_value = map(light_value, darkest_light, brightest_light, MAX_DELAY, MIN_DELAY);
-  Serial.print(", Delay value: ");  // display label after light_value
-  Serial.println(delay_value);      // display delay_value returned by map() function with newline
-
-  // now blink our built in LED using our delay_value.
-  digitalWrite(LED_BUILTIN, HIGH);  // Turn on LED
-  delay(delay_value);               // Leave on delay_value milliseconds
-  digitalWrite(LED_BUILTIN, LOW);   // Turn off LED
-  delay(delay_value);               // Leave off delay_value milliseconds
-}
\ No newline at end of file
+  // (Until we have seen two different light values map() has no range to work with.)
+  if (brightest_light > darkest_light) {
+    delay_value = map(light_value, darkest_light, brightest_light, MAX_DELAY, MIN_DELAY);
+  }
+  scheduler.setPeriod(blink_task, delay_value);  // blink at the new speed
+}
+
+// Blink our built in LED: each run turns it on if it was off, or off if it was on, so it
+// stays on for delay_value milliseconds and then off for delay_value milliseconds.
+void blinkLed() {
+  digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+}
+
+// Send our values, at a steady rate however fast the LED is blinking.  Each one is
+// 7 bytes, instead of 36 characters for "Light value: 523, Delay value: 245".
+void sendValues() {
+  telemetry.send(light_channel, light_value);  // the value read from our photoresistor
+  telemetry.send(delay_channel, delay_value);  // delay_value returned by map() function
+}
+
+#ifdef PRINT_TASK_STATS
+// Show how often each task ran and how long it took, and how busy we were
+void printTaskStats() {
+  scheduler.printStats(Serial);
+  idle_sleep.printDutyCycle(Serial);
+}
+#endif
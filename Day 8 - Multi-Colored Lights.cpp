@@ -11,6 +11,7 @@
  * Arduino concepts introduced/documented in this lesson.
  * - analogWrite(): Used to control a PWM pin, giving a variable intensity
  * - Passing variables into functions
+ * - Playing a list of colors stored in flash (PROGMEM) without delay()
  *
  * Parts and electronics concepts introduced in this lesson.
  * - Common Cathode (single grounded pin) RGB LED.
@@ -19,6 +20,12 @@
 // Explicitly include Arduino.h
 #include "Arduino.h"
 
+// Gamma table so equal steps in intensity look like equal steps in brightness
+#include "gamma_table.h"
+
+// Keyframe animation engine that plays our color show without delay()
+#include "color_animation.h"
+
 /*
  * Each color in an RGB LED is controlled with a different pin on our HERO board.
  *
@@ -37,6 +44,8 @@ const byte BLUE_PIN = 9;    // PWM pin ccontrolling the blue leg of our RGB LED
  * to 255 which we will demonstrate by adding 64 (roughly 1/4 of that range) to
  * each preceding value.
  *
+ * displayColor() passes these through gammaCorrect(), so each step of 64 LOOKS
+ * like the same jump in brightness instead of a big jump at the dim end.
  */
 const byte OFF = 0;                 // Selected color is OFF
 const byte DIM = 64;                // Selected color is 1/4 intensity
@@ -65,50 +74,55 @@ void displayColor(
   byte green_intensity,  // green LED intensity (0-255)
   byte blue_intensity    // blue LED intensity (0-255)
 ) {
-  analogWrite(RED_PIN, red_intensity);      // Set red LED intensity using PWM
-  analogWrite(GREEN_PIN, green_intensity);  // Set green LED intensity using PWM
-  analogWrite(BLUE_PIN, blue_intensity);    // Set blue LED intensity using PWM
+  analogWrite(RED_PIN, gammaCorrect(red_intensity));      // Set red LED intensity using PWM
+  analogWrite(GREEN_PIN, gammaCorrect(green_intensity));  // Set green LED intensity using PWM
+  analogWrite(BLUE_PIN, gammaCorrect(blue_intensity));    // Set blue LED intensity using PWM
 }
 
+/*
+ * Our color show is a list of "keyframes".  Each one is a color, how to get
+ * there (EASE_STEP jumps straight to it, EASE_IN_OUT fades smoothly) and how
+ * many milliseconds that takes.  PROGMEM keeps the list in flash memory so it
+ * doesn't use any of our small amount of RAM.
+ */
+const ColorKeyframe COLOR_SHOW[] PROGMEM = {
+  // First demonstrate our different PWM levels by slowly brightening our red LED
+  { OFF, OFF, OFF, EASE_STEP, COLOR_DELAY },        // OFF!
+  { DIM, OFF, OFF, EASE_STEP, COLOR_DELAY },        // Display red LED at 1/4 intensity
+  { BRIGHTER, OFF, OFF, EASE_STEP, COLOR_DELAY },   // Display red LED at 1/2 intensity
+  { BRIGHT, OFF, OFF, EASE_STEP, COLOR_DELAY },     // Display red LED at 3/4 intensity
+  { BRIGHTEST, OFF, OFF, EASE_STEP, COLOR_DELAY },  // Display red LED at FULL intensity
+
+  // Display our other two LED colors at 3/4 intensity
+  { OFF, BRIGHT, OFF, EASE_STEP, COLOR_DELAY },  // Display the green LED
+  { OFF, OFF, BRIGHT, EASE_STEP, COLOR_DELAY },  // Display the blue LED
+
+  // Now fade smoothly between colors made by mixing our three colors
+  { BRIGHT, BRIGHT, OFF, EASE_IN_OUT, COLOR_DELAY },    // yellow by mixing red and green LEDs
+  { OFF, BRIGHT, BRIGHT, EASE_IN_OUT, COLOR_DELAY },    // cyan by mixing green and blue LEDs
+  { BRIGHT, OFF, BRIGHT, EASE_IN_OUT, COLOR_DELAY },    // magenta by mixing red and blue LEDs
+  { BRIGHT, BRIGHT, BRIGHT, EASE_IN_OUT, COLOR_DELAY }  // all of our LEDs to get white
+};
+
+// Number of keyframes in our show
+const byte COLOR_SHOW_LENGTH = sizeof(COLOR_SHOW) / sizeof(COLOR_SHOW[0]);
+
+// The animation engine shows each color by calling our displayColor() function
+ColorAnimation color_show(displayColor);
+
 
 void setup() {
   // Set each of our PWM pins as OUTPUT pins
   pinMode(RED_PIN, OUTPUT);
   pinMode(GREEN_PIN, OUTPUT);
   pinMode(BLUE_PIN, OUTPUT);
+
+  color_show.play(COLOR_SHOW, COLOR_SHOW_LENGTH);  // start the show, repeating forever
 }
 
-// Each time through loop() we display some of the color variations available
-// using an RGB LED.
+// Each time through loop() we let our color show update the LED.  update()
+// returns right away, so there is plenty of time left in loop() to do other work.
 void loop() {
-  // First demonstrate our different PWM levels by slowly brightening our red LED
-  displayColor(OFF, OFF, OFF);  // OFF!
-  delay(COLOR_DELAY);
-  displayColor(DIM, OFF, OFF);  // Display red LED at 1/4 intensity
-  delay(COLOR_DELAY);
-  displayColor(BRIGHTER, OFF, OFF);  // Display red LED at 1/2 intensity
-  delay(COLOR_DELAY);
-  displayColor(BRIGHT, OFF, OFF);  // Display red LED at 3/4 intensity
-  delay(COLOR_DELAY);
-  displayColor(BRIGHTEST, OFF, OFF);  // Display red LED at FULL intensity
-  delay(COLOR_DELAY);
-
-  // Display our other two LED colors at half intensity
-  displayColor(OFF, BRIGHT, OFF);  // Display the green LED
-  delay(COLOR_DELAY);
-  displayColor(OFF, OFF, BRIGHT);  // Display the blue LED
-  delay(COLOR_DELAY);
-
-  // Now show various colors (at half intensity) by mixing our three colors
-  displayColor(BRIGHT, BRIGHT, OFF);  // Display yellow by mixing red and green LEDs
-  delay(COLOR_DELAY);
-  displayColor(OFF, BRIGHT, BRIGHT);  // Display cyan by mixing green and blue LEDs
-  delay(COLOR_DELAY);
-  displayColor(BRIGHT, OFF, BRIGHT);  // Display magenta by mixing red and blue LEDs
-  delay(COLOR_DELAY);
-
-  // Display all of our LEDs to get white.
-  displayColor(BRIGHT, BRIGHT, BRIGHT);  // white
-  delay(COLOR_DELAY);
+  color_show.update(millis());
 }
 
@@ -9,6 +9,27 @@
 // Explicitly include Arduino.h
 #include "Arduino.h"
 
+// Integer filters to smooth out our noisy photoresistor readings
+#include "sensor_filter.h"
+
+// Gamma table so our LED intensities match how bright they look
+#include "gamma_table.h"
+
+// Battery model that charges by elapsed time instead of once per loop()
+#include "battery_model.h"
+
+// Keyframe animation engine so the red warning light pulses without delay()
+#include "color_animation.h"
+
+// Runs reading, charging, the battery light and sending each at its own speed
+#include "task_scheduler.h"
+
+// Sleeps between interrupts when there's nothing to do, instead of spinning
+#include "idle_sleep.h"
+
+// Sends our charge in a few binary bytes (read it with telemetry_decode.py)
+#include "telemetry.h"
+
 // Our photoresistor will give us a reading of the current light level on this analog pin
 const byte PHOTORESISTOR_PIN = A0;  // Photoresistor analog pin
 
@@ -19,20 +40,57 @@ const byte BLUE_PIN = 9;    // pin ccontrolling the blue leg of our RGB LED
 
 const unsigned long BATTERY_CAPACITY = 50000;  // Maximum battery capacity
 
+// Our battery gets one "charge" of light for every 100 ms of real time.  The
+// model counts elapsed time with millis(), so the pulsing red LED or a slower
+// Serial Monitor no longer changes how fast the battery charges.
+const unsigned int CHARGE_STEP_MS = 100;
+BatteryModel battery(BATTERY_CAPACITY, CHARGE_STEP_MS);
+
+// Smooth the light readings before we add them to the battery so a flicker
+// or noisy reading doesn't show up as a jump in charge.
+EmaFilter<3> light_filter;  // each reading moves the average 1/8 of the way
+
+// How often (in ms) each of our tasks runs.  The battery is charged in CHARGE_STEP_MS
+// steps, so it is checked at that rate.
+const unsigned long LIGHT_READ_INTERVAL = 10;  // read the photoresistor into our filter
+const unsigned long ANIMATION_INTERVAL = 20;   // move the battery light along (50 times a second)
+const unsigned long SEND_INTERVAL = 100;       // send the charge percentage 10 times a second
+
+// Uncomment to print how long each task takes, and how much of the time we were
+// awake, every STATS_INTERVAL ms (telemetry_decode.py shows the text on stderr)
+//#define PRINT_TASK_STATS
+const unsigned long STATS_INTERVAL = 10000;
+
+// The scheduler runs each task when it is due.  Our loop() simply calls scheduler.run().
+TaskScheduler scheduler;
+
+byte charge_channel;  // telemetry channel number for our charge percentage
+
 /*
  * Display a color on our RGB LED by providing an intensity for
- * our red, green and blue LEDs.
+ * our red, green and blue LEDs.  Intensities are gamma corrected
+ * so they match how bright the LED looks.
  */
 void displayColor(
   byte red_intensity,    // red LED intensity (0-255)
   byte green_intensity,  // green LED intensity (0-255)
   byte blue_intensity    // blue LED intensity (0-255)
 ) {
-  analogWrite(RED_PIN, red_intensity);      // write red LED intensity using PWM
-  analogWrite(GREEN_PIN, green_intensity);  // write green LED intensity using PWM
-  analogWrite(BLUE_PIN, blue_intensity);    // write blue LED intensity using PWM
+  analogWrite(RED_PIN, gammaCorrect(red_intensity));      // write red LED intensity using PWM
+  analogWrite(GREEN_PIN, gammaCorrect(green_intensity));  // write green LED intensity using PWM
+  analogWrite(BLUE_PIN, gammaCorrect(blue_intensity));    // write blue LED intensity using PWM
 }
 
+// Low battery warning: fade red smoothly down to off and back up again, over and over.
+const ColorKeyframe LOW_BATTERY_PULSE[] PROGMEM = {
+  { 0, 0, 0, EASE_IN_OUT, 400 },    // fade out
+  { 128, 0, 0, EASE_IN_OUT, 400 },  // fade back in to red
+};
+const byte LOW_BATTERY_PULSE_LENGTH = sizeof(LOW_BATTERY_PULSE) / sizeof(LOW_BATTERY_PULSE[0]);
+
+// Shows our battery colors on the RGB LED through displayColor()
+ColorAnimation battery_light(displayColor);
+
 void setup() {
   // Declare the RGB LED pins as outputs:
   pinMode(RED_PIN, OUTPUT);
@@ -41,37 +99,71 @@ void setup() {
 
   // Start serial monitor
   Serial.begin(9600);
+
+  // Our charge is sent as a binary float (see telemetry.h), so the HERO doesn't
+  // have to turn it into text.  Run telemetry_decode.py on the computer to see it.
+  charge_channel = telemetry.addChannel(F("charge_pct"));
+
+  // Tasks due at the same time run in this order: read, charge, show, send.
+  scheduler.every(LIGHT_READ_INTERVAL, readLight, F("light"));
+  scheduler.every(CHARGE_STEP_MS, chargeBattery, F("charge"));
+  scheduler.every(ANIMATION_INTERVAL, showBatteryLevel, F("show"));
+  scheduler.every(SEND_INTERVAL, sendCharge, F("send"));
+#ifdef PRINT_TASK_STATS
+  scheduler.every(STATS_INTERVAL, printTaskStats, F("stats"));
+#endif
 }
 
+// All of the work is done by the tasks below.  loop() never waits, so the pulsing red
+// light stays smooth (and sending never waits for the Serial port either).  When no task was due we sleep
+// until the next interrupt (at most about 1 ms).
 void loop() {
-  // Use static because we need this variable to maintain it's value across
-  // multiple loop() runs.
-  static unsigned long battery_level = 0;  // Current battery charge level (set to 0 first time used)
-  //using the 'static' ensures that  the battery level maintains what it was at the end of the last loop, so it won't reset to 0 each time it loops
+  if (scheduler.run() == 0) {
+    idle_sleep.sleep();
+  }
+}
 
-  battery_level += analogRead(PHOTORESISTOR_PIN);  // Add current "charge amount" to our battery
+// Battery charge percentage
+float chargePercentage() {
+  return ((float)battery.level() / (float)BATTERY_CAPACITY) * 100;
+}
 
-  // We can't charge the battery higher than it's capacity, set level as full if it goes over
-  if (battery_level > BATTERY_CAPACITY) {
-    battery_level = BATTERY_CAPACITY;
-  }
+// Add a new photoresistor reading to our smoothing filter.
+void readLight() {
+  light_filter.update(analogRead(PHOTORESISTOR_PIN));
+}
+
+// Add the current "charge amount" to our battery once for each 100 ms step that
+// has passed.  The model stops at capacity, so the battery can't charge past full.
+void chargeBattery() {
+  battery.update(millis(), light_filter.value());
+}
 
-  // Compute battery charge percentage from our function
-  float percentage = ((float)battery_level / (float)BATTERY_CAPACITY) * 100;
+// Show the battery level on our RGB LED.
+void showBatteryLevel() {
+  float percentage = chargePercentage();
 
-  if (percentage >= 50.0) {     // battery level is OK, display green
-    displayColor(0, 128, 0);  // display green
+  if (percentage >= 50.0) {          // battery level is OK, display green
+    battery_light.show(0, 128, 0);  // display green
   } else if (percentage >= 25.0 && percentage < 50.0) {
-    displayColor(128, 80, 0);  // display yellow-ish/amber for early warning
-  } else {                     // Level must be less than 25%, display "pulsating" red
-    // To pulsate the red light we briefly turn the LED off and then display red, giving it
-    // a pulsating effect.
-    displayColor(0, 0, 0);    // Turn off our LED
-    delay(20);                // ...and delay briefly
-    displayColor(128, 0, 0);  // then display red
+    battery_light.show(128, 80, 0);  // display yellow-ish/amber for early warning
+  } else if (!battery_light.isPlaying(LOW_BATTERY_PULSE)) {
+    // Level must be less than 25%, start the "pulsating" red animation (once - it keeps
+    // repeating by itself while we keep calling update() below).
+    battery_light.play(LOW_BATTERY_PULSE, LOW_BATTERY_PULSE_LENGTH);
   }
-  Serial.print(percentage);  // Display our floating point percentage (like 12.34) WITHOUT a newline
-  Serial.println("%");       // then display the percent sign ("%") with a newline.
+  battery_light.update(millis());  // move the pulse along, returns right away
+}
+
+// Send the charge percentage, as the float itself (like 12.34).
+void sendCharge() {
+  telemetry.send(charge_channel, chargePercentage());
+}
 
-  delay(100);  // Delay 1/10 of a second so displayed values don't scroll too fast
+#ifdef PRINT_TASK_STATS
+// Show how often each task ran and how long it took, and how busy we were
+void printTaskStats() {
+  scheduler.printStats(Serial);
+  idle_sleep.printDutyCycle(Serial);
 }
+#endif
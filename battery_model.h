@@ -0,0 +1,93 @@
+/*
+ * battery_model.h
+ *
+ * Simulated battery that charges at a steady rate no matter how fast or slow
+ * our loop() runs.
+ *
+ * Adding the light reading to the battery once per loop() means the battery
+ * charges faster or slower whenever the loop changes speed, for example if we
+ * print more text or change the Serial baud rate.  Instead, this model adds
+ * charge in fixed "steps" of simulated time (CHARGE_STEP_MS).  Each time we
+ * call update() it works out how many whole steps have passed since the last
+ * step, using millis(), and adds the charge for each of them ("catching up"
+ * if the loop was slow).  Time left over is kept for the next update().
+ *
+ * The result only depends on how much time has passed and the light level, so
+ * the battery charges the same way whether loop() takes 10 ms or 500 ms.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "battery_model.h"
+ */
+
+#ifndef BATTERY_MODEL_H
+#define BATTERY_MODEL_H
+
+#include "Arduino.h"
+
+class BatteryModel {
+public:
+  // If loop() stalls for longer than this many steps (for example while the
+  // HERO is busy elsewhere) we only catch up this far and drop the rest, so one
+  // long stall can't make us sit in update() for a long time.
+  static const unsigned int MAX_CATCH_UP_STEPS = 600;
+
+  BatteryModel(unsigned long capacity, unsigned int step_ms)
+    : battery_capacity(capacity), step_length(step_ms), battery_level(0), last_step_time(0), started(false) {}
+
+  /*
+   * Move the simulation forward to "now" (normally millis()), adding
+   * "charge_per_step" for every whole step that has passed.  The first call
+   * only starts the clock.  Returns the number of steps that were added.
+   */
+  unsigned int update(unsigned long now, unsigned int charge_per_step) {
+    if (!started) {
+      last_step_time = now;
+      started = true;
+      return 0;
+    }
+
+    unsigned long steps = (now - last_step_time) / step_length;  // whole steps since last step
+    if (steps > MAX_CATCH_UP_STEPS) {
+      last_step_time = now - (now - last_step_time) % step_length;  // skip what we can't catch up
+      steps = MAX_CATCH_UP_STEPS;
+    } else {
+      last_step_time += steps * step_length;  // keep left over time for next update()
+    }
+
+    // Add charge for all steps at once, stopping at full capacity.
+    unsigned long room = battery_capacity - battery_level;
+    unsigned long charge = steps * charge_per_step;
+    battery_level += (charge < room) ? charge : room;
+    return steps;
+  }
+
+  // Current charge level, from 0 to capacity().
+  unsigned long level() const {
+    return battery_level;
+  }
+
+  // Charge level when the battery is full.
+  unsigned long capacity() const {
+    return battery_capacity;
+  }
+
+  // true once the battery has reached capacity.
+  bool isFull() const {
+    return battery_level >= battery_capacity;
+  }
+
+  // Set the battery back to empty and restart the clock.
+  void reset() {
+    battery_level = 0;
+    started = false;
+  }
+
+private:
+  unsigned long battery_capacity;  // level when fully charged
+  unsigned int step_length;        // length of one simulated step in milliseconds
+  unsigned long battery_level;     // current charge level
+  unsigned long last_step_time;    // millis() value at the end of the last whole step
+  bool started;                    // false until the first update()
+};
+
+#endif  // BATTERY_MODEL_H
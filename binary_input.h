@@ -0,0 +1,81 @@
+/*
+ * binary_input.h
+ *
+ * Read a group of switches as one binary number, and only report the number
+ * once all of the switches have stopped moving.
+ *
+ * Day 27 uses three switches as the bits of a number from 0 to 7.  Changing
+ * from 3 (0b011) to 4 (0b100) moves all three switches, and they never move
+ * at exactly the same moment, so reading part way through can give 0, 1, 2,
+ * 5, 6 or 7 for a moment.  Debouncing each switch separately doesn't help -
+ * each switch IS steady, just at different times.
+ *
+ * A BinaryInput reads every switch at the same moment (using InputSnapshot
+ * from input_snapshot.h) and only accepts a new number once it has read
+ * exactly the same number for "settle_ms" milliseconds.  update() returns true
+ * when that happens, so the sketch only needs to redraw when the number
+ * really changes:
+ *
+ *   BinaryInput<A2, A1, A0> switch_input(50);  // bit 0 = A2, bit 1 = A1, bit 2 = A0
+ *
+ *   if (switch_input.update(millis())) {
+ *     showPicture(switch_input.value());
+ *   }
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "binary_input.h"
+ */
+
+#ifndef BINARY_INPUT_H
+#define BINARY_INPUT_H
+
+#include "Arduino.h"
+#include "input_snapshot.h"
+
+template <byte... PINS>
+class BinaryInput {
+public:
+  // value() before the first number has settled.  Never a real value, since
+  // at most 8 pins make up the number.
+  static const int NO_VALUE = -1;
+
+  BinaryInput(unsigned int settle_ms)
+    : settle_time(settle_ms), stable_value(NO_VALUE), candidate(NO_VALUE), candidate_time(0) {}
+
+  // pinMode(pin, INPUT) for every switch.
+  void input() {
+    InputSnapshot<PINS...>::input();
+  }
+
+  /*
+   * Read the switches.  Returns true if a new number has settled (including
+   * the very first one), false otherwise.  Call this every time through
+   * loop() with millis().
+   */
+  bool update(unsigned long now) {
+    byte reading = InputSnapshot<PINS...>::read();
+    if (reading != candidate) {
+      candidate = reading;  // still moving, start timing again
+      candidate_time = now;
+      return false;
+    }
+    if (candidate != stable_value && now - candidate_time >= settle_time) {
+      stable_value = candidate;
+      return true;
+    }
+    return false;
+  }
+
+  // Last settled number, or NO_VALUE if no number has settled yet.
+  int value() const {
+    return stable_value;
+  }
+
+private:
+  unsigned int settle_time;      // ms a reading must stay the same before it is accepted
+  int stable_value;              // last settled number
+  int candidate;                 // latest reading
+  unsigned long candidate_time;  // millis() when "candidate" was first read
+};
+
+#endif  // BINARY_INPUT_H
@@ -0,0 +1,190 @@
+/*
+ * color_animation.h
+ *
+ * Play a "color show" on our RGB LED without using delay().
+ *
+ * A show is a list of keyframes stored in flash (PROGMEM).  Each keyframe is a
+ * color, how long to take getting there, and how to get there (the "easing"):
+ *
+ *   const ColorKeyframe SUNSET[] PROGMEM = {
+ *     // red, green, blue, easing,      duration (ms)
+ *     { 255, 128, 0, EASE_IN_OUT, 2000 },  // fade to orange over 2 seconds
+ *     { 64, 0, 32, EASE_LINEAR, 3000 },    // then to purple over 3 seconds
+ *   };
+ *
+ * Call update(millis()) every time through loop().  The animation works out
+ * where it should be from the time and sets the LED, then returns right away
+ * so the rest of loop() keeps running while the colors change.  All of the
+ * blending uses whole number math.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "color_animation.h"
+ */
+
+#ifndef COLOR_ANIMATION_H
+#define COLOR_ANIMATION_H
+
+#include "Arduino.h"
+
+// How to move from the previous color to a keyframe's color.
+enum ColorEasing {
+  EASE_STEP,    // jump straight to the color and hold it for the duration
+  EASE_LINEAR,  // blend at a constant speed
+  EASE_IN,      // start slowly, finish quickly
+  EASE_OUT,     // start quickly, finish slowly
+  EASE_IN_OUT   // start and finish slowly (smoothest looking)
+};
+
+struct ColorKeyframe {
+  byte red;                  // red LED intensity (0-255)
+  byte green;                // green LED intensity (0-255)
+  byte blue;                 // blue LED intensity (0-255)
+  byte easing;               // one of the ColorEasing values
+  unsigned int duration_ms;  // time to reach (or, for EASE_STEP, to hold) this color
+};
+
+class ColorAnimation {
+public:
+  // A function that shows a color, like displayColor() in our sketches.
+  typedef void (*ColorWriter)(byte red, byte green, byte blue);
+
+  ColorAnimation(ColorWriter color_writer)
+    : writer(color_writer), keyframes(NULL), keyframe_count(0), keyframe_index(0),
+      repeat(false), playing(false) {
+    from[0] = from[1] = from[2] = 0;
+    current[0] = current[1] = current[2] = 0;
+  }
+
+  /*
+   * Start playing a list of keyframes stored in PROGMEM.  The show starts from
+   * whatever color is showing now.  If "repeat_show" is true the show starts
+   * over after the last keyframe, otherwise it stops on the last color.
+   */
+  void play(const ColorKeyframe *show, byte count, bool repeat_show = true) {
+    keyframes = show;
+    keyframe_count = count;
+    repeat = repeat_show;
+    playing = (count > 0);
+    if (playing) {
+      startKeyframe(0, millis());
+    }
+  }
+
+  // Stop the show, leaving the current color on the LED.
+  void stop() {
+    playing = false;
+  }
+
+  // Stop any show and display a single color right away.
+  void show(byte red, byte green, byte blue) {
+    playing = false;
+    setColor(red, green, blue);
+  }
+
+  // true while a show is running.
+  bool isPlaying() const {
+    return playing;
+  }
+
+  // true if "show" is the list of keyframes currently playing.
+  bool isPlaying(const ColorKeyframe *show) const {
+    return playing && keyframes == show;
+  }
+
+  /*
+   * Move the show forward to "now" (normally millis()) and update the LED.
+   * Call this every time through loop().
+   */
+  void update(unsigned long now) {
+    if (!playing) {
+      return;
+    }
+
+    // Finish any keyframes whose time is up.  Each one starts exactly when the
+    // last one ended so the show never drifts, even if update() is late.
+    // (Limited to one pass through the show in case every duration is 0.)
+    for (byte passes = 0; now - keyframe_start >= target.duration_ms; passes++) {
+      if (passes > keyframe_count) {
+        keyframe_start = now;
+        return;
+      }
+      unsigned long next_start = keyframe_start + target.duration_ms;
+      setColor(target.red, target.green, target.blue);
+      if (keyframe_index + 1 < keyframe_count) {
+        startKeyframe(keyframe_index + 1, next_start);
+      } else if (repeat) {
+        startKeyframe(0, next_start);
+      } else {
+        playing = false;  // show is over, leave the last color showing
+        return;
+      }
+    }
+
+    // Blend from the starting color toward the keyframe color.  "progress"
+    // goes from 0 at the start of the keyframe to 256 at the end.
+    unsigned int progress = ((now - keyframe_start) << 8) / target.duration_ms;
+    unsigned int amount = ease(target.easing, progress);
+    setColor(blend(from[0], target.red, amount),
+             blend(from[1], target.green, amount),
+             blend(from[2], target.blue, amount));
+  }
+
+private:
+  // Load keyframe "index" from flash, starting from the color showing now.
+  void startKeyframe(byte index, unsigned long start_time) {
+    keyframe_index = index;
+    memcpy_P(&target, &keyframes[index], sizeof(target));
+    keyframe_start = start_time;
+    from[0] = current[0];
+    from[1] = current[1];
+    from[2] = current[2];
+    if (target.easing == EASE_STEP) {
+      setColor(target.red, target.green, target.blue);
+    }
+  }
+
+  // Only write to the LED when the color actually changes.
+  void setColor(byte red, byte green, byte blue) {
+    if (red != current[0] || green != current[1] || blue != current[2]) {
+      current[0] = red;
+      current[1] = green;
+      current[2] = blue;
+      writer(red, green, blue);
+    }
+  }
+
+  // Bend progress (0-256) along the easing curve, still 0-256.
+  static unsigned int ease(byte easing, unsigned int progress) {
+    unsigned long p = progress;
+    switch (easing) {
+      case EASE_STEP:
+        return 256;  // already showing the final color
+      case EASE_IN:
+        return (p * p) >> 8;
+      case EASE_OUT:
+        return 256 - (((256 - p) * (256 - p)) >> 8);
+      case EASE_IN_OUT:  // "smoothstep": 3p^2 - 2p^3
+        return (p * p * (768 - 2 * p)) >> 16;
+      default:  // EASE_LINEAR
+        return progress;
+    }
+  }
+
+  // Color part "amount"/256 of the way from "start" to "end".
+  static byte blend(byte start, byte end, unsigned int amount) {
+    return start + (((long)end - start) * amount >> 8);
+  }
+
+  ColorWriter writer;              // shows a color on the LED
+  const ColorKeyframe *keyframes;  // keyframe list in PROGMEM
+  byte keyframe_count;             // number of keyframes in the list
+  byte keyframe_index;             // keyframe being played
+  bool repeat;                     // start over after the last keyframe
+  bool playing;                    // false when stopped or finished
+  ColorKeyframe target;            // copy of the current keyframe from flash
+  unsigned long keyframe_start;    // millis() value when the current keyframe began
+  byte from[3];                    // color when the current keyframe began
+  byte current[3];                 // color showing now
+};
+
+#endif  // COLOR_ANIMATION_H
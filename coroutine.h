@@ -0,0 +1,213 @@
+/*
+ * coroutine.h
+ *
+ * Write a sequence of steps as plain top-to-bottom code, without it stopping
+ * everything else while it waits.
+ *
+ * Sequences like "blink 4 times, then count down, then show dOnE" are easiest
+ * to read written out in order with delay() between the steps - but while
+ * delay() (or waitForKey()) waits, nothing else can happen.  A "coroutine" is
+ * a function that can stop part way through, return to loop(), and carry on
+ * from the same place the next time it is called ("resumed"):
+ *
+ *   void blinkTwice(Coroutine &co) {
+ *     COROUTINE_BEGIN(co);
+ *     digitalWrite(LED_PIN, HIGH);
+ *     COROUTINE_AWAIT_MS(500);      // return now, carry on here 500 ms later
+ *     digitalWrite(LED_PIN, LOW);
+ *     COROUTINE_AWAIT_MS(500);
+ *     digitalWrite(LED_PIN, HIGH);
+ *     COROUTINE_END();
+ *   }
+ *
+ *   Coroutine blinker(blinkTwice);
+ *
+ *   void loop() {
+ *     blinker.resume();  // runs until the next COROUTINE_AWAIT..., then returns
+ *     // ... anything else ...
+ *   }
+ *
+ * The waiting points are:
+ *   COROUTINE_YIELD()                  return, carry on next time
+ *   COROUTINE_AWAIT(condition)         carry on once condition is true
+ *   COROUTINE_AWAIT_MS(ms)             carry on once ms milliseconds have passed
+ *   COROUTINE_AWAIT_KEY(keypad, key)   carry on once a key is pressed (saved in key)
+ *   COROUTINE_CALL(other)              run another coroutine until it is done
+ *
+ * COROUTINE_EXIT() finishes a coroutine early, like return in a function.
+ *
+ * The coroutine only remembers WHERE it stopped (a line number) - not its
+ * local variables, so a coroutine shouldn't have any.  Use static or global
+ * variables for anything needed after a waiting point.  Each coroutine uses
+ * 24 bytes of RAM, most of it for the timing below.
+ *
+ * How it works: COROUTINE_BEGIN() starts a switch statement on the saved line
+ * number, and each waiting point saves its own line number, returns, and adds
+ * a "case" for that line, so the next resume() jumps straight back to it.  So
+ * there are two rules: only one waiting point per line, and no switch
+ * statements in the coroutine itself (call a function that uses one instead).
+ *
+ * resume() also times every resume with micros().  A resume that just checks
+ * a waiting point and returns is the cost of switching to the coroutine and
+ * back, so printStats() shows that as the shortest resume.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "coroutine.h"
+ */
+
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include "Arduino.h"
+
+class Coroutine;
+
+// A coroutine's steps: a function using the COROUTINE_... macros below.
+typedef void (*CoroutineFunction)(Coroutine &co);
+
+class Coroutine {
+public:
+  static const unsigned int START = 0;     // resume from the beginning
+  static const unsigned int DONE = 65535;  // reached COROUTINE_END()
+
+  Coroutine(CoroutineFunction body)
+    : line(START), wait_start(0), function(body) {
+    clearStats();
+  }
+
+  /*
+   * Carry on from where the coroutine last stopped, until its next waiting
+   * point.  Returns true if it is still running, false once it is done (a
+   * finished coroutine isn't run again until restart()).
+   */
+  bool resume() {
+    if (line == DONE) {
+      return false;
+    }
+    unsigned long start_time = micros();
+    function(*this);
+    unsigned long resume_time = micros() - start_time;
+
+    resumes++;
+    total_micros += resume_time;
+    if (resume_time < min_micros) {
+      min_micros = resume_time;
+    }
+    if (resume_time > max_micros) {
+      max_micros = resume_time;
+    }
+    return line != DONE;
+  }
+
+  // Start again from the beginning the next time resume() is called.
+  void restart() {
+    line = START;
+  }
+
+  bool isDone() const {
+    return line == DONE;
+  }
+
+  /*
+   * Print the resumes, and the shortest (the cost of switching to the
+   * coroutine and back), average and longest time in microseconds:
+   *   resumes,min_us,avg_us,max_us
+   *   5120,8,11,1840
+   */
+  void printStats(Print &out) const {
+    out.println(F("resumes,min_us,avg_us,max_us"));
+    out.print(resumes);
+    out.print(',');
+    out.print(resumes ? min_micros : 0);
+    out.print(',');
+    out.print(resumes ? total_micros / resumes : 0);
+    out.print(',');
+    out.println(max_micros);
+  }
+
+  void clearStats() {
+    resumes = 0;
+    total_micros = 0;
+    min_micros = 0xFFFFFFFF;
+    max_micros = 0;
+  }
+
+  // Used by the COROUTINE_... macros.
+  unsigned int line;         // where to carry on (START, a line number or DONE)
+  unsigned long wait_start;  // millis() when COROUTINE_AWAIT_MS() started waiting
+
+private:
+  CoroutineFunction function;
+  unsigned long resumes;       // times resume() ran the coroutine
+  unsigned long total_micros;  // time spent in those resumes
+  unsigned long min_micros;    // shortest resume
+  unsigned long max_micros;    // longest resume
+};
+
+// The first line of a coroutine.  "co" is its Coroutine& argument.
+#define COROUTINE_BEGIN(co)        \
+  Coroutine &coroutine_self_ = co; \
+  switch (coroutine_self_.line) {  \
+    case Coroutine::START:
+
+// The last line of a coroutine.  It is done, and resume() returns false.
+#define COROUTINE_END()                   \
+  }                                       \
+  coroutine_self_.line = Coroutine::DONE; \
+  return
+
+// Finish now, as if COROUTINE_END() had been reached.
+#define COROUTINE_EXIT()                    \
+  do {                                      \
+    coroutine_self_.line = Coroutine::DONE; \
+    return;                                 \
+  } while (0)
+
+// Return now and carry on from here the next time.
+#define COROUTINE_YIELD()            \
+  do {                               \
+    coroutine_self_.line = __LINE__; \
+    return;                          \
+    case __LINE__:;                  \
+  } while (0)
+
+// Tells the compiler that running on into the next "case" is meant, so
+// builds with all warnings on don't warn about every COROUTINE_AWAIT().
+#if defined(__GNUC__) && __GNUC__ >= 7
+#define COROUTINE_FALL_THROUGH_ __attribute__((fallthrough))
+#else
+#define COROUTINE_FALL_THROUGH_ \
+  do {                          \
+  } while (0)
+#endif
+
+// Return now, and every time after, until "condition" is true.
+#define COROUTINE_AWAIT(condition)   \
+  do {                               \
+    coroutine_self_.line = __LINE__; \
+    COROUTINE_FALL_THROUGH_;         \
+    case __LINE__:                   \
+      if (!(condition)) {            \
+        return;                      \
+      }                              \
+  } while (0)
+
+// Wait for "ms" milliseconds (like delay(), but other code runs meanwhile).
+#define COROUTINE_AWAIT_MS(ms)                                      \
+  do {                                                              \
+    coroutine_self_.wait_start = millis();                          \
+    COROUTINE_AWAIT(millis() - coroutine_self_.wait_start >= (ms)); \
+  } while (0)
+
+// Wait for a key on "keypad" (like waitForKey()), saving it in "key".
+#define COROUTINE_AWAIT_KEY(keypad, key)                 \
+  COROUTINE_AWAIT(((key) = (keypad).getKey()) != NO_KEY)
+
+// Run coroutine "other" from its beginning, waiting here until it is done.
+#define COROUTINE_CALL(other)           \
+  do {                                  \
+    (other).restart();                  \
+    COROUTINE_AWAIT(!(other).resume()); \
+  } while (0)
+
+#endif  // COROUTINE_H
@@ -0,0 +1,153 @@
+/*
+ * countdown_timer.h
+ *
+ * A countdown that ticks on the exact instant of each second, kept by the
+ * HERO's Timer1 (see cycle_clock.h).
+ *
+ * Working out the time left from millis() each time through loop() means the
+ * seconds on our display only change when loop() next gets around to it - up
+ * to a whole loop late.  countdown_timer instead sets the Timer1 alarm for the
+ * exact clock cycle of each second, so every second's interrupt comes right
+ * on time.  Each second is timed from the end of the one before (not from
+ * when the interrupt ran), so the countdown never drifts.
+ *
+ * The interrupt only marks that a second has passed.  loop() updates the
+ * display when it sees the mark - the interrupt also wakes the HERO if it is
+ * sleeping (see idle_sleep.h), so that is right away:
+ *
+ *   countdown_timer.start(70000);  // 70 seconds
+ *   ...
+ *   if (countdown_timer.secondPassed()) {
+ *     displayCounter(countdown_timer.remainingMillis());
+ *   }
+ *   if (countdown_timer.isFinished()) {
+ *     // liftoff!
+ *   }
+ *
+ * remainingMicros() gives the time left to the microsecond, whenever it is
+ * called.  Any length of countdown works, in whole milliseconds.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "countdown_timer.h"
+ */
+
+#ifndef COUNTDOWN_TIMER_H
+#define COUNTDOWN_TIMER_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "cycle_clock.h"
+
+class CountdownTimer {
+public:
+  static const unsigned long CYCLES_PER_SECOND = F_CPU;
+
+  CountdownTimer()
+    : running(false), finished(false), second_passed(false) {}
+
+  /*
+   * Start counting down "milliseconds" from now (starting cycle_clock too, if
+   * needed).  The first tick comes when the time left reaches a whole number
+   * of seconds, then one every second until 0.
+   */
+  void start(unsigned long milliseconds) {
+    cycle_clock.begin();
+    unsigned long first_tick = milliseconds % 1000;
+    if (first_tick == 0 && milliseconds > 0) {
+      first_tick = 1000;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      seconds_after_next = (milliseconds - first_tick) / 1000;
+      next_tick = cycle_clock.now() + first_tick * CycleClock::CYCLES_PER_MILLISECOND;
+      running = true;
+      finished = false;
+      second_passed = false;
+      cycle_clock.setAlarm(next_tick, secondTick);
+    }
+  }
+
+  // Stop counting, and forget any finished countdown.
+  void stop() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      running = false;
+      finished = false;
+      cycle_clock.cancelAlarm();
+    }
+  }
+
+  bool isRunning() const {
+    return running;
+  }
+
+  // true once the countdown has reached 0 (until it is started again).
+  bool isFinished() const {
+    return finished;
+  }
+
+  // true once after each tick (including the last one, at 0).
+  bool secondPassed() {
+    bool passed;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      passed = second_passed;
+      second_passed = false;
+    }
+    return passed;
+  }
+
+  // true if a tick is waiting for secondPassed(), without taking it (for
+  // idle_sleep.sleepUnless(), which checks with interrupts off).
+  bool isSecondWaiting() const {
+    return second_passed;
+  }
+
+  // Time left, in microseconds.
+  unsigned long remainingMicros() const {
+    unsigned long remaining = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if (running) {
+        long to_next_tick = next_tick - cycle_clock.now();
+        if (to_next_tick > 0) {
+          remaining = to_next_tick / CycleClock::CYCLES_PER_MICROSECOND;
+        }
+        remaining += seconds_after_next * 1000000UL;
+      }
+    }
+    return remaining;
+  }
+
+  // Time left, in milliseconds (rounded up, so it only shows 0 at the end).
+  unsigned long remainingMillis() const {
+    return (remainingMicros() + 999) / 1000;
+  }
+
+  // Used by the alarm interrupt.
+  void serviceTick() {
+    second_passed = true;
+    if (seconds_after_next == 0) {
+      running = false;
+      finished = true;
+      return;
+    }
+    seconds_after_next--;
+    next_tick += CYCLES_PER_SECOND;  // from the last tick, not from now, so we never drift
+    cycle_clock.setAlarm(next_tick, secondTick);
+  }
+
+private:
+  static void secondTick();
+
+  volatile unsigned long next_tick;           // cycle_clock cycle of the next tick
+  volatile unsigned long seconds_after_next;  // whole seconds left after the next tick
+  volatile bool running;                      // counting down
+  volatile bool finished;                     // reached 0
+  volatile bool second_passed;                // a tick since secondPassed() last looked
+};
+
+// The one countdown timer (it uses the only cycle_clock alarm).
+CountdownTimer countdown_timer;
+
+void CountdownTimer::secondTick() {
+  countdown_timer.serviceTick();
+}
+
+#endif  // COUNTDOWN_TIMER_H
@@ -0,0 +1,171 @@
+/*
+ * cycle_clock.h
+ *
+ * A clock that counts every one of the HERO's clock cycles, with an alarm
+ * that goes off on an exact cycle.
+ *
+ * millis() only changes about once a millisecond, and micros() only every
+ * 4 microseconds.  The HERO runs 16 million clock cycles a second, and its
+ * 16 bit Timer1 can count every single one of them.  cycle_clock starts
+ * Timer1 counting from 0 to 65535 over and over ("free running"), and adds
+ * 1 to a second counter every time it wraps back around to 0, so together
+ * they make a 32 bit count of cycles:
+ *
+ *   cycle_clock.begin();                        // in setup()
+ *   unsigned long start = cycle_clock.now();
+ *   ...
+ *   unsigned long cycles = cycle_clock.now() - start;  // 16 cycles = 1 us
+ *
+ * The count wraps around to 0 about every 268 seconds.  Like millis(),
+ * subtracting two readings still gives the right answer across a wrap, as
+ * long as they are less than 134 seconds apart.
+ *
+ * The alarm calls a function from an interrupt when the count reaches a
+ * given value, using Timer1's "compare" feature: Timer1 raises an interrupt
+ * on the very cycle it matches a value we give it.  An alarm more than one
+ * wrap away is handed to the timer once it is within one wrap.  There is one
+ * alarm, so only one part of a sketch can use it at a time (countdown_timer.h
+ * does).
+ *
+ * Timer1 also drives analogWrite() on pins 9 and 10, and the Servo library,
+ * so a sketch using cycle_clock can't use those.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "cycle_clock.h"
+ */
+
+#ifndef CYCLE_CLOCK_H
+#define CYCLE_CLOCK_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+
+class CycleClock {
+public:
+  static const unsigned long CYCLES_PER_MICROSECOND = F_CPU / 1000000UL;
+  static const unsigned long CYCLES_PER_MILLISECOND = F_CPU / 1000UL;
+
+  // Called from the alarm interrupt.  Must be short - no Serial!
+  typedef void (*AlarmFunction)();
+
+  CycleClock()
+    : overflows(0), alarm_function(NULL), alarm_set(false), started(false) {}
+
+  // Start Timer1 counting every clock cycle.  Calling it again does nothing.
+  void begin() {
+    if (started) {
+      return;
+    }
+    started = true;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      TCCR1A = 0;                      // normal mode: count up to 65535, then back to 0
+      TCCR1B = _BV(CS10);              // no prescaler: one count per clock cycle
+      TCNT1 = 0;
+      TIFR1 = _BV(TOV1) | _BV(OCF1B);  // forget anything from before
+      TIMSK1 = _BV(TOIE1);             // interrupt on every wrap around
+    }
+  }
+
+  // Clock cycles since begin().
+  unsigned long now() const {
+    unsigned long cycles;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      cycles = readCycles();
+    }
+    return cycles;
+  }
+
+  /*
+   * Call "function" (from an interrupt) when now() reaches "at_cycle".  A time
+   * already passed calls it straight away.  Replaces any alarm already set.
+   */
+  void setAlarm(unsigned long at_cycle, AlarmFunction function) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      alarm_at = at_cycle;
+      alarm_function = function;
+      alarm_set = true;
+      TIMSK1 &= ~_BV(OCIE1B);
+      checkAlarm();
+    }
+  }
+
+  void cancelAlarm() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      alarm_set = false;
+      TIMSK1 &= ~_BV(OCIE1B);
+    }
+  }
+
+  // Used by the Timer1 interrupts below.
+  void serviceOverflow() {
+    overflows++;
+    checkAlarm();
+  }
+
+  void serviceCompare() {
+    TIMSK1 &= ~_BV(OCIE1B);
+    ringAlarm();
+  }
+
+private:
+  // Read both counters together.  Interrupts must be off.  If Timer1 has
+  // just wrapped and the overflow interrupt hasn't run yet, count it here.
+  unsigned long readCycles() const {
+    unsigned int low = TCNT1;
+    unsigned int high = overflows;
+    if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+      high++;
+    }
+    return ((unsigned long)high << 16) | low;
+  }
+
+  /*
+   * If the alarm is due within one wrap of Timer1, hand it to the timer's
+   * compare, which raises an interrupt on exactly that cycle.  Interrupts
+   * must be off.
+   */
+  void checkAlarm() {
+    if (!alarm_set || (TIMSK1 & _BV(OCIE1B))) {
+      return;  // no alarm, or already handed to the timer
+    }
+    if ((long)(alarm_at - readCycles()) >= 65536L) {
+      return;  // not yet, check again next wrap around
+    }
+    OCR1B = (unsigned int)alarm_at;
+    TIFR1 = _BV(OCF1B);  // forget any earlier match
+    TIMSK1 |= _BV(OCIE1B);
+
+    // Too close (or already passed) for the compare to catch?  Ring it now.
+    if ((long)(alarm_at - readCycles()) <= 0) {
+      TIMSK1 &= ~_BV(OCIE1B);
+      TIFR1 = _BV(OCF1B);
+      ringAlarm();
+    }
+  }
+
+  void ringAlarm() {
+    alarm_set = false;
+    if (alarm_function != NULL) {
+      alarm_function();  // may set the next alarm
+    }
+  }
+
+  volatile unsigned int overflows;  // times Timer1 has wrapped around (high 16 bits of now())
+  volatile unsigned long alarm_at;  // cycle the alarm is set for
+  AlarmFunction alarm_function;     // called when it rings
+  volatile bool alarm_set;          // true until the alarm rings or is cancelled
+  bool started;                     // true once begin() has started Timer1
+};
+
+// The one cycle clock, used like Serial: cycle_clock.now()
+CycleClock cycle_clock;
+
+ISR(TIMER1_OVF_vect) {
+  cycle_clock.serviceOverflow();
+}
+
+ISR(TIMER1_COMPB_vect) {
+  cycle_clock.serviceCompare();
+}
+
+#endif  // CYCLE_CLOCK_H
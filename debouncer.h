@@ -0,0 +1,89 @@
+/*
+ * debouncer.h
+ *
+ * Debounce up to 8 switches at once.
+ *
+ * When a switch is flipped its metal contacts bounce for a few milliseconds,
+ * so reading it can give ON, OFF, ON, OFF... before it settles.  A debouncer
+ * only believes a switch has changed once it has read the new position
+ * several times in a row.
+ *
+ * Keeping a separate counter for each switch would mean a loop over every
+ * switch.  Instead this uses "vertical counters": each switch gets a 2 bit
+ * counter, but bit 0 of all 8 counters is kept in one byte (count0) and bit 1
+ * in another (count1).  A handful of AND/XOR instructions then counts all 8
+ * switches at the same time:
+ *
+ *   - a switch that reads the same as its debounced state resets its count
+ *   - a switch that reads differently counts down 3, 2, 1, 0
+ *   - when it counts past 0 (4 different readings in a row) it changes
+ *
+ * Call update() with a new reading at a steady rate, for example every 5 ms
+ * (a change is then accepted after 20 ms).  Bit N of the reading is switch N,
+ * which is exactly what InputSnapshot (input_snapshot.h) produces:
+ *
+ *   VerticalDebouncer switch_debouncer;
+ *   switch_debouncer.update(switches.read());
+ *   if (switch_debouncer.pressed() & _BV(0)) ...  // switch 0 just turned on
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "debouncer.h"
+ */
+
+#ifndef DEBOUNCER_H
+#define DEBOUNCER_H
+
+#include "Arduino.h"
+
+class VerticalDebouncer {
+public:
+  // Number of readings in a row a switch must differ before it changes.
+  static const byte SAMPLES = 4;
+
+  VerticalDebouncer(byte initial_state = 0)
+    : debounced(initial_state), count0(0xFF), count1(0xFF), toggled(0) {}
+
+  /*
+   * Add a new reading of all 8 switches.  Returns the switches whose
+   * debounced state changed with this reading (1 = changed).
+   */
+  byte update(byte reading) {
+    byte different = debounced ^ reading;  // switches that read differently
+    count0 = ~(count0 & different);        // count down, or reset to 3 if not different
+    count1 = count0 ^ (count1 & different);
+    toggled = different & count0 & count1;  // counted past 0
+    debounced ^= toggled;
+    return toggled;
+  }
+
+  // Debounced position of every switch (1 = on).
+  byte state() const {
+    return debounced;
+  }
+
+  // Switches that turned on with the last update().
+  byte pressed() const {
+    return debounced & toggled;
+  }
+
+  // Switches that turned off with the last update().
+  byte released() const {
+    return ~debounced & toggled;
+  }
+
+  // Forget any counting and set the debounced state (for example from a
+  // first reading in setup()).
+  void reset(byte state) {
+    debounced = state;
+    count0 = count1 = 0xFF;
+    toggled = 0;
+  }
+
+private:
+  byte debounced;  // debounced switch positions
+  byte count0;     // bit 0 of each switch's counter
+  byte count1;     // bit 1 of each switch's counter
+  byte toggled;    // switches that changed with the last update()
+};
+
+#endif  // DEBOUNCER_H
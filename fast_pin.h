@@ -0,0 +1,123 @@
+/*
+ * fast_pin.h
+ *
+ * Very fast digital pins for the HERO board.
+ *
+ * pinMode(), digitalWrite() and digitalRead() take the pin number while the
+ * sketch is running, so every call has to look up which port register and
+ * which bit that pin uses (and check whether it is a PWM pin) before it can
+ * do anything.  Pin<N> does all of that looking up while compiling instead,
+ * so each call turns into one or two machine instructions:
+ *
+ *   Pin<12> cabin_lights;     // pin 12 is bit 4 of PORTB
+ *   cabin_lights.output();    // same as pinMode(12, OUTPUT)
+ *   cabin_lights.high();      // same as digitalWrite(12, HIGH)
+ *   if (thrust_lever.read())  // same as digitalRead(...) == HIGH
+ *
+ * Clock cycles per call on the 16 MHz HERO board (1 cycle = 1/16 us):
+ *
+ *   Arduino function           cycles   Pin<N> function          cycles
+ *   pinMode(pin, OUTPUT)       ~70      output()                 2 (sbi)
+ *   pinMode(pin, INPUT)        ~70      input()                  4 (cbi, cbi)
+ *   digitalWrite(pin, HIGH)    ~55      high()                   2 (sbi)
+ *   digitalWrite(pin, LOW)     ~55      low()                    2 (cbi)
+ *   digitalRead(pin)           ~50      read()                   3 (in, bst/andi)
+ *
+ * Day 1 measures the real numbers when RUN_PIN_BENCHMARK is defined.
+ *
+ * The pin number must be known while compiling: a number, a #define or a
+ * "const byte" (including A0-A5), not an "int" variable.
+ *
+ * NOTE: digitalWrite() also turns off analogWrite() PWM on the pin, Pin<N>
+ *       does not.  Keep using analogWrite()/digitalWrite() for pins that use
+ *       PWM (like the Day 10b night light) or tone().
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "fast_pin.h"
+ */
+
+#ifndef FAST_PIN_H
+#define FAST_PIN_H
+
+#include "Arduino.h"
+
+template <byte PIN>
+class Pin {
+  static_assert(PIN < 20, "Pin<N>: the HERO board has digital pins 0-13 and A0-A5 (14-19)");
+
+public:
+  // This pin's bit within its port: pins 0-7 are PORTD, 8-13 are PORTB and
+  // A0-A5 are PORTC.
+  static constexpr byte MASK = 1 << ((PIN < 8) ? PIN : (PIN < 14) ? PIN - 8 : PIN - 14);
+
+  constexpr Pin() {}
+
+  // Arduino pin number, for code that still needs it (like tone()).
+  static constexpr byte number() {
+    return PIN;
+  }
+
+  // pinMode(PIN, OUTPUT)
+  static inline void output() {
+    ddr() |= MASK;
+  }
+
+  // pinMode(PIN, INPUT)
+  static inline void input() {
+    ddr() &= ~MASK;
+    port() &= ~MASK;
+  }
+
+  // pinMode(PIN, INPUT_PULLUP)
+  static inline void inputPullup() {
+    ddr() &= ~MASK;
+    port() |= MASK;
+  }
+
+  // digitalWrite(PIN, HIGH)
+  static inline void high() {
+    port() |= MASK;
+  }
+
+  // digitalWrite(PIN, LOW)
+  static inline void low() {
+    port() &= ~MASK;
+  }
+
+  // digitalWrite(PIN, value)
+  static inline void write(bool value) {
+    if (value) {
+      high();
+    } else {
+      low();
+    }
+  }
+
+  // Flip an output from HIGH to LOW or LOW to HIGH.  Writing a 1 to the PINx
+  // register flips the pin, so this doesn't even need to read it first.
+  static inline void toggle() {
+    pins() = MASK;
+  }
+
+  // digitalRead(PIN) == HIGH
+  static inline bool read() {
+    return (pins() & MASK) != 0;
+  }
+
+private:
+  // The registers for this pin's port.  PIN is a constant, so the compiler
+  // picks the register while compiling and no test is left in the program.
+  static inline volatile uint8_t &port() {
+    return (PIN < 8) ? PORTD : (PIN < 14) ? PORTB : PORTC;
+  }
+
+  static inline volatile uint8_t &ddr() {
+    return (PIN < 8) ? DDRD : (PIN < 14) ? DDRB : DDRC;
+  }
+
+  static inline volatile uint8_t &pins() {
+    return (PIN < 8) ? PIND : (PIN < 14) ? PINB : PINC;
+  }
+};
+
+#endif  // FAST_PIN_H
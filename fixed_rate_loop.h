@@ -0,0 +1,185 @@
+/*
+ * fixed_rate_loop.h
+ *
+ * Run loop() on a steady beat ("ticks"), and keep a record of how steady it
+ * really is.
+ *
+ * Waiting until 200 ms after the START of each loop() keeps loops the same
+ * length as long as the work fits, but as soon as one loop runs long the
+ * next one starts late and the beat is lost for good.  A FixedRateLoop keeps
+ * a schedule of "deadlines" instead: tick 1 is due 200 ms after tick 0, tick
+ * 2 is due 200 ms after THAT, and so on, however late each one actually
+ * started.  A slow tick doesn't push the rest of the schedule back.
+ *
+ *   FixedRateLoop ticker(200);  // tick every 200 ms
+ *
+ *   void loop() {
+ *     if (!ticker.ready()) {
+ *       return;  // not time yet, ready() returns right away
+ *     }
+ *     // ... this tick's work ...
+ *   }
+ *
+ * Every tick is checked against its deadline:
+ *   - "Jitter" is how late the tick started, in microseconds.  The jitter of
+ *     every tick is counted in a histogram of buckets that double in size:
+ *     under 8 us, under 16 us, under 32 us ... so the report shows at a
+ *     glance if the beat is steady.
+ *   - An "overrun" is a tick so late that whole ticks were missed (the work
+ *     took longer than a tick).  Missed ticks are skipped, keeping the same
+ *     beat, and counted in a second histogram: 1, 2, 3, or 4 or more missed.
+ *
+ * printReport() sends both histograms over Serial (or any Print).
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "fixed_rate_loop.h"
+ */
+
+#ifndef FIXED_RATE_LOOP_H
+#define FIXED_RATE_LOOP_H
+
+#include "Arduino.h"
+
+class FixedRateLoop {
+public:
+  static const byte JITTER_BUCKETS = 12;  // under 8 us, under 16 us ... under 8192 us, 8192 us or more
+  static const byte OVERRUN_BUCKETS = 4;  // 1, 2, 3, or 4 or more ticks missed
+
+  FixedRateLoop(unsigned long period_ms)
+    : period(period_ms * 1000UL), next_deadline(0), last_lateness(0), started(false) {
+    clearStats();
+  }
+
+  /*
+   * true once when the next tick is due, otherwise false.  Never waits.
+   * The first call always starts tick 0.
+   */
+  bool ready() {
+    unsigned long now = micros();
+    if (!started) {
+      started = true;
+      next_deadline = now;
+    }
+    if ((long)(now - next_deadline) < 0) {
+      return false;  // not time yet
+    }
+
+    unsigned long lateness = now - next_deadline;
+    recordJitter(lateness);
+    if (lateness >= period) {
+      // Missed whole ticks.  Skip them, keeping to the same beat.
+      unsigned long missed = lateness / period;
+      overrun_histogram[(missed < OVERRUN_BUCKETS ? missed : OVERRUN_BUCKETS) - 1]++;
+      overrun_count++;
+      next_deadline += missed * period;
+    }
+    next_deadline += period;
+    tick_count++;
+    return true;
+  }
+
+  // Wait (without returning) until the next tick is due.
+  void wait() {
+    while (!ready()) {
+    }
+  }
+
+  // Change the time between ticks.  The next tick is due "period_ms" after
+  // the last one.
+  void setPeriod(unsigned long period_ms) {
+    unsigned long new_period = period_ms * 1000UL;
+    if (started) {
+      next_deadline = next_deadline - period + new_period;
+    }
+    period = new_period;
+  }
+
+  unsigned long ticks() const {
+    return tick_count;
+  }
+
+  unsigned int overruns() const {
+    return overrun_count;
+  }
+
+  // How late (in microseconds) the last tick started.
+  unsigned long lateness() const {
+    return last_lateness;
+  }
+
+  /*
+   * Print the tick count, overruns and both histograms, one line each,
+   * separated by commas:
+   *   ticks,351,overruns,2,max_late_us,212340
+   *   late_us,<8,<16,...,>=8192
+   *   count,340,9,...,2
+   *   missed,1,2,3,4+
+   *   count,2,0,0,0
+   */
+  void printReport(Print &out) const {
+    out.print(F("ticks,"));
+    out.print(tick_count);
+    out.print(F(",overruns,"));
+    out.print(overrun_count);
+    out.print(F(",max_late_us,"));
+    out.println(max_lateness);
+
+    out.print(F("late_us"));
+    for (byte bucket = 0; bucket < JITTER_BUCKETS - 1; bucket++) {
+      out.print(F(",<"));
+      out.print(8UL << bucket);
+    }
+    out.print(F(",>="));
+    out.println(8UL << (JITTER_BUCKETS - 2));
+    printCounts(out, jitter_histogram, JITTER_BUCKETS);
+
+    out.println(F("missed,1,2,3,4+"));
+    printCounts(out, overrun_histogram, OVERRUN_BUCKETS);
+  }
+
+  // Start counting again from 0 (the beat carries on).
+  void clearStats() {
+    memset(jitter_histogram, 0, sizeof(jitter_histogram));
+    memset(overrun_histogram, 0, sizeof(overrun_histogram));
+    tick_count = 0;
+    overrun_count = 0;
+    max_lateness = 0;
+  }
+
+private:
+  // Count a tick's lateness in its histogram bucket.
+  void recordJitter(unsigned long lateness) {
+    last_lateness = lateness;
+    if (lateness > max_lateness) {
+      max_lateness = lateness;
+    }
+    byte bucket = 0;
+    for (unsigned long remaining = lateness >> 3; remaining != 0 && bucket < JITTER_BUCKETS - 1;
+         remaining >>= 1) {
+      bucket++;
+    }
+    jitter_histogram[bucket]++;
+  }
+
+  static void printCounts(Print &out, const unsigned int *counts, byte bucket_count) {
+    out.print(F("count"));
+    for (byte bucket = 0; bucket < bucket_count; bucket++) {
+      out.print(',');
+      out.print(counts[bucket]);
+    }
+    out.println();
+  }
+
+  unsigned long period;         // microseconds between ticks
+  unsigned long next_deadline;  // micros() when the next tick is due
+  unsigned long last_lateness;  // how late the last tick was
+  unsigned long max_lateness;   // latest tick since clearStats()
+  unsigned long tick_count;     // ticks since clearStats()
+  unsigned int overrun_count;   // ticks that missed other ticks
+  bool started;                 // false until the first ready()
+
+  unsigned int jitter_histogram[JITTER_BUCKETS];
+  unsigned int overrun_histogram[OVERRUN_BUCKETS];
+};
+
+#endif  // FIXED_RATE_LOOP_H
@@ -0,0 +1,145 @@
+/*
+ * gamma_table.h
+ *
+ * Our eyes don't see LED brightness in a straight line.  Going from PWM 0 to
+ * 64 looks like a huge jump, while going from 192 to 255 barely looks any
+ * different.  "Gamma correction" fixes this by bending the PWM values along
+ * the curve:
+ *
+ *   pwm = 255 * (level / 255) ^ gamma
+ *
+ * so equal steps in "level" LOOK like equal steps in brightness.
+ *
+ * Computing a power on the HERO board would be very slow, so the compiler
+ * calculates all 256 answers ahead of time and stores them in flash memory
+ * (PROGMEM).  Correcting a value is then a single table read:
+ *
+ *   analogWrite(RED_PIN, gammaCorrect(red_intensity));
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "gamma_table.h"
+ */
+
+#ifndef GAMMA_TABLE_H
+#define GAMMA_TABLE_H
+
+#include "Arduino.h"
+
+// Gamma used by gammaCorrect(), in tenths (22 means 2.2).  Define this before
+// including the file to use a different curve.
+#ifndef GAMMA_TENTHS
+#define GAMMA_TENTHS 22
+#endif
+
+/*
+ * Compile time math used to build the table.  These functions are only ever
+ * run by the compiler, never on the HERO board, so they can use doubles.
+ * Each is written as a single return statement so it works as a constexpr
+ * function with the C++11 compiler used by the Arduino IDE.
+ */
+namespace gamma_table_detail {
+
+constexpr double LN_2 = 0.69314718055994530942;
+
+// Natural log for 0.5 <= x <= 1 using the series 2 * (z + z^3/3 + z^5/5 ...)
+// where z = (x - 1) / (x + 1).  "term" is z^(2k+1) for the current k.
+constexpr double logSeries(double z_squared, double term, int k) {
+  return (k > 24) ? 0.0 : term / (2 * k + 1) + logSeries(z_squared, term * z_squared, k + 1);
+}
+
+// Natural log for 0 < x <= 1.  Doubles x (and subtracts ln 2) until x >= 0.5.
+constexpr double naturalLog(double x) {
+  return (x < 0.5) ? naturalLog(x * 2.0) - LN_2
+                   : 2.0 * logSeries(((x - 1.0) / (x + 1.0)) * ((x - 1.0) / (x + 1.0)),
+                                     (x - 1.0) / (x + 1.0), 0);
+}
+
+// e^y using the Taylor series 1 + y + y^2/2! + ...  "term" is y^k / k!
+constexpr double expSeries(double y, double term, int k) {
+  return (k > 24) ? 0.0 : term + expSeries(y, term * y / (k + 1), k + 1);
+}
+
+constexpr double square(double value) {
+  return value * value;
+}
+
+// e^y for y <= 0.  Uses e^y = (e^(y/2))^2 until y is small enough for the series.
+constexpr double exponential(double y) {
+  return (y < -0.5) ? square(exponential(y / 2.0)) : expSeries(y, 1.0, 0);
+}
+
+// PWM value for "level" on a gamma curve, rounded to the nearest whole number.
+constexpr byte curveValue(unsigned int level, unsigned int gamma_tenths) {
+  return (level == 0) ? 0
+                      : (byte)(255.0 * exponential(naturalLog(level / 255.0) * gamma_tenths / 10.0) + 0.5);
+}
+
+// A list of the numbers 0, 1, 2 ... N-1, built by the compiler, used to
+// fill in every entry of the table below.
+template <unsigned int... I>
+struct IndexList {};
+
+template <unsigned int N, unsigned int... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+
+template <unsigned int... I>
+struct MakeIndexList<0, I...> {
+  typedef IndexList<I...> type;
+};
+
+// Wrapping the array in a struct lets a constexpr function return all 256
+// entries at once.
+struct GammaTable {
+  byte values[256];
+};
+
+// Fill in every entry of the table, one curveValue() for each index in the list.
+template <unsigned int... I>
+constexpr GammaTable makeGammaTable(IndexList<I...>, unsigned int gamma_tenths) {
+  return GammaTable{ { curveValue(I, gamma_tenths)... } };
+}
+
+}  // namespace gamma_table_detail
+
+/*
+ * The complete 256 entry table, calculated by the compiler and stored in
+ * flash.  Read entries with pgm_read_byte(), or just use gammaCorrect() below.
+ */
+constexpr gamma_table_detail::GammaTable GAMMA_TABLE PROGMEM =
+  gamma_table_detail::makeGammaTable(gamma_table_detail::MakeIndexList<256>::type(), GAMMA_TENTHS);
+
+// Gamma corrected PWM value (0-255) for a brightness level (0-255).
+inline byte gammaCorrect(byte level) {
+  return pgm_read_byte(&GAMMA_TABLE.values[level]);
+}
+
+/*
+ * Check the table while compiling.  If any of these fail the sketch won't
+ * build, so a broken table can never reach the HERO board.
+ */
+namespace gamma_table_detail {
+
+// true if every entry from "index" to the end is at least the one before it
+constexpr bool isRising(unsigned int index) {
+  return (index > 255) ? true
+                       : (GAMMA_TABLE.values[index] >= GAMMA_TABLE.values[index - 1]) && isRising(index + 1);
+}
+
+static_assert(GAMMA_TABLE.values[0] == 0 && GAMMA_TABLE.values[255] == 255,
+              "Gamma table must run from fully off to fully on");
+static_assert(isRising(1), "Gamma table must never get dimmer as the level rises");
+
+#if GAMMA_TENTHS == 22
+// Spot checks against 255 * (level / 255) ^ 2.2 worked out on a calculator.
+static_assert(GAMMA_TABLE.values[1] == 0, "Gamma 2.2 table: level 1");
+static_assert(GAMMA_TABLE.values[16] == 1, "Gamma 2.2 table: level 16");
+static_assert(GAMMA_TABLE.values[32] == 3, "Gamma 2.2 table: level 32");
+static_assert(GAMMA_TABLE.values[64] == 12, "Gamma 2.2 table: level 64");
+static_assert(GAMMA_TABLE.values[128] == 56, "Gamma 2.2 table: level 128");
+static_assert(GAMMA_TABLE.values[192] == 137, "Gamma 2.2 table: level 192");
+static_assert(GAMMA_TABLE.values[254] == 253, "Gamma 2.2 table: level 254");
+#endif
+
+}  // namespace gamma_table_detail
+
+#endif  // GAMMA_TABLE_H
@@ -0,0 +1,167 @@
+/*
+ * idle_sleep.h
+ *
+ * Let the HERO sleep when it has nothing to do, instead of spinning.
+ *
+ * delay(), waiting in loop() for millis() to reach a time, and stopping with
+ * while (true); all keep the processor running flat out doing nothing.  The
+ * ATmega328P can "sleep" instead: it stops running our code (using much less
+ * power) until an interrupt wakes it up, then carries on where it left off.
+ *
+ *   if (scheduler.run() == 0) {  // nothing was due
+ *     idle_sleep.sleep();        // sleep until the next interrupt
+ *   }
+ *
+ * There are several sleep modes.  We use IDLE, which only stops the processor
+ * itself - the timers, Serial, I2C and pin change interrupts all keep going.
+ * The timer behind millis() interrupts about once a millisecond, so sleep()
+ * never sleeps for longer than that, and millis(), micros(), tone() and
+ * Serial all work just as before.  (The deeper "power-save" and "power-down"
+ * modes also stop the millis() timer, so we only use power-down to stop for
+ * good, with halt().)
+ *
+ * Checking for work and then calling sleep() leaves a small gap: an
+ * interrupt that leaves us work (sets a flag) just after the check isn't
+ * noticed until the next interrupt wakes us, up to about 1 ms later.
+ * sleepUnless() closes the gap - it checks with interrupts held off, and only
+ * lets them back in as it falls asleep, so that interrupt wakes us at once:
+ *
+ *   idle_sleep.sleepUnless(countdownTicked);  // bool countdownTicked() { ... }
+ *
+ * idle_sleep also adds up the time spent asleep, so printDutyCycle() can show
+ * how busy a sketch really is: the percentage of time it was awake ("active").
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "idle_sleep.h"
+ */
+
+#ifndef IDLE_SLEEP_H
+#define IDLE_SLEEP_H
+
+#include "Arduino.h"
+#include <avr/sleep.h>
+
+class IdleSleep {
+public:
+  IdleSleep()
+    : sleep_micros(0), sleep_count(0), stats_start(0) {}
+
+  // Sleep until the next interrupt (at most about 1 ms).
+  void sleep() {
+    cli();
+    sleepThenEnableInterrupts();
+  }
+
+  /*
+   * Sleep until the next interrupt, unless "flag" (set by an interrupt) is
+   * already true.  An interrupt that sets it after the check still wakes us
+   * straight away.  Returns true if we slept.
+   */
+  bool sleepUnless(const volatile bool &flag) {
+    cli();
+    if (flag) {
+      sei();
+      return false;
+    }
+    sleepThenEnableInterrupts();
+    return true;
+  }
+
+  // The same, when it takes more than one flag to tell: "work_waiting" is
+  // called with interrupts off, so it must only look, and be quick.
+  bool sleepUnless(bool (*work_waiting)()) {
+    cli();
+    if (work_waiting()) {
+      sei();
+      return false;
+    }
+    sleepThenEnableInterrupts();
+    return true;
+  }
+
+  // Like delay(), but sleeping between interrupts while we wait.
+  void sleepFor(unsigned long ms) {
+    unsigned long start_time = micros();
+    while (micros() - start_time < ms * 1000UL) {
+      sleep();
+    }
+  }
+
+  /*
+   * Stop for good, in place of while (true);.  Waits for any Serial output to
+   * be sent, then sleeps in power-down mode with interrupts off, so nothing
+   * can wake the HERO until it is reset.  The displays keep showing whatever
+   * they showed last, but tone() stops.
+   */
+  void halt() {
+    Serial.flush();
+    cli();
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    while (true) {
+      sleep_cpu();
+    }
+  }
+
+  // Percentage of the time since clearStats() spent awake.  micros() wraps
+  // around after about 70 minutes, so measure for less than that.
+  byte activePercent() const {
+    unsigned long one_percent = (micros() - stats_start) / 100;
+    if (one_percent == 0) {
+      return 100;
+    }
+    unsigned long asleep = sleep_micros / one_percent;
+    return asleep < 100 ? 100 - asleep : 0;
+  }
+
+  /*
+   * Print the time since clearStats() (or the start), how much of it was
+   * spent awake and asleep, and the percentage awake:
+   *   active_us,sleep_us,sleeps,active_pct
+   *   812340,9187660,9790,8
+   */
+  void printDutyCycle(Print &out) const {
+    unsigned long total = micros() - stats_start;
+    out.println(F("active_us,sleep_us,sleeps,active_pct"));
+    out.print(total - sleep_micros);
+    out.print(',');
+    out.print(sleep_micros);
+    out.print(',');
+    out.print(sleep_count);
+    out.print(',');
+    out.println(activePercent());
+  }
+
+  // Start measuring again from now.
+  void clearStats() {
+    sleep_micros = 0;
+    sleep_count = 0;
+    stats_start = micros();
+  }
+
+private:
+  /*
+   * Called with interrupts off.  The ATmega328P always runs the instruction
+   * after sei() before any waiting interrupt, so sleep_cpu() is reached first
+   * and the interrupt wakes us, rather than running just before we sleep.
+   */
+  void sleepThenEnableInterrupts() {
+    unsigned long start_time = micros();
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sei();
+    sleep_cpu();  // wakes up here, after the interrupt has run
+    sleep_disable();
+    sleep_micros += micros() - start_time;
+    sleep_count++;
+  }
+
+  unsigned long sleep_micros;  // time asleep since clearStats()
+  unsigned long sleep_count;   // times we went to sleep
+  unsigned long stats_start;   // micros() at clearStats()
+};
+
+// The one idle sleeper, used like Serial: idle_sleep.sleep()
+IdleSleep idle_sleep;
+
+#endif  // IDLE_SLEEP_H
@@ -0,0 +1,118 @@
+/*
+ * input_snapshot.h
+ *
+ * Read a group of switches all at the same moment.
+ *
+ * Calling digitalRead() for a switch every time we need it means a switch
+ * that is flipped part way through loop() can be seen as ON by one check and
+ * OFF by the next.  Day 5 could light LED4 (switch 1 AND switch 2) while LED1
+ * (switch 1) was dark!
+ *
+ * An InputSnapshot instead reads each port the switches are on exactly once
+ * and packs the switches into a single byte, one bit per switch, in the order
+ * they were listed:
+ *
+ *   InputSnapshot<2, 3, 4> switches;  // bit 0 = pin 2, bit 1 = pin 3, bit 2 = pin 4
+ *   byte snapshot = switches.read();  // all three switches at the same moment
+ *
+ * Every decision in that loop() is then made from "snapshot", so they always
+ * agree with each other.  The pins are worked out while compiling (using
+ * Pin<N> from fast_pin.h), so read() is one "in" instruction per port plus
+ * about two instructions per switch - for Day 5 that is around 10 clock
+ * cycles, compared to about 450 for the nine digitalRead() calls it replaces.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "input_snapshot.h"
+ */
+
+#ifndef INPUT_SNAPSHOT_H
+#define INPUT_SNAPSHOT_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "fast_pin.h"
+
+namespace input_snapshot_detail {
+
+// true if any of the pins is from "first" up to (but not including) "last"
+constexpr bool anyPinBetween(byte, byte) {
+  return false;
+}
+
+template <typename... Pins>
+constexpr bool anyPinBetween(byte first, byte last, byte pin, Pins... others) {
+  return (pin >= first && pin < last) || anyPinBetween(first, last, others...);
+}
+
+// Move each pin's bit from its port reading into bit INDEX, INDEX + 1 ...
+template <byte INDEX, byte... PINS>
+struct BitPacker {
+  static inline byte pack(byte, byte, byte) {
+    return 0;
+  }
+};
+
+template <byte INDEX, byte PIN, byte... OTHERS>
+struct BitPacker<INDEX, PIN, OTHERS...> {
+  static inline byte pack(byte port_b, byte port_c, byte port_d) {
+    byte port = (PIN < 8) ? port_d : (PIN < 14) ? port_b : port_c;
+    return ((port & Pin<PIN>::MASK) ? (1 << INDEX) : 0)
+           | BitPacker<INDEX + 1, OTHERS...>::pack(port_b, port_c, port_d);
+  }
+};
+
+}  // namespace input_snapshot_detail
+
+template <byte... PINS>
+class InputSnapshot {
+  static_assert(sizeof...(PINS) >= 1 && sizeof...(PINS) <= 8, "InputSnapshot holds 1 to 8 pins");
+
+public:
+  static const byte COUNT = sizeof...(PINS);  // number of pins in the snapshot
+
+  constexpr InputSnapshot() {}
+
+  // pinMode(pin, INPUT) for every pin in the group.
+  static void input() {
+    int ignored[] = { (Pin<PINS>::input(), 0)... };
+    (void)ignored;
+  }
+
+  /*
+   * Read every pin in the group at once.  Bit 0 of the result is the first
+   * pin listed, bit 1 the second, and so on (1 = HIGH).  Interrupts are held
+   * off while the ports are read so all of them are read back to back.
+   */
+  static byte read() {
+    byte port_b = 0, port_c = 0, port_d = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if (USES_PORT_D) port_d = PIND;
+      if (USES_PORT_B) port_b = PINB;
+      if (USES_PORT_C) port_c = PINC;
+    }
+    return input_snapshot_detail::BitPacker<0, PINS...>::pack(port_b, port_c, port_d);
+  }
+
+private:
+  // Which ports we need to read, so read() skips the others.
+  static constexpr bool USES_PORT_D = input_snapshot_detail::anyPinBetween(0, 8, PINS...);
+  static constexpr bool USES_PORT_B = input_snapshot_detail::anyPinBetween(8, 14, PINS...);
+  static constexpr bool USES_PORT_C = input_snapshot_detail::anyPinBetween(14, 20, PINS...);
+};
+
+/*
+ * Logic helpers for making decisions from a snapshot.  "bits" picks the
+ * switches to look at, for example _BV(0) | _BV(1) for the first two.
+ */
+
+// true if every switch in "bits" is ON
+inline bool allOn(byte snapshot, byte bits) {
+  return (snapshot & bits) == bits;
+}
+
+// true if at least one switch in "bits" is ON
+inline bool anyOn(byte snapshot, byte bits) {
+  return (snapshot & bits) != 0;
+}
+
+#endif  // INPUT_SNAPSHOT_H
@@ -0,0 +1,209 @@
+/*
+ * lever_monitor.h
+ *
+ * Watch the control panel levers (DIP switches) with interrupts so no lever
+ * movement is ever missed.
+ *
+ * Reading the levers with digitalRead() once per loop() only sees where they
+ * are at that moment.  A lever flicked off and back on between two reads is
+ * never seen, and if loop() takes 200 ms a lever can sit off for up to 200 ms
+ * before we notice.  The LeverMonitor uses pin change interrupts (see
+ * pin_change.h) to notice every lever movement within a few microseconds,
+ * records the time it happened, and keeps a short list of these "events" for
+ * loop() to read.
+ *
+ * Switch contacts "bounce" - one flick can look like several quick on/off
+ * changes.  The first change is accepted straight away (so there is no
+ * delay), then further changes on that lever are ignored for DEBOUNCE_MS.
+ * If the lever ends up somewhere different once that time is over, that is
+ * recorded as another event.
+ *
+ *   const byte THRUST_LEVER = lever_monitor.attach(THRUST_LEVER_PIN);
+ *   ...
+ *   if (lever_monitor.isOn(THRUST_LEVER)) ...
+ *
+ *   LeverEvent event;
+ *   while (lever_monitor.readEvent(event)) {
+ *     // event.lever was turned event.on at millis() time event.time
+ *   }
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "lever_monitor.h"
+ */
+
+#ifndef LEVER_MONITOR_H
+#define LEVER_MONITOR_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "pin_change.h"
+
+struct LeverEvent {
+  byte lever;          // lever number returned by attach()
+  bool on;             // true if the lever was turned on, false if turned off
+  unsigned long time;  // millis() when it happened
+};
+
+class LeverMonitor {
+public:
+  static const byte MAX_LEVERS = 8;        // levers that can be attached
+  static const byte EVENT_QUEUE_SIZE = 8;  // events kept until readEvent() (must be a power of 2)
+  static const byte DEBOUNCE_MS = 20;      // ignore bounces for this long after a change
+  static const byte NO_LEVER = 255;        // returned by attach() if the lever can't be added
+
+  LeverMonitor()
+    : lever_count(0), lever_states(0), bouncing(0), event_head(0), event_count(0) {}
+
+  /*
+   * Start watching a lever on "pin" (any pin, including A0-A5) and set it as
+   * an INPUT.  Levers are numbered 0, 1, 2 ... in the order they are
+   * attached, and the number is returned so it can be saved in a constant.
+   */
+  byte attach(byte pin) {
+    if (lever_count >= MAX_LEVERS) {
+      return NO_LEVER;
+    }
+    pinMode(pin, INPUT);
+
+    byte lever = lever_count;
+    Lever &new_lever = levers[lever];
+    new_lever.port = digitalPinToPCICRbit(pin);
+    new_lever.mask = digitalPinToBitMask(pin);
+    new_lever.input_register = portInputRegister(digitalPinToPort(pin));
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if (*new_lever.input_register & new_lever.mask) {
+        lever_states |= _BV(lever);
+      }
+      lever_count++;
+    }
+    if (!pin_change.attach(pin, leverChanged)) {
+      lever_count--;
+      return NO_LEVER;
+    }
+    return lever;
+  }
+
+  // All lever positions, bit 0 for lever 0 and so on (1 = on).
+  byte states() {
+    settle();
+    return lever_states;
+  }
+
+  // true if "lever" is on.
+  bool isOn(byte lever) {
+    return (states() & _BV(lever)) != 0;
+  }
+
+  // true if there are events waiting.  Cheap enough to call in a waiting loop.
+  bool hasEvent() const {
+    return event_count != 0;
+  }
+
+  /*
+   * Take the oldest lever event off the list.  Returns false if there are
+   * none.  If more than EVENT_QUEUE_SIZE events pile up the oldest are lost.
+   */
+  bool readEvent(LeverEvent &event) {
+    settle();
+    bool found = false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if (event_count > 0) {
+        event = events[event_head];
+        event_head = (event_head + 1) & (EVENT_QUEUE_SIZE - 1);
+        event_count--;
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  // Throw away any events waiting to be read.
+  void clearEvents() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      event_count = 0;
+    }
+  }
+
+  // Called only by the pin change interrupt.
+  void serviceInterrupt(byte port, byte pins, byte changed) {
+    unsigned long now = millis();
+    for (byte lever = 0; lever < lever_count; lever++) {
+      const Lever &this_lever = levers[lever];
+      if (this_lever.port == port && (changed & this_lever.mask)) {
+        acceptChange(lever, (pins & this_lever.mask) != 0, now);
+      }
+    }
+  }
+
+private:
+  struct Lever {
+    byte port;                         // pin change port number
+    byte mask;                         // this lever's bit within the port
+    volatile uint8_t *input_register;  // PINx register to read the lever
+    unsigned long last_change;         // millis() of the last accepted change
+  };
+
+  static void leverChanged(byte port, byte pins, byte changed);
+
+  // Record a change unless the lever is still bouncing from the last one.
+  // Only called with interrupts off.
+  void acceptChange(byte lever, bool on, unsigned long now) {
+    byte bit = _BV(lever);
+    if (bouncing & bit) {
+      if (now - levers[lever].last_change < DEBOUNCE_MS) {
+        return;  // still bouncing, ignore
+      }
+      bouncing &= ~bit;
+    }
+    if (on == ((lever_states & bit) != 0)) {
+      return;  // no real change
+    }
+    lever_states ^= bit;
+    levers[lever].last_change = now;
+    bouncing |= bit;
+
+    byte tail = (event_head + event_count) & (EVENT_QUEUE_SIZE - 1);
+    if (event_count == EVENT_QUEUE_SIZE) {
+      event_head = (event_head + 1) & (EVENT_QUEUE_SIZE - 1);  // full, lose the oldest
+    } else {
+      event_count++;
+    }
+    events[tail].lever = lever;
+    events[tail].on = on;
+    events[tail].time = now;
+  }
+
+  // Once a lever has stopped bouncing make sure we agree with where it ended
+  // up.  Bounces we ignored may have left it somewhere else.
+  void settle() {
+    if (!bouncing) {
+      return;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      unsigned long now = millis();
+      for (byte lever = 0; lever < lever_count; lever++) {
+        const Lever &this_lever = levers[lever];
+        if ((bouncing & _BV(lever)) && now - this_lever.last_change >= DEBOUNCE_MS) {
+          acceptChange(lever, (*this_lever.input_register & this_lever.mask) != 0, now);
+        }
+      }
+    }
+  }
+
+  Lever levers[MAX_LEVERS];
+  byte lever_count;
+  volatile byte lever_states;  // debounced position of each lever
+  volatile byte bouncing;      // levers that changed less than DEBOUNCE_MS ago
+  LeverEvent events[EVENT_QUEUE_SIZE];
+  volatile byte event_head;   // oldest event
+  volatile byte event_count;  // events waiting
+};
+
+// The one lever monitor, used like Serial: lever_monitor.isOn(THRUST_LEVER)
+LeverMonitor lever_monitor;
+
+void LeverMonitor::leverChanged(byte port, byte pins, byte changed) {
+  lever_monitor.serviceInterrupt(port, pins, changed);
+}
+
+#endif  // LEVER_MONITOR_H
@@ -0,0 +1,90 @@
+/*
+ * log_level.h
+ *
+ * Debug messages that can be switched off completely, so they take no flash,
+ * RAM or time at all once a sketch is working.
+ *
+ * Instead of Serial.print() (or commenting debug prints in and out), give
+ * each message a level:
+ *
+ *   LOG_TRACE("y_center: ", y_center);     // very detailed, every time round
+ *   LOG_DEBUG("Gear: ", current_gear_bitmap);
+ *   LOG_INFO("Countdown started");
+ *   LOG_WARN("Fuel low: ", fuel);
+ *   LOG_ERROR("Lost signal");
+ *
+ * Only messages at LOG_LEVEL or above are kept.  The rest are removed by the
+ * compiler - not just skipped when the sketch runs, but left out of it, along
+ * with their text.  LOG_LEVEL is LOG_LEVEL_INFO unless the sketch chooses
+ * another level before it includes this file:
+ *
+ *   #define LOG_LEVEL LOG_LEVEL_DEBUG  // while we're working on it
+ *   #include "log_level.h"
+ *
+ * LOG_LEVEL_NONE removes every message.  log_size_report.py (next to this
+ * file) shows how much flash each sketch saves that way.
+ *
+ * A message is a string, optionally followed by a number.  The string is
+ * kept in flash (the macros add the F() for us, so it must be in quotes), and
+ * it is printed with serial_log (see serial_log.h), so a message never makes
+ * loop() wait for the Serial port.  Because removed messages are never run,
+ * don't put anything in one that the sketch needs to happen (like i++).
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "log_level.h"
+ */
+
+#ifndef LOG_LEVEL_H
+#define LOG_LEVEL_H
+
+#include "Arduino.h"
+#include "serial_log.h"
+
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_NONE 5
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Print a kept message: LOG_MESSAGE("text") or LOG_MESSAGE("text", number)
+#define LOG_MESSAGE(message, ...) serial_log.println(F(message), ##__VA_ARGS__)
+
+// What a removed message becomes: nothing (but still needs its ; after it)
+#define LOG_REMOVED() do { } while (0)
+
+#if LOG_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) LOG_MESSAGE(__VA_ARGS__)
+#else
+#define LOG_TRACE(...) LOG_REMOVED()
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_MESSAGE(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_REMOVED()
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_MESSAGE(__VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_REMOVED()
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_MESSAGE(__VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_REMOVED()
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_MESSAGE(__VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_REMOVED()
+#endif
+
+#endif  // LOG_LEVEL_H
@@ -0,0 +1,109 @@
+"""
+log_size_report.py
+
+Show how much flash and RAM each sketch saves when its LOG_... debug messages
+(see log_level.h) are left out.
+
+    python3 log_size_report.py                               # every sketch using log_level.h
+    python3 log_size_report.py "Day 28 - Landing Gear.cpp"   # just this one
+
+Each sketch is compiled three times with arduino-cli
+(https://arduino.github.io/arduino-cli/): with every message (LOG_LEVEL_TRACE),
+with the sketch's own level, and with none (LOG_LEVEL_NONE).  arduino-cli needs
+the Arduino AVR boards and the libraries our sketches use installed:
+
+    arduino-cli core install arduino:avr
+    arduino-cli lib install U8g2 TM1637 Keypad
+
+The result is CSV, one line per sketch, in bytes:
+
+    sketch,trace_flash,flash,none_flash,flash_saved,trace_ram,ram,none_ram,ram_saved
+
+"flash" and "ram" are with the sketch's own level (LOG_LEVEL_INFO unless it
+defines LOG_LEVEL), and the "saved" columns are trace minus none.  For the
+levels to be set from here, a sketch's own #define LOG_LEVEL must be commented
+out.
+"""
+
+import argparse
+import glob
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+FQBN = "arduino:avr:uno"  # the HERO is an Arduino Uno
+LEVELS = [("trace", "-DLOG_LEVEL=0"), ("", None), ("none", "-DLOG_LEVEL=5")]
+
+FLASH_PATTERN = re.compile(r"Sketch uses (\d+) bytes")
+RAM_PATTERN = re.compile(r"Global variables use (\d+) bytes")
+
+
+def uses_log_level(sketch):
+    with open(sketch, encoding="utf-8", errors="replace") as source:
+        return '#include "log_level.h"' in source.read()
+
+
+def compile_size(sketch_dir, define):
+    """Compile the sketch in "sketch_dir", returning (flash, ram) in bytes."""
+    command = ["arduino-cli", "compile", "--fqbn", FQBN]
+    if define:
+        command += ["--build-property", "compiler.cpp.extra_flags=" + define]
+    command.append(sketch_dir)
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    flash = FLASH_PATTERN.search(result.stdout)
+    ram = RAM_PATTERN.search(result.stdout)
+    if result.returncode != 0 or not flash or not ram:
+        sys.stderr.write(result.stdout)
+        return None
+    return int(flash.group(1)), int(ram.group(1))
+
+
+def report(sketch, repo_dir):
+    """Sizes of "sketch" at each level, or None if it didn't compile."""
+    with tempfile.TemporaryDirectory() as temp_dir:
+        # arduino-cli wants a folder with a .ino of the same name, and our
+        # shared header files next to it
+        sketch_dir = os.path.join(temp_dir, "sketch")
+        os.mkdir(sketch_dir)
+        shutil.copy(sketch, os.path.join(sketch_dir, "sketch.ino"))
+        for header in glob.glob(os.path.join(repo_dir, "*.h")):
+            shutil.copy(header, sketch_dir)
+
+        sizes = []
+        for name, define in LEVELS:
+            size = compile_size(sketch_dir, define)
+            if size is None:
+                print("# %s didn't compile at %s level" % (sketch, name or "its own"), file=sys.stderr)
+                return None
+            sizes.append(size)
+    return sizes
+
+
+def main():
+    repo_dir = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description="Flash saved per sketch by removing LOG_... messages.")
+    parser.add_argument("sketches", nargs="*", help="sketches to check (default: every one using log_level.h)")
+    args = parser.parse_args()
+
+    if shutil.which("arduino-cli") is None:
+        sys.exit("log_size_report.py needs arduino-cli: https://arduino.github.io/arduino-cli/")
+
+    sketches = args.sketches or sorted(sketch for sketch in glob.glob(os.path.join(repo_dir, "Day *.cpp"))
+                                       if uses_log_level(sketch))
+    print("sketch,trace_flash,flash,none_flash,flash_saved,trace_ram,ram,none_ram,ram_saved", flush=True)
+    for sketch in sketches:
+        sizes = report(sketch, repo_dir)
+        if sizes is None:
+            continue
+        (trace_flash, trace_ram), (flash, ram), (none_flash, none_ram) = sizes
+        print("%s,%d,%d,%d,%d,%d,%d,%d,%d" % (os.path.basename(sketch),
+                                              trace_flash, flash, none_flash, trace_flash - none_flash,
+                                              trace_ram, ram, none_ram, trace_ram - none_ram), flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+/*
+ * output_group.h
+ *
+ * Change a group of LEDs (or any outputs) all at the same instant.
+ *
+ * Turning six LEDs on with six digitalWrite() calls changes them one after
+ * another, about 3.5 microseconds apart, and each call spends most of its
+ * time looking up the pin.  An OutputGroup takes the new state of every LED
+ * as one byte, one bit per LED in the order they were listed:
+ *
+ *   OutputGroup<13, 12, 11> leds;  // bit 0 = pin 13, bit 1 = pin 12, bit 2 = pin 11
+ *   leds.write(0b101);             // pins 13 and 11 on, pin 12 off
+ *
+ * All of the pins on the same port change with a single write to that port,
+ * so they switch at exactly the same moment and there is never an in-between
+ * state where only some have changed.  Pins not in the group keep their
+ * value.
+ *
+ * Clock cycles to update Day 5's six LEDs (all on PORTB), estimated by
+ * counting the instructions each compiles to (define RUN_OUTPUT_BENCHMARK in
+ * Day 5 to measure them on the HERO):
+ *   six digitalWrite() calls:   about 330 cycles, LEDs change over ~20 us
+ *   one OutputGroup write():    about 25 cycles, every LED changes at once
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "output_group.h"
+ */
+
+#ifndef OUTPUT_GROUP_H
+#define OUTPUT_GROUP_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "fast_pin.h"
+
+namespace output_group_detail {
+
+// For the pins from FIRST up to (but not including) LAST - the pins on one
+// port - work out their port bits.  INDEX is the group bit of the first pin.
+template <byte FIRST, byte LAST, byte INDEX, byte... PINS>
+struct PortBits {
+  static constexpr byte mask() {
+    return 0;
+  }
+
+  static inline byte spread(byte) {
+    return 0;
+  }
+};
+
+template <byte FIRST, byte LAST, byte INDEX, byte PIN, byte... OTHERS>
+struct PortBits<FIRST, LAST, INDEX, PIN, OTHERS...> {
+  typedef PortBits<FIRST, LAST, INDEX + 1, OTHERS...> Next;
+  static constexpr bool ON_PORT = (PIN >= FIRST && PIN < LAST);
+
+  // Bits of this port that belong to the group.
+  static constexpr byte mask() {
+    return (ON_PORT ? Pin<PIN>::MASK : 0) | Next::mask();
+  }
+
+  // Port bits to set for the group bits in "bits".
+  static inline byte spread(byte bits) {
+    return ((ON_PORT && (bits & (1 << INDEX))) ? Pin<PIN>::MASK : 0) | Next::spread(bits);
+  }
+};
+
+}  // namespace output_group_detail
+
+template <byte... PINS>
+class OutputGroup {
+  static_assert(sizeof...(PINS) >= 1 && sizeof...(PINS) <= 8, "OutputGroup holds 1 to 8 pins");
+
+  typedef output_group_detail::PortBits<8, 14, 0, PINS...> PortB;   // pins 8-13
+  typedef output_group_detail::PortBits<14, 20, 0, PINS...> PortC;  // A0-A5
+  typedef output_group_detail::PortBits<0, 8, 0, PINS...> PortD;    // pins 0-7
+
+public:
+  static const byte COUNT = sizeof...(PINS);  // number of pins in the group
+
+  constexpr OutputGroup() {}
+
+  // pinMode(pin, OUTPUT) for every pin in the group.
+  static void output() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if (PortB::mask()) DDRB |= PortB::mask();
+      if (PortC::mask()) DDRC |= PortC::mask();
+      if (PortD::mask()) DDRD |= PortD::mask();
+    }
+  }
+
+  /*
+   * Set every pin in the group: bit 0 of "bits" is the first pin listed, bit
+   * 1 the second, and so on (1 = HIGH).  Each port is written once, with
+   * interrupts held off so an interrupt changing another pin on the same
+   * port can't be undone by our write.
+   */
+  static void write(byte bits) {
+    byte port_b = PortB::spread(bits);
+    byte port_c = PortC::spread(bits);
+    byte port_d = PortD::spread(bits);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if (PortB::mask()) PORTB = (PORTB & ~PortB::mask()) | port_b;
+      if (PortC::mask()) PORTC = (PORTC & ~PortC::mask()) | port_c;
+      if (PortD::mask()) PORTD = (PORTD & ~PortD::mask()) | port_d;
+    }
+  }
+};
+
+#endif  // OUTPUT_GROUP_H
@@ -0,0 +1,123 @@
+/*
+ * pin_change.h
+ *
+ * Run a function the moment a pin changes, on ANY pin of the HERO board.
+ *
+ * attachInterrupt() only works on pins 2 and 3.  Every other pin can still
+ * interrupt the HERO using "pin change interrupts", but they are grouped by
+ * port: one interrupt for pins 8-13 (PCINT0), one for A0-A5 (PCINT1) and one
+ * for pins 0-7 (PCINT2).  The interrupt only says "something on this port
+ * changed", so this file owns all three interrupts and works out which pins
+ * changed before calling the functions that asked about them:
+ *
+ *   void leverMoved(byte port, byte pins, byte changed) { ... }
+ *
+ *   pin_change.attach(A0, leverMoved);
+ *
+ * "pins" is the port's input register read at the start of the interrupt and
+ * "changed" has a 1 for each attached pin that changed since the last one.
+ * Handlers run inside the interrupt, so keep them short.
+ *
+ * Other files (like lever_monitor.h) use this file rather than defining
+ * their own PCINT interrupts, so they can all be used in the same sketch.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "pin_change.h"
+ */
+
+#ifndef PIN_CHANGE_H
+#define PIN_CHANGE_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+
+class PinChange {
+public:
+  static const byte MAX_HANDLERS = 4;  // different handler/port pairs that can be attached
+  static const byte PORT_COUNT = 3;    // 0 = pins 8-13, 1 = A0-A5, 2 = pins 0-7 (same as PCICR bits)
+
+  // Called from the interrupt: port number, port reading, attached pins that changed.
+  typedef void (*Handler)(byte port, byte pins, byte changed);
+
+  PinChange()
+    : handler_count(0) {
+    memset(last_pins, 0, sizeof(last_pins));
+  }
+
+  /*
+   * Call "handler" whenever "pin" changes.  The pin's mode isn't changed, so
+   * set it up with pinMode() first.  Returns false if the pin can't use pin
+   * change interrupts or MAX_HANDLERS handlers are already attached.
+   */
+  bool attach(byte pin, Handler handler) {
+    if (digitalPinToPCICR(pin) == 0) {
+      return false;
+    }
+    byte port = digitalPinToPCICRbit(pin);
+    byte mask = _BV(digitalPinToPCMSKbit(pin));
+
+    bool attached = false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      // Share an entry with the same handler on the same port if there is one
+      for (byte i = 0; i < handler_count && !attached; i++) {
+        if (handlers[i].port == port && handlers[i].handler == handler) {
+          handlers[i].mask |= mask;
+          attached = true;
+        }
+      }
+      if (!attached && handler_count < MAX_HANDLERS) {
+        handlers[handler_count].port = port;
+        handlers[handler_count].mask = mask;
+        handlers[handler_count].handler = handler;
+        handler_count++;
+        attached = true;
+      }
+      if (attached) {
+        last_pins[port] = *portInputRegister(digitalPinToPort(pin));
+        *digitalPinToPCMSK(pin) |= mask;  // watch this pin...
+        PCIFR = _BV(port);                // ...forget any change from before now...
+        PCICR |= _BV(port);               // ...and turn on the interrupt for its port
+      }
+    }
+    return attached;
+  }
+
+  // Called only by the interrupts below.
+  inline void serviceInterrupt(byte port, byte pins) {
+    byte changed = pins ^ last_pins[port];
+    last_pins[port] = pins;
+    for (byte i = 0; i < handler_count; i++) {
+      if (handlers[i].port == port && (handlers[i].mask & changed)) {
+        handlers[i].handler(port, pins, handlers[i].mask & changed);
+      }
+    }
+  }
+
+private:
+  struct Entry {
+    byte port;        // port number (see PORT_COUNT)
+    byte mask;        // pins on that port this handler wants to hear about
+    Handler handler;  // function to call
+  };
+
+  Entry handlers[MAX_HANDLERS];
+  byte handler_count;
+  byte last_pins[PORT_COUNT];  // port readings from the last interrupt
+};
+
+// The one pin change controller, used like Serial: pin_change.attach(A0, leverMoved);
+PinChange pin_change;
+
+ISR(PCINT0_vect) {
+  pin_change.serviceInterrupt(0, PINB);
+}
+
+ISR(PCINT1_vect) {
+  pin_change.serviceInterrupt(1, PINC);
+}
+
+ISR(PCINT2_vect) {
+  pin_change.serviceInterrupt(2, PIND);
+}
+
+#endif  // PIN_CHANGE_H
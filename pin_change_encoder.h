@@ -0,0 +1,86 @@
+/*
+ * pin_change_encoder.h
+ *
+ * A rotary encoder on ANY two pins of the HERO board.
+ *
+ * attachInterrupt() only works on pins 2 and 3, so an encoder wired the
+ * Day 18 way uses up both of them.  A PinChangeEncoder is a QuadratureEncoder
+ * (see quadrature_encoder.h) that is serviced by pin change interrupts
+ * instead (see pin_change.h), so it can go on whichever pins are free and
+ * share the interrupts with other parts like lever_monitor.h:
+ *
+ *   PinChangeEncoder<THRUST_CONTROL_A_PIN, THRUST_CONTROL_B_PIN> thrust_control;
+ *
+ *   thrust_control.begin();  // in setup(), no attachInterrupt() needed
+ *   ...
+ *   lander_speed += thrust_control.getChange();
+ *
+ * Everything else (getCount(), getChange(), snapshot(), velocity()...) works
+ * just like QuadratureEncoder.
+ *
+ * The two pins don't even have to be on the same port.  service() reads both
+ * pins again when either one changes, so it always sees the pair together.
+ *
+ * Pin change interrupts come before the I2C and Serial interrupts, so the
+ * encoder is still read while the OLED display is being sent a new picture.
+ * interruptCount() says how many interrupts the encoder has had, so a sketch
+ * can work out how much of the HERO's time they take (Day 29 does this when
+ * RUN_ISR_LOAD_TEST is defined).
+ *
+ * Only one PinChangeEncoder can use a given pair of pins.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "pin_change_encoder.h"
+ */
+
+#ifndef PIN_CHANGE_ENCODER_H
+#define PIN_CHANGE_ENCODER_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "quadrature_encoder.h"
+#include "pin_change.h"
+
+template <byte PIN_A, byte PIN_B>
+class PinChangeEncoder : public QuadratureEncoder<PIN_A, PIN_B> {
+public:
+  PinChangeEncoder()
+    : interrupt_count(0) {}
+
+  /*
+   * Set both pins as INPUT_PULLUP, start from the dial's current position and
+   * start watching both pins.  Returns false if pin_change has no room for
+   * them (see PinChange::MAX_HANDLERS).
+   */
+  bool begin() {
+    QuadratureEncoder<PIN_A, PIN_B>::begin();
+    attached_encoder = this;
+    return pin_change.attach(PIN_A, pinsChanged) && pin_change.attach(PIN_B, pinsChanged);
+  }
+
+  // Pin change interrupts this encoder has had since begin().  Counts up
+  // from 0 and wraps around, so subtract two readings to get the count between.
+  unsigned int interruptCount() const {
+    unsigned int count;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      count = interrupt_count;
+    }
+    return count;
+  }
+
+private:
+  // Called by pin_change whenever either pin changes.
+  static void pinsChanged(byte, byte, byte) {
+    attached_encoder->interrupt_count++;
+    attached_encoder->service();
+  }
+
+  static PinChangeEncoder *attached_encoder;  // the encoder on these pins
+
+  volatile unsigned int interrupt_count;  // interrupts since begin()
+};
+
+template <byte PIN_A, byte PIN_B>
+PinChangeEncoder<PIN_A, PIN_B> *PinChangeEncoder<PIN_A, PIN_B>::attached_encoder = 0;
+
+#endif  // PIN_CHANGE_ENCODER_H
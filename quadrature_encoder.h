@@ -0,0 +1,274 @@
+/*
+ * quadrature_encoder.h
+ *
+ * Fast rotary encoder decoder, a replacement for the BasicEncoder library.
+ *
+ * A rotary encoder has two switches, A and B, that turn on and off a quarter
+ * of a step apart as the dial turns.  Reading both pins gives a 2 bit "state",
+ * and turning one way steps through the states in one order while turning the
+ * other way steps through them backwards:
+ *
+ *   A leads (count up):    B A  00 -> 01 -> 11 -> 10 -> 00
+ *   B leads (count down):  B A  00 -> 10 -> 11 -> 01 -> 00
+ *
+ * Instead of working out the direction with if statements, we look it up.
+ * The last state and the new state together make a 4 bit number (0-15), and
+ * TRANSITIONS[] holds +1, -1 or 0 for each of the 16 possibilities.  A change
+ * of both pins at once is impossible for a real encoder (it's noise, or we
+ * missed a change) so those entries are 0 and are ignored.
+ *
+ * Each click ("detent") of the dial is 4 state changes, and the dial rests
+ * with both pins HIGH.  The changes are added up and the count only moves
+ * when the dial arrives back at rest, so contact bounce that goes back and
+ * forth cancels itself out.
+ *
+ * Both pins are read with a single port read (see input_snapshot.h), so
+ * service() takes about 30 clock cycles.  The BasicEncoder library uses
+ * digitalRead() and takes several times longer - Day 18 measures both when
+ * RUN_ENCODER_BENCHMARK is defined.
+ *
+ * Use it just like BasicEncoder: call service() from an interrupt whenever
+ * either pin changes, and read the count in loop().  If the dial counts the
+ * wrong way, swap the two pin numbers.
+ *
+ * The encoder also records the time (micros()) of the last few clicks, so it
+ * can tell how fast the dial is turning.  velocity() is clicks per second
+ * measured over the last SPEED_WINDOW clicks, and acceleration() is how fast
+ * that is changing, in clicks per second per second.  Both are up to date as
+ * soon as a click happens, however slowly loop() runs.
+ *
+ * The count is 2 bytes, and the HERO reads 1 byte at a time, so an interrupt
+ * could change the count half way through loop() reading it.  Instead of
+ * turning interrupts off to read it, service() adds 1 to a "sequence" number
+ * before and after every change.  Readers note the sequence number, copy the
+ * values, and simply read again if the number changed in the meantime.
+ * snapshot() uses this to return the count and the change together.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "quadrature_encoder.h"
+ */
+
+#ifndef QUADRATURE_ENCODER_H
+#define QUADRATURE_ENCODER_H
+
+#include "Arduino.h"
+#include "input_snapshot.h"
+
+namespace quadrature_encoder_detail {
+
+// Direction for each (last state << 2 | new state), with state = B << 1 | A.
+const int8_t TRANSITIONS[16] PROGMEM = {
+  0,   // 00 -> 00  no change
+  +1,  // 00 -> 01
+  -1,  // 00 -> 10
+  0,   // 00 -> 11  invalid
+  -1,  // 01 -> 00
+  0,   // 01 -> 01  no change
+  0,   // 01 -> 10  invalid
+  +1,  // 01 -> 11
+  +1,  // 10 -> 00
+  0,   // 10 -> 01  invalid
+  0,   // 10 -> 10  no change
+  -1,  // 10 -> 11
+  0,   // 11 -> 00  invalid
+  -1,  // 11 -> 01
+  +1,  // 11 -> 10
+  0    // 11 -> 11  no change
+};
+
+}  // namespace quadrature_encoder_detail
+
+template <byte PIN_A, byte PIN_B>
+class QuadratureEncoder {
+public:
+  static const byte REST_STATE = 0b11;  // both pins HIGH between clicks
+  static const byte SPEED_WINDOW = 4;   // clicks used to measure speed (must be a power of 2)
+
+  // If there hasn't been a click for this long the dial counts as stopped.
+  static const unsigned long STOPPED_MICROS = 500000UL;
+
+  // The count and the change since the last look, read at the same moment.
+  struct Snapshot {
+    int count;   // clicks since the start (or the last reset())
+    int change;  // clicks since the last snapshot() or getChange()
+  };
+
+  QuadratureEncoder()
+    : count(0), count_offset(0), last_count(0), state(REST_STATE), steps(0), sequence(0),
+      click_head(0), click_count(0), direction(0) {}
+
+  // Set both pins as INPUT_PULLUP and start from the dial's current position.
+  void begin() {
+    Pin<PIN_A>::inputPullup();
+    Pin<PIN_B>::inputPullup();
+    state = Pins::read();
+  }
+
+  // Call from an interrupt whenever either pin changes.
+  inline void service() {
+    byte new_state = Pins::read();
+    steps += (int8_t)pgm_read_byte(&quadrature_encoder_detail::TRANSITIONS[(state << 2) | new_state]);
+    state = new_state;
+
+    // Back at rest: a whole click (4 steps) moves the count.  Allow for one
+    // missed step, and forget anything less (the dial went back).
+    if (new_state == REST_STATE) {
+      int8_t click = (steps >= 2) ? +1 : (steps <= -2) ? -1 : 0;
+      steps = 0;
+      if (click != 0) {
+        sequence++;  // odd: count and click times are changing
+        count += click;
+        recordClick(click);
+        sequence++;  // even: finished changing
+      }
+    }
+  }
+
+  // Read the count and the change since the last look together.
+  Snapshot snapshot() {
+    Snapshot now;
+    now.count = readCount() - count_offset;
+    now.change = now.count - last_count;
+    last_count = now.count;
+    return now;
+  }
+
+  /*
+   * How fast the dial is turning in clicks per second (negative when turning
+   * down), averaged over the last SPEED_WINDOW clicks.  "now" is micros().
+   * Returns 0 once the dial has stopped for STOPPED_MICROS.
+   */
+  long velocity(unsigned long now) {
+    ClickTimes clicks;
+    copyClickTimes(clicks);
+    if (clicks.count < 2 || now - clicks.time(0) >= STOPPED_MICROS) {
+      return 0;
+    }
+    unsigned long span = clicks.time(0) - clicks.time(clicks.count - 1);
+    long speed = clicksPerSecond(clicks.count - 1, span);
+
+    // Waited longer than the average gap for the next click?  Then we can't be
+    // turning faster than one click in the time since the last one.
+    unsigned long waiting = now - clicks.time(0);
+    if (waiting * (clicks.count - 1) > span) {
+      speed = clicksPerSecond(1, waiting);
+    }
+    return clicks.direction * speed;
+  }
+
+  /*
+   * How fast velocity() is changing, in clicks per second per second,
+   * from the speeds of the last two click gaps.  "now" is micros().
+   */
+  long acceleration(unsigned long now) {
+    ClickTimes clicks;
+    copyClickTimes(clicks);
+    if (clicks.count < 3 || now - clicks.time(0) >= STOPPED_MICROS) {
+      return 0;
+    }
+    unsigned long newer_gap = clicks.time(0) - clicks.time(1);
+    unsigned long older_gap = clicks.time(1) - clicks.time(2);
+    long speed_change = clicksPerSecond(1, newer_gap) - clicksPerSecond(1, older_gap);
+
+    // The two speeds are measured in the middle of each gap, so they are
+    // (newer_gap + older_gap) / 2 apart.  Work in milliseconds so the math
+    // fits in a long.
+    long time_between = (newer_gap + older_gap) / 2000;
+    if (time_between == 0) {
+      time_between = 1;
+    }
+    return clicks.direction * speed_change * 1000L / time_between;
+  }
+
+  // Clicks counted since the start (or the last reset()).
+  int getCount() {
+    return readCount() - count_offset;
+  }
+
+  // Clicks counted since the last call to getChange() or snapshot() (0 if none).
+  int getChange() {
+    return snapshot().change;
+  }
+
+  // Set the count back to 0.  Only loop() changes count_offset, so this
+  // doesn't need to stop service() either.
+  void reset() {
+    count_offset = readCount();
+    last_count = 0;
+  }
+
+private:
+  typedef InputSnapshot<PIN_A, PIN_B> Pins;  // bit 0 = A, bit 1 = B
+
+  // A copy of the click times, so they can't change while we work with them.
+  struct ClickTimes {
+    unsigned long times[SPEED_WINDOW];
+    byte head;         // where the next click will go
+    byte count;        // clicks recorded (up to SPEED_WINDOW)
+    int8_t direction;  // +1 or -1 for the recorded clicks
+
+    // Time of a click, 0 = newest, 1 = the one before...
+    unsigned long time(byte age) const {
+      return times[(head - 1 - age) & (SPEED_WINDOW - 1)];
+    }
+  };
+
+  // Called from service() for each click.  A change of direction starts the
+  // speed measurement over.
+  inline void recordClick(int8_t click_direction) {
+    if (click_direction != direction) {
+      direction = click_direction;
+      click_count = 0;
+    }
+    click_times[click_head] = micros();
+    click_head = (click_head + 1) & (SPEED_WINDOW - 1);
+    if (click_count < SPEED_WINDOW) {
+      click_count++;
+    }
+  }
+
+  // Read the count, trying again if service() changed it while we read.
+  int readCount() const {
+    byte before;
+    int value;
+    do {
+      before = sequence;
+      value = count;
+    } while (before != sequence || (before & 1));
+    return value;
+  }
+
+  // Copy the click times, trying again if service() changed them while we read.
+  // Each time is read through the volatile array (not memcpy(), which would let
+  // the compiler read them once, before the loop) so a retry really reads again.
+  void copyClickTimes(ClickTimes &clicks) const {
+    byte before;
+    do {
+      before = sequence;
+      for (byte i = 0; i < SPEED_WINDOW; i++) {
+        clicks.times[i] = click_times[i];
+      }
+      clicks.head = click_head;
+      clicks.count = click_count;
+      clicks.direction = direction;
+    } while (before != sequence || (before & 1));
+  }
+
+  static long clicksPerSecond(byte clicks, unsigned long microseconds) {
+    return (microseconds == 0) ? 0 : clicks * 1000000L / (long)microseconds;
+  }
+
+  volatile int count;      // clicks, changed by service()
+  int count_offset;        // count at the last reset()
+  int last_count;          // getCount() at the last snapshot()
+  byte state;              // last B << 1 | A reading
+  int8_t steps;            // state changes since the dial was last at rest
+  volatile byte sequence;  // odd while service() is changing count or the click times
+
+  volatile unsigned long click_times[SPEED_WINDOW];  // micros() of recent clicks
+  volatile byte click_head;                          // where the next click time goes
+  volatile byte click_count;                         // click times recorded (up to SPEED_WINDOW)
+  volatile int8_t direction;                         // direction of the recorded clicks
+};
+
+#endif  // QUADRATURE_ENCODER_H
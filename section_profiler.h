@@ -0,0 +1,176 @@
+/*
+ * section_profiler.h
+ *
+ * Find out where the time goes inside loop(), to the clock cycle.
+ *
+ * Put PROFILE_SCOPE() at the top of any block of code (a "section") with a
+ * short name.  From there to the end of the block is timed with cycle_clock
+ * (see cycle_clock.h), which counts every one of the HERO's 16 million clock
+ * cycles a second:
+ *
+ *   void updateLanderDisplay() {
+ *     PROFILE_SCOPE("oled");
+ *     ...
+ *   }  // timing stops here, however the function returns
+ *
+ *   profiler.begin();               // in setup()
+ *   profiler.printReport(Serial);   // whenever we want to see the results
+ *
+ * For each section the profiler keeps the number of runs and the shortest,
+ * longest and total time.  printReport() prints one short line per section,
+ * separated by commas, ready for a spreadsheet:
+ *
+ *   section,runs,min_cycles,avg_cycles,max_cycles,total_us
+ *   oled,412,398211,401557,431093,10340092
+ *
+ * Reading the clock takes a few cycles itself, so begin() times an empty
+ * section and takes that off every measurement.
+ *
+ * Profiling is turned off unless the sketch has
+ *   #define PROFILE_SECTIONS
+ * before it includes this file.  When it is off PROFILE_SCOPE() is removed
+ * completely, so it costs nothing at all, and begin() and printReport() do
+ * nothing (begin() leaves Timer1 alone), so they can stay in the sketch.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "section_profiler.h"
+ */
+
+#ifndef SECTION_PROFILER_H
+#define SECTION_PROFILER_H
+
+#include "Arduino.h"
+#include "cycle_clock.h"
+
+class SectionProfiler {
+public:
+  static const byte MAX_SECTIONS = 8;  // named sections (each uses 22 bytes of RAM)
+  static const byte NO_SECTION = 255;  // returned by addSection() if there is no room
+
+  SectionProfiler()
+    : section_count(0), overhead(0) {}
+
+  // Start cycle_clock and measure the cost of timing a section.
+  void begin() {
+#ifdef PROFILE_SECTIONS
+    cycle_clock.begin();
+    unsigned long start = cycle_clock.now();
+    overhead = cycle_clock.now() - start;
+#endif
+  }
+
+  // Used by PROFILE_SCOPE() the first time each section runs.
+  byte addSection(const __FlashStringHelper *name) {
+    if (section_count == MAX_SECTIONS) {
+      return NO_SECTION;
+    }
+    Section &section = sections[section_count];
+    section.name = name;
+    clearSection(section);
+    return section_count++;
+  }
+
+  // Used by PROFILE_SCOPE() at the end of each section.
+  void record(byte section_number, unsigned long start) {
+    unsigned long cycles = cycle_clock.now() - start;
+    cycles = (cycles > overhead) ? cycles - overhead : 0;
+    if (section_number >= section_count) {
+      return;
+    }
+    Section &section = sections[section_number];
+    section.runs++;
+    section.total_cycles += cycles;
+    if (cycles < section.min_cycles) {
+      section.min_cycles = cycles;
+    }
+    if (cycles > section.max_cycles) {
+      section.max_cycles = cycles;
+    }
+  }
+
+  /*
+   * Print one line per section: its name, runs, shortest, average and
+   * longest time in clock cycles (16 per microsecond), and the total time
+   * in microseconds.
+   */
+  void printReport(Print &out) const {
+#ifndef PROFILE_SECTIONS
+    (void)out;  // profiling is off, nothing to print
+#else
+    out.println(F("section,runs,min_cycles,avg_cycles,max_cycles,total_us"));
+    for (byte section_number = 0; section_number < section_count; section_number++) {
+      const Section &section = sections[section_number];
+      out.print(section.name);
+      out.print(',');
+      out.print(section.runs);
+      out.print(',');
+      out.print(section.runs ? section.min_cycles : 0);
+      out.print(',');
+      out.print(section.runs ? (unsigned long)(section.total_cycles / section.runs) : 0);
+      out.print(',');
+      out.print(section.max_cycles);
+      out.print(',');
+      out.println((unsigned long)(section.total_cycles / CycleClock::CYCLES_PER_MICROSECOND));
+    }
+#endif
+  }
+
+  // Start every section's counts again from 0.
+  void clearStats() {
+    for (byte section_number = 0; section_number < section_count; section_number++) {
+      clearSection(sections[section_number]);
+    }
+  }
+
+private:
+  struct Section {
+    const __FlashStringHelper *name;
+    unsigned long runs;
+    unsigned long min_cycles;
+    unsigned long max_cycles;
+    unsigned long long total_cycles;  // 64 bits, so it won't wrap however long we run
+  };
+
+  static void clearSection(Section &section) {
+    section.runs = 0;
+    section.min_cycles = 0xFFFFFFFF;
+    section.max_cycles = 0;
+    section.total_cycles = 0;
+  }
+
+  Section sections[MAX_SECTIONS];
+  byte section_count;      // sections added so far
+  unsigned long overhead;  // cycles taken by timing an empty section
+};
+
+// The one profiler, used like Serial: profiler.printReport(Serial)
+SectionProfiler profiler;
+
+// Times from where it is made to the end of its block (see PROFILE_SCOPE()).
+class ProfileScope {
+public:
+  ProfileScope(byte section)
+    : section_number(section), start(cycle_clock.now()) {}
+
+  ~ProfileScope() {
+    profiler.record(section_number, start);
+  }
+
+private:
+  byte section_number;
+  unsigned long start;
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+
+#ifdef PROFILE_SECTIONS
+// Time from here to the end of the block as the section called "name".
+#define PROFILE_SCOPE(name)                                                          \
+  static byte PROFILE_JOIN(profile_section_, __LINE__) = profiler.addSection(F(name)); \
+  ProfileScope PROFILE_JOIN(profile_scope_, __LINE__)(PROFILE_JOIN(profile_section_, __LINE__))
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+#endif  // SECTION_PROFILER_H
@@ -0,0 +1,195 @@
+/*
+ * sensor_filter.h
+ *
+ * Small, integer-only filters for smoothing noisy analogRead() values such as
+ * the readings from our photoresistor.  Everything here uses whole numbers and
+ * bit shifts (no float math) so each new sample costs only a few instructions
+ * on the HERO board.
+ *
+ * - EmaFilter<SHIFT>:     Exponential moving average.  Each sample moves the
+ *                         output 1/(2^SHIFT) of the way toward the new value.
+ * - MedianOf3Filter:      Returns the middle of the last three samples, which
+ *                         throws away single "spikes" completely.
+ * - BiquadFilter<...>:    A 2-pole (second order) low-pass filter with
+ *                         coefficients fixed at compile time.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "sensor_filter.h"
+ */
+
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include "Arduino.h"
+
+/*
+ * Exponential moving average (EMA) filter.
+ *
+ * Rather than storing the filtered value directly we store it multiplied by
+ * 2^SHIFT.  This keeps the fractional part of the average so small changes are
+ * not lost, and lets us divide using a shift instead of a slow division:
+ *
+ *   accumulator = accumulator - (accumulator >> SHIFT) + sample
+ *   output      = accumulator >> SHIFT
+ *
+ * Larger SHIFT values smooth more but respond more slowly.  With SHIFT = 3 the
+ * output moves 1/8 of the way to each new sample.  The default 16 bit
+ * accumulator holds a 10 bit analogRead() value for SHIFT values up to 6.
+ */
+template <byte SHIFT, typename ACCUMULATOR = uint16_t>
+class EmaFilter {
+  static_assert(SHIFT > 0 && SHIFT < 8 * sizeof(ACCUMULATOR), "SHIFT out of range");
+  static_assert((1023UL << SHIFT) <= (unsigned long)(ACCUMULATOR)~(ACCUMULATOR)0,
+                "ACCUMULATOR too small for a 10 bit reading at this SHIFT");
+
+public:
+  EmaFilter()
+    : accumulator(0), primed(false) {}
+
+  // Add a new sample and return the new filtered value.
+  unsigned int update(unsigned int sample) {
+    if (!primed) {  // First sample starts the average at that value rather than at 0
+      accumulator = (ACCUMULATOR)sample << SHIFT;
+      primed = true;
+    } else {
+      accumulator = accumulator - (accumulator >> SHIFT) + sample;
+    }
+    return value();
+  }
+
+  // Current filtered value, without adding a sample.
+  unsigned int value() const {
+    return accumulator >> SHIFT;
+  }
+
+  // Forget all history.  The next sample becomes the starting value.
+  void reset() {
+    primed = false;
+  }
+
+private:
+  ACCUMULATOR accumulator;  // filtered value multiplied by 2^SHIFT
+  bool primed;              // false until the first sample is seen
+};
+
+/*
+ * Median of 3 filter.
+ *
+ * Keeps the last three samples and returns the middle one.  A single bad
+ * reading (a "spike") can never reach the output, yet a real change passes
+ * through after only one extra sample.  Works well in front of an EmaFilter.
+ */
+class MedianOf3Filter {
+public:
+  MedianOf3Filter()
+    : count(0), next(0) {}
+
+  // Add a new sample and return the median of the last three samples.
+  unsigned int update(unsigned int sample) {
+    if (count == 0) {  // First sample fills the history so we start at that value
+      samples[0] = samples[1] = samples[2] = sample;
+      count = 1;
+    }
+    samples[next] = sample;
+    next = (next == 2) ? 0 : next + 1;
+    return value();
+  }
+
+  // Median of the last three samples.
+  unsigned int value() const {
+    unsigned int a = samples[0];
+    unsigned int b = samples[1];
+    unsigned int c = samples[2];
+    if (a > b) {  // swap so that a <= b
+      unsigned int t = a;
+      a = b;
+      b = t;
+    }
+    // Median is b unless c is below it, then it is the larger of a and c
+    return (c >= b) ? b : ((c > a) ? c : a);
+  }
+
+  // Forget all history.
+  void reset() {
+    count = 0;
+    next = 0;
+  }
+
+private:
+  unsigned int samples[3];  // last three samples
+  byte count;               // 0 until the first sample is seen
+  byte next;                // index where the next sample is stored
+};
+
+/*
+ * 2-pole (biquad) low-pass filter using fixed point math.
+ *
+ * The five coefficients are given as whole numbers scaled by 2^14 (16384), so
+ * 0.5 is written as 8192.  The filter computes:
+ *
+ *   y = (B0 * x + B1 * x1 + B2 * x2 - A1 * y1 - A2 * y2) / 16384
+ *
+ * where x1, x2 are the previous two inputs and y1, y2 the previous two outputs.
+ * Inputs and outputs are kept with 4 extra fractional bits, and the bits lost
+ * when dividing by 16384 are carried into the next sample ("error feedback"),
+ * so the output never gets "stuck" a little short of a steady input.
+ *
+ * Ready made low-pass filters are defined below (LowPassBiquad...).  The
+ * number in the name is the cutoff frequency in hundredths of the sample rate,
+ * so LowPassBiquad5 passes changes slower than 5% of the rate we sample at.
+ * B0 + B1 + B2 must equal 16384 + A1 + A2 so a steady input gives the same
+ * steady output.
+ */
+template <int B0, int B1, int B2, int A1, int A2>
+class BiquadFilter {
+  static_assert(B0 + B1 + B2 == 16384L + A1 + A2, "Biquad coefficients must have unity DC gain");
+
+public:
+  BiquadFilter()
+    : x1(0), x2(0), y1(0), y2(0), remainder(0), primed(false) {}
+
+  // Add a new sample and return the new filtered value.
+  unsigned int update(unsigned int sample) {
+    int x0 = sample << FRACTION_BITS;
+    if (!primed) {  // Start "settled" at the first sample rather than ramping up from 0
+      x1 = x2 = y1 = y2 = x0;
+      remainder = 0;
+      primed = true;
+    }
+    long acc = (long)B0 * x0 + (long)B1 * x1 + (long)B2 * x2
+               - (long)A1 * y1 - (long)A2 * y2 + remainder;
+    x2 = x1;
+    x1 = x0;
+    y2 = y1;
+    y1 = acc >> COEFFICIENT_BITS;                      // scale back down
+    remainder = acc - ((long)y1 << COEFFICIENT_BITS);  // save the bits the shift dropped
+    return value();
+  }
+
+  // Current filtered value, without adding a sample.
+  unsigned int value() const {
+    // A sudden step can overshoot slightly below 0, never show that as a huge number
+    return (y1 < 0) ? 0 : (y1 + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS;
+  }
+
+  // Forget all history.  The next sample becomes the starting value.
+  void reset() {
+    primed = false;
+  }
+
+private:
+  static const byte COEFFICIENT_BITS = 14;  // coefficients are scaled by 2^14
+  static const byte FRACTION_BITS = 4;      // extra precision kept on inputs and outputs
+
+  int x1, x2;     // previous two inputs (scaled by 2^FRACTION_BITS)
+  int y1, y2;     // previous two outputs (scaled by 2^FRACTION_BITS)
+  int remainder;  // bits dropped by the last shift, added back next sample
+  bool primed;    // false until the first sample is seen
+};
+
+// Butterworth low-pass filters, cutoff at 2%, 5% and 10% of the sample rate.
+typedef BiquadFilter<59, 119, 59, -29863, 13716> LowPassBiquad2;
+typedef BiquadFilter<329, 658, 329, -25576, 10508> LowPassBiquad5;
+typedef BiquadFilter<1105, 2210, 1105, -18727, 6763> LowPassBiquad10;
+
+#endif  // SENSOR_FILTER_H
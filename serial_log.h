@@ -0,0 +1,166 @@
+/*
+ * serial_log.h
+ *
+ * Print messages to the Serial Monitor without ever making loop() wait.
+ *
+ * Serial.print() puts characters in a 64 character buffer, and they are sent
+ * from there at about 1 ms each (at 9600 baud).  Once the buffer is full,
+ * Serial.print() waits until there is room - so a sketch printing every loop
+ * ends up running only as fast as the Serial port.  serial_log checks there
+ * is room for the whole message first (with Serial.availableForWrite()), and
+ * if there isn't it returns straight away instead of waiting:
+ *
+ *   serial_log.println(F("Done!!"));
+ *   serial_log.println(F("Gear: "), current_gear_bitmap);  // "Gear: 3"
+ *
+ * A message that doesn't fit is either:
+ *   COALESCE (the default): if it is the same as the last message sent, counted
+ *            as a repeat.  Once there is room again they are shown as one line,
+ *            "Gear: 3 x37", meaning 37 more of "Gear: 3" weren't printed.
+ *            Any other message is dropped.
+ *   DROP:    dropped.
+ * Dropped messages are counted, and "(dropped 12)" is printed once there is
+ * room, so we can see something was missed.
+ *
+ * Messages are always a string in flash (with F()), optionally followed by a
+ * number, then a newline.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "serial_log.h"
+ */
+
+#ifndef SERIAL_LOG_H
+#define SERIAL_LOG_H
+
+#include "Arduino.h"
+
+class SerialLog {
+public:
+  // What to do with a message when the Serial buffer is full.
+  enum FULL_POLICY {
+    COALESCE,  // count repeats of the last message, drop anything else
+    DROP       // drop it
+  };
+
+  // constexpr, so a sketch that never logs anything (see log_level.h) doesn't
+  // even have code to set serial_log up.
+  constexpr SerialLog()
+    : port(&Serial), policy(COALESCE), last_message(NULL), last_has_value(false),
+      last_value(0), repeats(0), unreported_drops(0), dropped(0), coalesced(0) {}
+
+  // Log to "serial" instead of Serial (it must already be started).
+  void begin(HardwareSerial &serial, FULL_POLICY full_policy = COALESCE) {
+    port = &serial;
+    policy = full_policy;
+  }
+
+  // Print "message" and a newline, if there is room.  Returns false if not.
+  bool println(const __FlashStringHelper *message) {
+    return log(message, false, 0);
+  }
+
+  // Print "label", "value" and a newline, if there is room.
+  bool println(const __FlashStringHelper *label, long value) {
+    return log(label, true, value);
+  }
+
+  // Messages dropped, and repeats counted instead of printed, so far.
+  unsigned long droppedCount() const {
+    return dropped;
+  }
+  unsigned long coalescedCount() const {
+    return coalesced;
+  }
+
+private:
+  static const byte NUMBER_LENGTH = 12;  // "-2147483648" and the '\0'
+
+  bool log(const __FlashStringHelper *message, bool has_value, long value) {
+    bool repeat = message == last_message && has_value == last_has_value && value == last_value;
+
+    // Anything held back goes first, so messages are always in order.
+    reportRepeats();
+    reportDrops();
+
+    char number[NUMBER_LENGTH] = "";
+    if (has_value) {
+      ltoa(value, number, 10);
+    }
+    if (repeats == 0 && unreported_drops == 0
+        && fits(strlen_P(reinterpret_cast<PGM_P>(message)) + strlen(number) + 2)) {
+      port->print(message);
+      port->println(number);
+      last_message = message;
+      last_has_value = has_value;
+      last_value = value;
+      return true;
+    }
+
+    if (policy == COALESCE && repeat) {
+      repeats++;
+      coalesced++;
+    } else {
+      unreported_drops++;
+      dropped++;
+    }
+    return false;
+  }
+
+  // Print "Gear: 3 x37" for repeats held back, if there is room.
+  void reportRepeats() {
+    if (repeats == 0) {
+      return;
+    }
+    char number[NUMBER_LENGTH] = "";
+    if (last_has_value) {
+      ltoa(last_value, number, 10);
+    }
+    char count[NUMBER_LENGTH];
+    ultoa(repeats, count, 10);
+    if (!fits(strlen_P(reinterpret_cast<PGM_P>(last_message)) + strlen(number)
+              + 2 + strlen(count) + 2)) {
+      return;
+    }
+    port->print(last_message);
+    port->print(number);
+    port->print(F(" x"));
+    port->println(count);
+    repeats = 0;
+  }
+
+  // Print "(dropped 12)" for messages dropped, if there is room.
+  void reportDrops() {
+    if (unreported_drops == 0) {
+      return;
+    }
+    char count[NUMBER_LENGTH];
+    ultoa(unreported_drops, count, 10);
+    if (!fits(9 + strlen(count) + 3)) {
+      return;
+    }
+    port->print(F("(dropped "));
+    port->print(count);
+    port->println(')');
+    unreported_drops = 0;
+  }
+
+  // true if "length" characters fit in the Serial buffer right now.
+  bool fits(unsigned int length) const {
+    return (unsigned int)port->availableForWrite() >= length;
+  }
+
+  HardwareSerial *port;                     // where messages are printed
+  FULL_POLICY policy;                       // what to do when the buffer is full
+  const __FlashStringHelper *last_message;  // last message printed
+  bool last_has_value;                      // it had a number
+  long last_value;                          // the number
+  unsigned int repeats;                     // repeats of it held back
+  unsigned int unreported_drops;            // drops since "(dropped ...)" was printed
+  unsigned long dropped;                    // all messages dropped
+  unsigned long coalesced;                  // all repeats held back
+};
+
+// The one Serial log, used like Serial: serial_log.println(F("Done!!"))
+SerialLog serial_log;
+
+#endif  // SERIAL_LOG_H
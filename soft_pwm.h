@@ -0,0 +1,280 @@
+/*
+ * soft_pwm.h
+ *
+ * Software PWM so ANY digital pin can be dimmed, not just the six pins marked
+ * with a '~' on the HERO board.
+ *
+ * Instead of turning each pin on and off 255 times per cycle (which would keep
+ * the HERO busy all the time) we use "Bit Angle Modulation" (BAM).  A
+ * brightness from 0 to 255 is 8 bits.  Each cycle is split into time slices,
+ * one per bit: bit 2's slice is 4 units long, bit 3's is 8 units, up to bit
+ * 7's which is 128 units long.  During each slice a pin is ON if that bit of
+ * its brightness is set.
+ *
+ * Bits 0 and 1 share one 3 unit slice.  On its own bit 0's slice would be 1
+ * unit, only 8 microseconds at 490 Hz.  If the millis() or Serial interrupt
+ * held ours up for longer than that, the timer would miss the end of the
+ * slice and run on for 256 units, a visible flash.  Instead the shared slice
+ * is ON in as many of every 3 cycles as bits 0 and 1 say (0 to 3), which
+ * averages out to exactly 0 to 3 units a cycle.  For example, brightness 5
+ * (0b00000101) is on for bit 2's slice (4 units) every cycle and the shared
+ * slice one cycle in three, 5 units out of 255 on average.
+ *
+ * The shortest slice is then 3 units, 24 us (384 clock cycles) at 490 Hz:
+ * several times longer than the Arduino core's own interrupts, which take a
+ * few microseconds each.  (Code that turns interrupts off for longer than
+ * that can still cause a flash.)
+ *
+ * That means only 7 interrupts per cycle, and because the on/off pattern for
+ * every pin on a port is worked out ahead of time, each interrupt writes whole
+ * ports at once.  Driving 16 pins costs the same as driving 1.
+ *
+ * Estimated interrupt cost (about 80 clock cycles per interrupt, 7 interrupts
+ * per cycle, 16 MHz HERO board):
+ *   REFRESH_490_HZ:  about 2% of the HERO's time
+ *   REFRESH_245_HZ:  about 1% of the HERO's time
+ * Day 5b measures the real numbers when RUN_SOFT_PWM_BENCHMARK is defined.
+ *
+ * NOTE: Software PWM uses the HERO's Timer2.  While it runs tone() can't be
+ *       used (the sketch won't build if both are used) and analogWrite() no
+ *       longer works on pins 3 and 11.  Other code should change pins on
+ *       the same ports with digitalWrite(), which is safe to use alongside
+ *       the interrupt.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "soft_pwm.h"
+ */
+
+#ifndef SOFT_PWM_H
+#define SOFT_PWM_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+
+class SoftPwm {
+public:
+  static const byte MAX_CHANNELS = 16;  // most pins that can be attached at once
+
+  // Timer2 clock prescaler bits.  One "unit" of a BAM cycle is one timer count,
+  // and each cycle is 255 units long.
+  enum RefreshRate {
+    REFRESH_490_HZ = _BV(CS22) | _BV(CS20),  // clock / 128, 8 us per unit
+    REFRESH_245_HZ = _BV(CS22) | _BV(CS21),  // clock / 256, 16 us per unit
+  };
+
+  SoftPwm()
+    : channel_count(0), current_slice(0), dither_cycle(0), frame_changed(false) {
+    memset(pending_bits, 0, sizeof(pending_bits));
+    memset(pending_masks, 0, sizeof(pending_masks));
+    memset(active_bits, 0, sizeof(active_bits));
+    memset(active_masks, 0, sizeof(active_masks));
+  }
+
+  /*
+   * Add a pin to software PWM, set it as an OUTPUT and turn it off.  Returns
+   * false if MAX_CHANNELS pins are already attached.
+   */
+  bool attach(byte pin) {
+    if (findChannel(pin) >= 0) {
+      return true;  // already attached
+    }
+    if (channel_count >= MAX_CHANNELS) {
+      return false;
+    }
+    byte port = portIndex(pin);
+    if (port >= PORT_COUNT) {
+      return false;  // not a pin we know how to drive
+    }
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+
+    Channel &channel = channels[channel_count++];
+    channel.pin = pin;
+    channel.port = port;
+    channel.mask = digitalPinToBitMask(pin);
+    channel.brightness = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      pending_masks[port] |= channel.mask;
+      frame_changed = true;
+    }
+    return true;
+  }
+
+  /*
+   * Set the brightness (0-255) of an attached pin, just like analogWrite().
+   * The new value is used from the start of the next PWM cycle so the pin
+   * never shows a half updated pattern.
+   */
+  void write(byte pin, byte brightness) {
+    int index = findChannel(pin);
+    if (index < 0) {
+      return;
+    }
+    Channel &channel = channels[index];
+    channel.brightness = brightness;
+
+    // Work out this pin's bit in each of the patterns for its port: the
+    // shared slice is on in "brightness & 3" of every 3 cycles
+    byte *patterns = pending_bits[channel.port];
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      for (byte cycle = 0; cycle < DITHER_CYCLES; cycle++) {
+        setPatternBit(patterns[patternIndex(0, cycle)], channel.mask, cycle < (brightness & 3));
+      }
+      for (byte slice = 1; slice < SLICE_COUNT; slice++) {
+        setPatternBit(patterns[patternIndex(slice, 0)], channel.mask, brightness & (1 << (slice + 1)));
+      }
+      frame_changed = true;
+    }
+  }
+
+  // Brightness last set for an attached pin (0 if not attached).
+  byte read(byte pin) const {
+    int index = findChannel(pin);
+    return (index < 0) ? 0 : channels[index].brightness;
+  }
+
+  // Start the Timer2 interrupt that drives all attached pins.
+  void begin(RefreshRate rate = REFRESH_490_HZ) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      copyPendingFrame();
+      current_slice = 0;
+      dither_cycle = 0;
+      TIMSK2 = 0;               // no Timer2 interrupts while we set it up
+      ASSR = 0;                 // Timer2 runs from the main clock
+      TCCR2A = _BV(WGM21);      // CTC mode, restart count at OCR2A
+      TCCR2B = rate;            // prescaler sets the length of one unit
+      TCNT2 = 0;
+      OCR2A = SLICE_LENGTH[0];  // the shared slice for bits 0 and 1 comes first
+      writeSlice(patternIndex(0, 0));
+      TIFR2 = _BV(OCF2A);       // clear any old compare match
+      TIMSK2 = _BV(OCIE2A);     // interrupt at the end of each slice
+    }
+  }
+
+  // Stop the interrupt and turn all attached pins off.
+  void end() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      TIMSK2 = 0;
+      TCCR2B = 0;
+    }
+    for (byte i = 0; i < channel_count; i++) {
+      digitalWrite(channels[i].pin, LOW);
+    }
+  }
+
+  // Called only by the Timer2 interrupt below.  Starts the next time slice.
+  inline void serviceInterrupt() {
+    byte slice = current_slice + 1;
+    if (slice == SLICE_COUNT) {  // a new cycle
+      slice = 0;
+      dither_cycle = (dither_cycle + 1 == DITHER_CYCLES) ? 0 : dither_cycle + 1;
+    }
+    OCR2A = SLICE_LENGTH[slice];  // set length of the slice that just started
+    writeSlice(patternIndex(slice, dither_cycle));
+    current_slice = slice;
+
+    // The longest slice has just started, so there is plenty of time to pick
+    // up any brightness changes for the next cycle.
+    if (slice == SLICE_COUNT - 1 && frame_changed) {
+      copyPendingFrame();
+    }
+  }
+
+private:
+  static const byte PORT_COUNT = 3;  // 0 = PORTB (pins 8-13), 1 = PORTC (A0-A5), 2 = PORTD (pins 0-7)
+  static const byte SLICE_COUNT = 7;    // the shared slice for bits 0 and 1, then bits 2 to 7
+  static const byte DITHER_CYCLES = 3;  // cycles the shared slice's pattern repeats over
+  static const byte PATTERN_COUNT = DITHER_CYCLES + SLICE_COUNT - 1;  // per port
+
+  // OCR2A value for each slice: the shared slice lasts 3 timer counts, then
+  // bit N's slice lasts 2^N.
+  static const byte SLICE_LENGTH[SLICE_COUNT];
+
+  // Where the pattern for "slice" in dither cycle "cycle" is kept: the
+  // shared slice has one for each cycle, then each bit has one for all cycles.
+  static byte patternIndex(byte slice, byte cycle) {
+    return (slice == 0) ? cycle : DITHER_CYCLES - 1 + slice;
+  }
+
+  static void setPatternBit(byte &pattern, byte mask, bool on) {
+    if (on) {
+      pattern |= mask;
+    } else {
+      pattern &= ~mask;
+    }
+  }
+
+  struct Channel {
+    byte pin;         // Arduino pin number
+    byte port;        // port index (see PORT_COUNT)
+    byte mask;        // this pin's bit within its port
+    byte brightness;  // last value given to write()
+  };
+
+  static byte portIndex(byte pin) {
+    switch (digitalPinToPort(pin)) {
+      case PB:
+        return 0;
+      case PC:
+        return 1;
+      case PD:
+        return 2;
+    }
+    return PORT_COUNT;  // unknown
+  }
+
+  int findChannel(byte pin) const {
+    for (byte i = 0; i < channel_count; i++) {
+      if (channels[i].pin == pin) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  // Write on/off pattern number "pattern" to every port we use.  Pins that
+  // aren't attached keep their current value.
+  inline void writeSlice(byte pattern) {
+    byte mask = active_masks[0];
+    if (mask) {
+      PORTB = (PORTB & ~mask) | active_bits[0][pattern];
+    }
+    mask = active_masks[1];
+    if (mask) {
+      PORTC = (PORTC & ~mask) | active_bits[1][pattern];
+    }
+    mask = active_masks[2];
+    if (mask) {
+      PORTD = (PORTD & ~mask) | active_bits[2][pattern];
+    }
+  }
+
+  // Only called with interrupts off (from begin() or the interrupt itself).
+  void copyPendingFrame() {
+    memcpy(active_bits, pending_bits, sizeof(active_bits));
+    memcpy(active_masks, pending_masks, sizeof(active_masks));
+    frame_changed = false;
+  }
+
+  Channel channels[MAX_CHANNELS];
+  byte channel_count;
+
+  byte pending_bits[PORT_COUNT][PATTERN_COUNT];  // per port, per pattern: bits that should be ON (changed by write())
+  byte pending_masks[PORT_COUNT];               // per port: bits of attached pins
+  byte active_bits[PORT_COUNT][PATTERN_COUNT];  // copy of pending_bits used by the interrupt
+  byte active_masks[PORT_COUNT];                // copy of pending_masks used by the interrupt
+  volatile byte current_slice;                  // slice currently being shown
+  volatile byte dither_cycle;                   // which of the DITHER_CYCLES this cycle is
+  volatile bool frame_changed;                  // true when pending values need to be copied
+};
+
+const byte SoftPwm::SLICE_LENGTH[SoftPwm::SLICE_COUNT] = { 2, 3, 7, 15, 31, 63, 127 };
+
+// The one software PWM controller, used like Serial: soft_pwm.write(13, 128);
+SoftPwm soft_pwm;
+
+ISR(TIMER2_COMPA_vect) {
+  soft_pwm.serviceInterrupt();
+}
+
+#endif  // SOFT_PWM_H
@@ -0,0 +1,207 @@
+/*
+ * state_machine.h
+ *
+ * A state machine that is described by tables instead of if/else chains.
+ *
+ * Days 24, 28 and 29 each move through a list of states (INIT, PENDING,
+ * COUNTDOWN...).  Written with if/else or switch, the rules for leaving each
+ * state end up spread through loop(), and cases that fall through into each
+ * other are easy to get wrong.  Here the rules are written down in one place,
+ * a table with a row for each state and a column for each "event" (something
+ * that can happen, like "all levers are on"):
+ *
+ *   enum LAUNCH_EVENT { LEVERS_ALL_OFF, LEVERS_ALL_ON, LAUNCH_EVENT_COUNT };
+ *
+ *   const StateTransition LAUNCH_TRANSITIONS[][LAUNCH_EVENT_COUNT] PROGMEM = {
+ *     // LEVERS_ALL_OFF,   LEVERS_ALL_ON
+ *     { { PENDING, NULL }, NO_TRANSITION },        // INIT
+ *     { NO_TRANSITION,     { COUNTDOWN, NULL } },  // PENDING
+ *     ...
+ *   };
+ *
+ * Each entry is the state to move to, and an optional "guard" - a function
+ * that must return true for the move to happen.  NO_TRANSITION means the
+ * event is ignored in that state.  Looking up an entry takes the same short
+ * time however many states and events there are.
+ *
+ * A second table gives each state three optional functions ("actions"): one
+ * run when the state is entered, one run when it is left, and one run by
+ * update() for as long as the machine stays in that state.
+ *
+ *   StateMachine launch(&LAUNCH_TRANSITIONS[0][0], LAUNCH_ACTIONS, LAUNCH_EVENT_COUNT);
+ *
+ *   launch.begin(INIT);             // in setup()
+ *   launch.handle(LEVERS_ALL_ON);   // when something happens
+ *   launch.update();                // every time through loop()
+ *
+ * Both tables live in flash (PROGMEM) so they don't use any RAM.  The machine
+ * also records the time (micros()) of the last few transitions, which
+ * printHistory() sends over Serial to show how long each state lasted.
+ *
+ * Actions must not call handle() themselves - return, and let loop() send the
+ * next event.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "state_machine.h"
+ */
+
+#ifndef STATE_MACHINE_H
+#define STATE_MACHINE_H
+
+#include "Arduino.h"
+
+// A function that decides if a transition may happen (NULL = always).
+typedef bool (*StateGuard)();
+
+// A function run on entering, leaving or staying in a state (NULL = nothing).
+typedef void (*StateAction)();
+
+// Where an event leads from one state.
+struct StateTransition {
+  byte next_state;   // state to move to (NO_STATE = ignore the event)
+  StateGuard guard;  // must return true for the move to happen, or NULL
+};
+
+// What to do in one state.
+struct StateActions {
+  StateAction on_entry;  // run once when the state is entered
+  StateAction on_exit;   // run once when the state is left
+  StateAction during;    // run by every update() while in the state
+};
+
+const byte NO_STATE = 255;  // no state / ignore this event
+
+// Table entry for an event that a state ignores.
+#define NO_TRANSITION \
+  { NO_STATE, NULL }
+
+class StateMachine {
+public:
+  static const byte HISTORY_SIZE = 8;  // transitions remembered (must be a power of 2)
+
+  // One remembered transition.
+  struct Transition {
+    byte from;           // state left
+    byte to;             // state entered
+    byte event;          // event that caused it
+    unsigned long time;  // micros() when it happened
+  };
+
+  /*
+   * "transitions" is the first entry of the [state][event] table and
+   * "actions" has one entry per state, both in PROGMEM.  "actions" may be
+   * NULL if no state has any actions.
+   */
+  StateMachine(const StateTransition *transitions, const StateActions *actions, byte event_count)
+    : transition_table(transitions), action_table(actions), events(event_count),
+      current_state(NO_STATE), entered_time(0), history_head(0), history_count(0) {}
+
+  // Enter the first state (running its entry action).
+  void begin(byte initial_state) {
+    current_state = initial_state;
+    entered_time = millis();
+    run(actionsFor(current_state).on_entry);
+  }
+
+  /*
+   * Send an event to the machine.  If the table has a transition for it in
+   * the current state, and the guard (if any) allows it, the current state's
+   * exit action runs, then the new state's entry action.  Returns true if the
+   * state changed (or a state transitioned to itself).
+   */
+  bool handle(byte event) {
+    if (current_state == NO_STATE || event >= events) {
+      return false;
+    }
+    StateTransition transition;
+    memcpy_P(&transition, &transition_table[current_state * events + event], sizeof(transition));
+    if (transition.next_state == NO_STATE || (transition.guard != NULL && !transition.guard())) {
+      return false;
+    }
+
+    run(actionsFor(current_state).on_exit);
+    recordTransition(current_state, transition.next_state, event);
+    current_state = transition.next_state;
+    entered_time = millis();
+    run(actionsFor(current_state).on_entry);
+    return true;
+  }
+
+  // Run the current state's "during" action.  Call every time through loop().
+  void update() {
+    run(actionsFor(current_state).during);
+  }
+
+  byte state() const {
+    return current_state;
+  }
+
+  // Milliseconds since the current state was entered.
+  unsigned long timeInState() const {
+    return millis() - entered_time;
+  }
+
+  /*
+   * Print the remembered transitions, oldest first, one per line, with the
+   * microseconds spent in the "from" state (blank for the oldest):
+   *   from,to,event,micros,us_in_from
+   */
+  void printHistory(Print &out) const {
+    out.println(F("from,to,event,micros,us_in_from"));
+    for (byte age = history_count; age > 0; age--) {
+      const Transition &transition = history[(history_head - age) & (HISTORY_SIZE - 1)];
+      out.print(transition.from);
+      out.print(',');
+      out.print(transition.to);
+      out.print(',');
+      out.print(transition.event);
+      out.print(',');
+      out.print(transition.time);
+      out.print(',');
+      if (age < history_count) {  // the oldest one's previous transition was forgotten
+        out.print(transition.time - history[(history_head - age - 1) & (HISTORY_SIZE - 1)].time);
+      }
+      out.println();
+    }
+  }
+
+private:
+  // Copy a state's actions out of PROGMEM (all NULL if it has none).
+  StateActions actionsFor(byte state) const {
+    StateActions actions = { NULL, NULL, NULL };
+    if (action_table != NULL && state != NO_STATE) {
+      memcpy_P(&actions, &action_table[state], sizeof(actions));
+    }
+    return actions;
+  }
+
+  static void run(StateAction action) {
+    if (action != NULL) {
+      action();
+    }
+  }
+
+  void recordTransition(byte from, byte to, byte event) {
+    Transition &transition = history[history_head];
+    transition.from = from;
+    transition.to = to;
+    transition.event = event;
+    transition.time = micros();
+    history_head = (history_head + 1) & (HISTORY_SIZE - 1);
+    if (history_count < HISTORY_SIZE) {
+      history_count++;
+    }
+  }
+
+  const StateTransition *transition_table;  // [state][event], in PROGMEM
+  const StateActions *action_table;         // [state], in PROGMEM
+  byte events;                              // events per state (columns in the table)
+  byte current_state;
+  unsigned long entered_time;  // millis() when current_state was entered
+
+  Transition history[HISTORY_SIZE];  // recent transitions
+  byte history_head;                 // where the next transition goes
+  byte history_count;                // transitions remembered
+};
+
+#endif  // STATE_MACHINE_H
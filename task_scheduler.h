@@ -0,0 +1,224 @@
+/*
+ * task_scheduler.h
+ *
+ * Run several jobs at their own speeds without using delay().
+ *
+ * A loop() that does some work and then calls delay() can only do everything
+ * at one speed, and can't do anything at all while it waits.  Instead, we can
+ * give each job (a "task") to the scheduler with how often it should run:
+ *
+ *   TaskScheduler scheduler;
+ *
+ *   void setup() {
+ *     scheduler.every(20, readSensor, F("sensor"));    // every 20 ms
+ *     scheduler.every(500, printValues, F("print"));  // every 500 ms
+ *     scheduler.after(2000, sayHello);                 // once, in 2 seconds
+ *   }
+ *
+ *   void loop() {
+ *     scheduler.run();  // runs whichever tasks are due, then returns
+ *   }
+ *
+ * Each task is a function that does a little work and returns - it must never
+ * wait with delay() itself.  This is called "cooperative" multitasking, since
+ * every task has to cooperate by returning quickly.
+ *
+ * Tasks run in the order they were added (task 0 first), so two tasks that are
+ * due at the same time always run in the same order.  Each periodic task is
+ * timed from when it was meant to run, not when it actually ran, so a task
+ * every 100 ms runs 10 times a second even if it is sometimes a little late.
+ * If a task is so late that it missed a whole period it doesn't try to catch
+ * up - it counts an "overrun" and starts again from now.
+ *
+ * The scheduler also times every task with micros().  printStats() shows how
+ * many times each task ran, its average and longest run time, and its
+ * overruns, which makes it easy to find the task that is slowing things down.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "task_scheduler.h"
+ */
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include "Arduino.h"
+
+class TaskScheduler {
+public:
+  static const byte MAX_TASKS = 6;  // tasks that can be added (each uses 27 bytes of RAM)
+  static const byte NO_TASK = 255;  // returned by every() and after() if there is no room
+
+  // A task: a function with no arguments that does its work and returns.
+  typedef void (*TaskFunction)();
+
+  TaskScheduler()
+    : task_count(0) {}
+
+  /*
+   * Run "function" every "period_ms" milliseconds, starting the next time
+   * run() is called.  "name" (optional, use F("...")) is shown by printStats().
+   * Returns the task number, or NO_TASK if MAX_TASKS tasks are already added.
+   */
+  byte every(unsigned long period_ms, TaskFunction function, const __FlashStringHelper *name = NULL) {
+    return addTask(period_ms, 0, function, name);
+  }
+
+  // Run "function" once, "delay_ms" milliseconds from now.  The task number
+  // is free to be used again once it has run (or been cancelled).
+  byte after(unsigned long delay_ms, TaskFunction function, const __FlashStringHelper *name = NULL) {
+    return addTask(0, delay_ms, function, name);
+  }
+
+  // Stop a task.  Its statistics are kept until the task number is used again.
+  void cancel(byte task) {
+    if (task < task_count) {
+      tasks[task].active = false;
+    }
+  }
+
+  // true if "task" is still waiting to run (one-shot) or running (periodic).
+  bool isActive(byte task) const {
+    return task < task_count && tasks[task].active;
+  }
+
+  /*
+   * Change how often a periodic task runs.  It is next due "period_ms" after it
+   * last ran, or straight away if that time has already passed (that isn't an
+   * overrun).  Setting the same period again changes nothing.
+   */
+  void setPeriod(byte task, unsigned long period_ms) {
+    if (task >= task_count || tasks[task].period == 0 || period_ms == 0) {
+      return;
+    }
+    Task &this_task = tasks[task];
+    unsigned long now = millis();
+    this_task.due = this_task.due - this_task.period + period_ms;
+    if ((long)(now - this_task.due) > 0) {
+      this_task.due = now;
+    }
+    this_task.period = period_ms;
+  }
+
+  // Run the next time run() is called, then carry on at the usual period.
+  void runNow(byte task) {
+    if (task < task_count) {
+      tasks[task].due = millis();
+    }
+  }
+
+  /*
+   * Run every task that is due, in task number order, then return.  Call this
+   * every time through loop().  Returns the number of tasks that ran.
+   */
+  byte run() {
+    byte ran = 0;
+    for (byte task = 0; task < task_count; task++) {
+      Task &this_task = tasks[task];
+      unsigned long now = millis();
+      if (!this_task.active || (long)(now - this_task.due) < 0) {
+        continue;  // not due yet
+      }
+
+      if (this_task.period == 0) {
+        this_task.active = false;  // one-shot, this is its only run
+      } else if (now - this_task.due >= this_task.period) {
+        this_task.overruns++;  // missed a whole period, start again from now
+        this_task.due = now + this_task.period;
+      } else {
+        this_task.due += this_task.period;  // stay on schedule
+      }
+
+      unsigned long start_time = micros();
+      this_task.function();
+      unsigned long run_time = micros() - start_time;
+
+      this_task.runs++;
+      this_task.total_micros += run_time;
+      if (run_time > this_task.max_micros) {
+        this_task.max_micros = run_time;
+      }
+      ran++;
+    }
+    return ran;
+  }
+
+  /*
+   * Print one line per task, separated by commas so it can be pasted into a
+   * spreadsheet: number, name, runs, average and longest time (in
+   * microseconds) and overruns.
+   */
+  void printStats(Print &out) const {
+    out.println(F("task,name,runs,avg_us,max_us,overruns"));
+    for (byte task = 0; task < task_count; task++) {
+      const Task &this_task = tasks[task];
+      out.print(task);
+      out.print(',');
+      if (this_task.name != NULL) {
+        out.print(this_task.name);
+      }
+      out.print(',');
+      out.print(this_task.runs);
+      out.print(',');
+      out.print(this_task.runs ? this_task.total_micros / this_task.runs : 0);
+      out.print(',');
+      out.print(this_task.max_micros);
+      out.print(',');
+      out.println(this_task.overruns);
+    }
+  }
+
+  // Set every task's statistics back to 0.
+  void clearStats() {
+    for (byte task = 0; task < task_count; task++) {
+      tasks[task].runs = 0;
+      tasks[task].total_micros = 0;
+      tasks[task].max_micros = 0;
+      tasks[task].overruns = 0;
+    }
+  }
+
+private:
+  struct Task {
+    TaskFunction function;
+    const __FlashStringHelper *name;  // for printStats(), may be NULL
+    unsigned long period;             // ms between runs, 0 for a one-shot task
+    unsigned long due;                // millis() when it should next run
+    bool active;                      // false once cancelled or a one-shot has run
+    unsigned long runs;               // times it has run
+    unsigned long total_micros;       // time spent running it
+    unsigned long max_micros;         // longest single run
+    unsigned int overruns;            // times it missed a whole period
+  };
+
+  // Use the first free task number so the order stays the same as the order
+  // tasks were added, unless one has finished and been replaced.
+  byte addTask(unsigned long period_ms, unsigned long delay_ms, TaskFunction function,
+               const __FlashStringHelper *name) {
+    byte task = 0;
+    while (task < task_count && tasks[task].active) {
+      task++;
+    }
+    if (task == MAX_TASKS) {
+      return NO_TASK;
+    }
+    if (task == task_count) {
+      task_count++;
+    }
+    Task &new_task = tasks[task];
+    new_task.function = function;
+    new_task.name = name;
+    new_task.period = period_ms;
+    new_task.due = millis() + delay_ms;
+    new_task.active = true;
+    new_task.runs = 0;
+    new_task.total_micros = 0;
+    new_task.max_micros = 0;
+    new_task.overruns = 0;
+    return task;
+  }
+
+  Task tasks[MAX_TASKS];
+  byte task_count;  // task numbers in use (some may be inactive)
+};
+
+#endif  // TASK_SCHEDULER_H
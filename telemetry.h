@@ -0,0 +1,234 @@
+/*
+ * telemetry.h
+ *
+ * Send numbers to the computer in a few bytes each, without ever making
+ * loop() wait for the Serial port.
+ *
+ * At 9600 baud each character takes about 1 ms to send.  A line like
+ * "Light value: 523, Delay value: 245" is 36 characters, and once the 64
+ * character Serial buffer is full, Serial.print() waits until there's room -
+ * so printing slows down everything else.  telemetry instead sends each value
+ * as a small binary "frame" on a numbered "channel":
+ *
+ *   byte light_channel = telemetry.addChannel(F("light"));  // in setup()
+ *   ...
+ *   telemetry.send(light_channel, light_value);  // 7 bytes for an unsigned int
+ *
+ * send() works out the value's type from the variable (byte, int, unsigned
+ * int, long, unsigned long or float) and sends that along with it.  If there
+ * isn't room in the Serial buffer for the whole frame it doesn't wait - the
+ * frame is dropped and counted instead, and the count is sent now and then
+ * (as channel 15, "dropped").
+ *
+ * The Serial Monitor can't show binary, so use telemetry_decode.py (next to
+ * this file) on the computer to turn the frames into CSV or a live plot.
+ * Ordinary Serial.print() text still works between frames - the decoder
+ * shows it as it is.
+ *
+ * Each frame is:
+ *   0, then COBS encoded: [type << 4 | channel] [value, low byte first] [CRC-8], then 0
+ *
+ * COBS ("consistent overhead byte stuffing") replaces every 0 in the frame
+ * with a count of the bytes to the next 0, for one extra byte, so 0 only ever
+ * appears at the start and end of a frame.  The decoder can always find where
+ * frames begin, even if it starts listening part way through.  The CRC-8 (a
+ * check byte worked out from the rest) lets it throw away any frame that was
+ * damaged.  Channel names are sent when they are added, and again now and
+ * then for a decoder that started late.
+ *
+ * Include this file at the top of a sketch with:
+ *   #include "telemetry.h"
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "Arduino.h"
+
+class Telemetry {
+public:
+  static const byte MAX_CHANNELS = 8;        // channels addChannel() can add
+  static const byte DROPPED_CHANNEL = 15;    // dropped frame count
+  static const byte MAX_NAME_LENGTH = 12;    // longer channel names are cut short
+  static const byte ANNOUNCE_INTERVAL = 50;  // values sent between name and dropped count frames
+  static const byte NO_CHANNEL = 255;        // returned by addChannel() if there is no room
+
+  // The type of a frame's value, sent in the top 4 bits of its first byte.
+  enum TYPE {
+    TYPE_NAME,   // channel name (the characters)
+    TYPE_BYTE,   // 1 byte, 0 to 255
+    TYPE_UINT,   // 2 bytes, 0 to 65535
+    TYPE_INT,    // 2 bytes, -32768 to 32767
+    TYPE_ULONG,  // 4 bytes, 0 to 4294967295
+    TYPE_LONG,   // 4 bytes, -2147483648 to 2147483647
+    TYPE_FLOAT   // 4 bytes, IEEE 754
+  };
+
+  Telemetry()
+    : port(&Serial), channel_count(0), next_announce(0), values_since_announce(0),
+      dropped(0) {}
+
+  // Send frames on "serial" instead of Serial (it must already be started).
+  void begin(HardwareSerial &serial) {
+    port = &serial;
+  }
+
+  /*
+   * Add a channel called "name" and send its name.  Returns its channel number
+   * for send(), like scheduler.every() returns a task number.
+   */
+  byte addChannel(const __FlashStringHelper *name) {
+    if (channel_count == MAX_CHANNELS) {
+      return NO_CHANNEL;
+    }
+    names[channel_count] = name;
+    sendName(channel_count);
+    return channel_count++;
+  }
+
+  // Send one value on "channel".  Returns false if it was dropped, or if
+  // "channel" isn't one addChannel() added (such as NO_CHANNEL).
+  bool send(byte channel, byte value) {
+    return sendValue(channel, TYPE_BYTE, &value, sizeof(value));
+  }
+  bool send(byte channel, unsigned int value) {
+    return sendValue(channel, TYPE_UINT, &value, sizeof(value));
+  }
+  bool send(byte channel, int value) {
+    return sendValue(channel, TYPE_INT, &value, sizeof(value));
+  }
+  bool send(byte channel, unsigned long value) {
+    return sendValue(channel, TYPE_ULONG, &value, sizeof(value));
+  }
+  bool send(byte channel, long value) {
+    return sendValue(channel, TYPE_LONG, &value, sizeof(value));
+  }
+  bool send(byte channel, float value) {
+    return sendValue(channel, TYPE_FLOAT, &value, sizeof(value));
+  }
+
+  // Frames dropped because the Serial buffer was full.
+  unsigned long droppedCount() const {
+    return dropped;
+  }
+
+private:
+  static const byte MAX_FRAME = 1 + MAX_NAME_LENGTH + 1;  // before COBS: type/channel, data, CRC
+  static const byte MAX_SENT = MAX_FRAME + 3;             // after: a COBS code byte and two 0s
+
+  /*
+   * Send a value (the HERO stores numbers low byte first, just as frames
+   * send them), then now and then the next channel name or the dropped count.
+   */
+  bool sendValue(byte channel, byte type, const void *value, byte size) {
+    if (channel >= channel_count) {  // would go out as another channel, or as "dropped"
+      return false;
+    }
+    byte frame[MAX_FRAME];
+    frame[0] = (type << 4) | (channel & 0x0F);
+    memcpy(frame + 1, value, size);
+    bool sent = sendFrame(frame, 1 + size);
+
+    if (++values_since_announce >= ANNOUNCE_INTERVAL) {
+      values_since_announce = 0;
+      announceNext();
+    }
+    return sent;
+  }
+
+  // Send channel names one at a time, then the dropped count, then start again.
+  void announceNext() {
+    if (next_announce < channel_count) {
+      sendName(next_announce++);
+      return;
+    }
+    next_announce = 0;
+    byte frame[MAX_FRAME];
+    frame[0] = (TYPE_ULONG << 4) | DROPPED_CHANNEL;
+    memcpy(frame + 1, &dropped, sizeof(dropped));
+    sendFrame(frame, 1 + sizeof(dropped));
+  }
+
+  void sendName(byte channel) {
+    byte frame[MAX_FRAME];
+    frame[0] = (TYPE_NAME << 4) | channel;
+    PGM_P name = reinterpret_cast<PGM_P>(names[channel]);
+    byte length = 0;
+    char c;
+    while (length < MAX_NAME_LENGTH && (c = pgm_read_byte(name + length)) != '\0') {
+      frame[1 + length++] = c;
+    }
+    sendFrame(frame, 1 + length);
+  }
+
+  /*
+   * Add the CRC to "length" bytes of frame (there must be room for it), COBS
+   * encode them and send them between two 0s - all at once, or not at all if
+   * there isn't room in the Serial buffer.
+   */
+  bool sendFrame(byte *frame, byte length) {
+    frame[length] = crc8(frame, length);
+    length++;
+
+    byte encoded[MAX_SENT];
+    byte encoded_length = 0;
+    encoded[encoded_length++] = 0;
+    encoded_length += cobsEncode(frame, length, encoded + encoded_length);
+    encoded[encoded_length++] = 0;
+
+    if (port->availableForWrite() < encoded_length) {
+      dropped++;
+      return false;
+    }
+    port->write(encoded, encoded_length);
+    return true;
+  }
+
+  /*
+   * COBS: copy "length" bytes to "out", replacing each 0 (and adding one at the
+   * start) with the number of bytes to the next 0, or to the end.  Frames are
+   * much shorter than the 254 byte limit where COBS needs an extra code byte.
+   * Returns the length sent, one longer than "length".
+   */
+  static byte cobsEncode(const byte *in, byte length, byte *out) {
+    byte code_index = 0;  // where the count for the current run goes
+    byte out_index = 1;
+    byte code = 1;
+    for (byte i = 0; i < length; i++) {
+      if (in[i] == 0) {
+        out[code_index] = code;
+        code_index = out_index++;
+        code = 1;
+      } else {
+        out[out_index++] = in[i];
+        code++;
+      }
+    }
+    out[code_index] = code;
+    return out_index;
+  }
+
+  // CRC-8 with polynomial x^8 + x^2 + x + 1 (0x07), starting from 0.
+  static byte crc8(const byte *data, byte length) {
+    byte crc = 0;
+    for (byte i = 0; i < length; i++) {
+      crc ^= data[i];
+      for (byte bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+      }
+    }
+    return crc;
+  }
+
+  HardwareSerial *port;                            // where frames are sent
+  const __FlashStringHelper *names[MAX_CHANNELS];  // channel names, in flash
+  byte channel_count;                              // channels added so far
+  byte next_announce;                              // channel whose name is sent next
+  byte values_since_announce;                      // values sent since the last name
+  unsigned long dropped;                           // frames dropped (buffer full)
+};
+
+// The one telemetry sender, used like Serial: telemetry.send(channel, value)
+Telemetry telemetry;
+
+#endif  // TELEMETRY_H
@@ -0,0 +1,216 @@
+"""
+telemetry_decode.py
+
+Turn the binary frames sent by telemetry.h back into numbers, on the computer.
+
+    python3 telemetry_decode.py COM3                  # CSV on the screen
+    python3 telemetry_decode.py /dev/ttyUSB0 > run.csv
+    python3 telemetry_decode.py /dev/ttyUSB0 --plot   # live plot
+    python3 telemetry_decode.py saved.bin             # frames saved to a file
+
+Reading a Serial port needs pyserial (pip install pyserial), and --plot needs
+matplotlib (pip install matplotlib).  Close the Arduino IDE's Serial Monitor
+first - only one program can use the port at a time.
+
+The CSV has one line per value: the time in seconds since we started
+listening, the channel name and the value:
+
+    time_s,channel,value
+    0.512,light,523
+    0.512,delay,245
+
+Any ordinary text the sketch prints between frames is shown on stderr, after
+"# ", so it doesn't get mixed into the CSV.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+DROPPED_CHANNEL = 15
+
+# Frame types, from telemetry.h: (struct format, size)
+TYPE_NAME = 0
+VALUE_TYPES = {
+    1: ("<B", 1),  # byte
+    2: ("<H", 2),  # unsigned int
+    3: ("<h", 2),  # int
+    4: ("<I", 4),  # unsigned long
+    5: ("<i", 4),  # long
+    6: ("<f", 4),  # float
+}
+
+
+def crc8(data):
+    """CRC-8, polynomial 0x07, starting from 0 (the same as telemetry.h)."""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def cobs_decode(data):
+    """Undo COBS encoding, or return None if "data" isn't valid COBS."""
+    out = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        if code == 0 or index + code > len(data):
+            return None
+        out += data[index + 1:index + code]
+        index += code
+        if code < 0xFF and index < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Decoder:
+    """Collects bytes, and returns ("value", channel, value), ("name", channel, name) or ("text", line)."""
+
+    def __init__(self):
+        self.names = {DROPPED_CHANNEL: "dropped"}
+        self.chunk = bytearray()
+        self.bad_frames = 0
+
+    def channel_name(self, channel):
+        return self.names.get(channel, "channel_%d" % channel)
+
+    def feed(self, data):
+        results = []
+        for byte in data:
+            if byte != 0:
+                self.chunk.append(byte)
+                continue
+            if self.chunk:
+                results.extend(self.finish_chunk(bytes(self.chunk)))
+            self.chunk = bytearray()
+        return results
+
+    def finish_chunk(self, chunk):
+        frame = cobs_decode(chunk)
+        if frame is not None and len(frame) >= 2 and crc8(frame[:-1]) == frame[-1]:
+            result = self.decode_frame(frame[:-1])
+            if result is not None:
+                return [result]
+        # Not a frame: ordinary text, or a damaged frame
+        text = chunk.decode("ascii", errors="replace")
+        if text.strip() and all(c.isprintable() or c in "\r\n\t" for c in text):
+            return [("text", line) for line in text.splitlines() if line.strip()]
+        self.bad_frames += 1
+        return []
+
+    def decode_frame(self, frame):
+        frame_type = frame[0] >> 4
+        channel = frame[0] & 0x0F
+        data = frame[1:]
+        if frame_type == TYPE_NAME:
+            self.names[channel] = data.decode("ascii", errors="replace")
+            return ("name", channel, self.names[channel])
+        if frame_type not in VALUE_TYPES:
+            return None
+        value_format, size = VALUE_TYPES[frame_type]
+        if len(data) != size:
+            return None
+        return ("value", channel, struct.unpack(value_format, data)[0])
+
+
+def open_input(source, baud):
+    """A file (or - for stdin) if it exists, otherwise a Serial port."""
+    if source == "-":
+        return sys.stdin.buffer
+    if os.path.isfile(source):
+        return open(source, "rb")
+    try:
+        import serial
+    except ImportError:
+        sys.exit("Reading a Serial port needs pyserial: pip install pyserial")
+    return serial.Serial(source, baud, timeout=0.1)
+
+
+def read_results(stream, decoder):
+    """Yield (time, result) for everything decoded from "stream"."""
+    start = time.monotonic()
+    while True:
+        data = stream.read(64)
+        if not data:
+            if not hasattr(stream, "in_waiting"):
+                return  # end of a file (a Serial port just timed out)
+            continue
+        now = time.monotonic() - start
+        for result in decoder.feed(data):
+            yield now, result
+
+
+def write_csv(stream, decoder):
+    print("time_s,channel,value", flush=True)
+    for now, result in read_results(stream, decoder):
+        if result[0] == "value":
+            print("%.3f,%s,%s" % (now, decoder.channel_name(result[1]), result[2]), flush=True)
+        elif result[0] == "text":
+            print("# " + result[1], file=sys.stderr, flush=True)
+
+
+def plot(stream, decoder, seconds):
+    try:
+        import matplotlib.pyplot as plt
+    except ImportError:
+        sys.exit("--plot needs matplotlib: pip install matplotlib")
+
+    samples = {}  # channel: ([times], [values])
+    lines = {}
+    plt.ion()
+    figure, axes = plt.subplots()
+    axes.set_xlabel("seconds")
+    last_draw = 0
+    for now, result in read_results(stream, decoder):
+        if result[0] == "text":
+            print("# " + result[1], file=sys.stderr, flush=True)
+        if result[0] != "value" or result[1] == DROPPED_CHANNEL:
+            continue
+        times, values = samples.setdefault(result[1], ([], []))
+        times.append(now)
+        values.append(result[2])
+        while times[0] < now - seconds:
+            times.pop(0)
+            values.pop(0)
+        if now - last_draw < 0.1:
+            continue  # redraw at most 10 times a second
+        last_draw = now
+        for channel, (times, values) in samples.items():
+            if channel not in lines:
+                lines[channel], = axes.plot([], [])
+            lines[channel].set_data(times, values)
+            lines[channel].set_label(decoder.channel_name(channel))
+        axes.legend(loc="upper left")
+        axes.relim()
+        axes.autoscale_view()
+        plt.pause(0.001)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode telemetry.h frames into CSV or a live plot.")
+    parser.add_argument("source", help="Serial port (like COM3 or /dev/ttyUSB0), a saved file, or - for stdin")
+    parser.add_argument("--baud", type=int, default=9600, help="Serial port speed (default 9600)")
+    parser.add_argument("--plot", action="store_true", help="show a live plot instead of CSV")
+    parser.add_argument("--seconds", type=float, default=30, help="seconds shown on the plot (default 30)")
+    args = parser.parse_args()
+
+    decoder = Decoder()
+    stream = open_input(args.source, args.baud)
+    try:
+        if args.plot:
+            plot(stream, decoder, args.seconds)
+        else:
+            write_csv(stream, decoder)
+    except KeyboardInterrupt:
+        pass
+    if decoder.bad_frames:
+        print("# %d damaged frames skipped" % decoder.bad_frames, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
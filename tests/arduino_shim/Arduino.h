@@ -0,0 +1,213 @@
+/*
+ * Arduino.h (test shim)
+ *
+ * Just enough of the Arduino core for our helper headers to compile on the
+ * computer, so tests/ can check them without a HERO board.  Only what the
+ * tested headers use is here - add to it when a new test needs more.
+ *
+ * The port and timer registers are plain variables, so a test can "turn the
+ * dial" by setting PIND or read back what a header wrote to PORTB or OCR2A.
+ * The interrupt flag registers (TIFR1, TIFR2) clear a flag written with a 1,
+ * as the real ones do.
+ * Time only moves when a test sets arduino_shim::now_millis or
+ * arduino_shim::now_micros.  Interrupts never run by themselves: ISR() just
+ * defines a function, and a test calls the header's service function itself.
+ * What a header prints to an arduino_shim::PrintedText is kept in its text.
+ *
+ * On the computer an int is 32 bits, not 16 as on the HERO, and a long 64
+ * bits, not 32.  A test must keep its numbers in the HERO's range to be
+ * checking the same thing (and wrap "millis()" at (unsigned long)-1).
+ */
+
+#ifndef ARDUINO_SHIM_ARDUINO_H
+#define ARDUINO_SHIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define F_CPU 16000000UL  // the HERO's clock, in cycles per second
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+// Flash memory is ordinary memory here
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define memcpy_P memcpy
+
+// F("text") marks a string kept in flash; here it is just the string
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// Serial and the displays print through this.  Numbers print in decimal.
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+
+  size_t print(const char *text) {
+    size_t written = 0;
+    while (*text) {
+      written += write(*text++);
+    }
+    return written;
+  }
+  size_t print(const __FlashStringHelper *text) {
+    return print(reinterpret_cast<const char *>(text));
+  }
+  size_t print(char c) {
+    return write(c);
+  }
+  size_t print(unsigned char n) {
+    return print((unsigned long)n);
+  }
+  size_t print(int n) {
+    return print((long)n);
+  }
+  size_t print(unsigned int n) {
+    return print((unsigned long)n);
+  }
+  size_t print(long n) {
+    char digits[24];
+    snprintf(digits, sizeof(digits), "%ld", n);
+    return print(digits);
+  }
+  size_t print(unsigned long n) {
+    char digits[24];
+    snprintf(digits, sizeof(digits), "%lu", n);
+    return print(digits);
+  }
+
+  size_t println() {
+    return print("\r\n");
+  }
+  template <typename T>
+  size_t println(T value) {
+    size_t written = print(value);
+    return written + println();
+  }
+};
+
+namespace arduino_shim {
+// A Print that keeps what was printed, for a test to check
+class PrintedText : public Print {
+public:
+  std::string text;
+
+  size_t write(uint8_t c) {
+    text += (char)c;
+    return 1;
+  }
+};
+}  // namespace arduino_shim
+
+#define _BV(bit) (1 << (bit))
+
+// Port registers (each test is one file, so each gets its own)
+static volatile uint8_t PINB, PINC, PIND;
+static volatile uint8_t PORTB, PORTC, PORTD;
+static volatile uint8_t DDRB, DDRC, DDRD;
+
+namespace arduino_shim {
+// An interrupt flag register (TIFRn).  As on the HERO, writing a 1 to a flag
+// clears it; a test simulating the timer sets flags with raise().
+class InterruptFlags {
+public:
+  InterruptFlags()
+    : flags(0) {}
+
+  InterruptFlags &operator=(uint8_t written) {
+    flags &= ~written;
+    return *this;
+  }
+
+  operator uint8_t() const {
+    return flags;
+  }
+
+  void raise(uint8_t bits) {
+    flags |= bits;
+  }
+
+private:
+  volatile uint8_t flags;
+};
+}  // namespace arduino_shim
+
+// Timer1 registers and the bits of them our headers use
+static volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+static volatile uint16_t TCNT1, OCR1B;
+static arduino_shim::InterruptFlags TIFR1;
+#define CS10 0
+#define TOIE1 0
+#define OCIE1B 2
+#define TOV1 0
+#define OCF1B 2
+
+// Timer2 registers and the bits of them our headers use
+static volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, TIMSK2, ASSR;
+static arduino_shim::InterruptFlags TIFR2;
+#define WGM21 1
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define OCIE2A 1
+#define OCF2A 1
+
+#define ISR(vector) void vector()
+
+// Ports as digitalPinToPort() numbers them, and the HERO's pins on each:
+// 0-7 on PORTD, 8-13 on PORTB, 14-19 (A0-A5) on PORTC
+#define PB 2
+#define PC 3
+#define PD 4
+
+inline uint8_t digitalPinToPort(uint8_t pin) {
+  return (pin < 8) ? PD : (pin < 14) ? PB : PC;
+}
+
+inline uint8_t digitalPinToBitMask(uint8_t pin) {
+  return _BV((pin < 8) ? pin : (pin < 14) ? pin - 8 : pin - 14);
+}
+
+namespace arduino_shim {
+inline volatile uint8_t &portRegister(volatile uint8_t &b, volatile uint8_t &c,
+                                      volatile uint8_t &d, uint8_t pin) {
+  uint8_t port = digitalPinToPort(pin);
+  return (port == PB) ? b : (port == PC) ? c : d;
+}
+}  // namespace arduino_shim
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+  volatile uint8_t &ddr = arduino_shim::portRegister(DDRB, DDRC, DDRD, pin);
+  ddr = (mode == OUTPUT) ? (ddr | digitalPinToBitMask(pin)) : (ddr & ~digitalPinToBitMask(pin));
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t value) {
+  volatile uint8_t &port = arduino_shim::portRegister(PORTB, PORTC, PORTD, pin);
+  port = value ? (port | digitalPinToBitMask(pin)) : (port & ~digitalPinToBitMask(pin));
+}
+
+// The clock, set by the test
+namespace arduino_shim {
+static unsigned long now_millis = 0;
+static unsigned long now_micros = 0;
+}  // namespace arduino_shim
+
+inline unsigned long millis() {
+  return arduino_shim::now_millis;
+}
+
+inline unsigned long micros() {
+  return arduino_shim::now_micros;
+}
+
+#endif  // ARDUINO_SHIM_ARDUINO_H
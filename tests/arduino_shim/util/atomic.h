@@ -0,0 +1,16 @@
+/*
+ * util/atomic.h (test shim)
+ *
+ * ATOMIC_BLOCK() runs its block once.  There are no real interrupts on the
+ * computer to hold off; a test that simulates them decides itself when they
+ * may happen.
+ */
+
+#ifndef ARDUINO_SHIM_UTIL_ATOMIC_H
+#define ARDUINO_SHIM_UTIL_ATOMIC_H
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON 1
+#define ATOMIC_BLOCK(type) for (int atomic_once = 1; atomic_once; atomic_once = 0)
+
+#endif  // ARDUINO_SHIM_UTIL_ATOMIC_H
@@ -0,0 +1,67 @@
+/*
+ * check.h
+ *
+ * The few checks our host tests need.  A failed check prints where it was and
+ * what it found, and the test carries on so one run shows every failure:
+ *
+ *   CHECK(debouncer.state() == 0);
+ *   CHECK_EQUAL(battery.level(), 120UL);
+ *   CHECK_NEAR(gain, 0.707, 0.01);
+ *
+ *   int main() {
+ *     ...
+ *     return checkResults("test_battery_model");  // 0 if every check passed
+ *   }
+ */
+
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <math.h>
+#include <stdio.h>
+
+namespace check_detail {
+static unsigned long checks = 0;
+static unsigned long failures = 0;
+
+inline bool record(bool passed, const char *file, int line, const char *what) {
+  checks++;
+  if (!passed) {
+    failures++;
+    printf("%s:%d: failed: %s\n", file, line, what);
+  }
+  return passed;
+}
+}  // namespace check_detail
+
+#define CHECK(condition) check_detail::record((condition), __FILE__, __LINE__, #condition)
+
+#define CHECK_EQUAL(actual, expected)                                                           \
+  do {                                                                                          \
+    long long check_actual = (long long)(actual);                                               \
+    long long check_expected = (long long)(expected);                                           \
+    if (!check_detail::record(check_actual == check_expected, __FILE__, __LINE__,               \
+                              #actual " == " #expected)) {                                      \
+      printf("    got %lld, expected %lld\n", check_actual, check_expected);                    \
+    }                                                                                           \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                                 \
+  do {                                                                                          \
+    double check_actual = (actual);                                                             \
+    double check_expected = (expected);                                                         \
+    if (!check_detail::record(fabs(check_actual - check_expected) <= (tolerance), __FILE__,     \
+                              __LINE__, #actual " ~= " #expected)) {                            \
+      printf("    got %g, expected %g +/- %g\n", check_actual, check_expected,                  \
+             (double)(tolerance));                                                              \
+    }                                                                                           \
+  } while (0)
+
+// Print a summary line.  Returns the exit code for main(): 0 if all passed.
+inline int checkResults(const char *test_name) {
+  printf("%s: %lu checks, %lu failed\n", test_name, check_detail::checks,
+         check_detail::failures);
+  return check_detail::failures == 0 ? 0 : 1;
+}
+
+#endif  // TESTS_CHECK_H
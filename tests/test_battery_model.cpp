@@ -0,0 +1,146 @@
+/*
+ * test_battery_model.cpp
+ *
+ * Checks BatteryModel::update() from battery_model.h: whole steps of charge
+ * for the time that passed, time left over kept for next time, catching up
+ * at most MAX_CATCH_UP_STEPS, millis() wrapping around to 0, and steps that
+ * add no charge.
+ */
+
+#include "Arduino.h"
+#include "battery_model.h"
+#include "check.h"
+
+namespace {
+
+const unsigned int STEP_MS = 100;
+const unsigned int CHARGE = 7;  // charge per step
+const unsigned long CAPACITY = 1000000;
+
+// millis() counts up to the largest unsigned long, then starts again at 0
+// (after about 49.7 days on the HERO).
+const unsigned long LAST_MILLIS = (unsigned long)-1;
+
+void testStartsClock() {
+  BatteryModel battery(CAPACITY, STEP_MS);
+  CHECK_EQUAL(battery.update(5000, CHARGE), 0U);  // only starts the clock
+  CHECK_EQUAL(battery.level(), 0);
+  CHECK_EQUAL(battery.capacity(), CAPACITY);
+  CHECK(!battery.isFull());
+}
+
+void testNormalSteps() {
+  BatteryModel battery(CAPACITY, STEP_MS);
+  battery.update(1000, CHARGE);
+  CHECK_EQUAL(battery.update(1099, CHARGE), 0U);  // not a whole step yet
+  CHECK_EQUAL(battery.update(1100, CHARGE), 1U);
+  CHECK_EQUAL(battery.update(1350, CHARGE), 2U);  // 50 ms left over...
+  CHECK_EQUAL(battery.update(1399, CHARGE), 0U);
+  CHECK_EQUAL(battery.update(1400, CHARGE), 1U);  // ...used here
+  CHECK_EQUAL(battery.level(), 4 * CHARGE);
+
+  // The same time charges the same however often update() is called
+  BatteryModel often(CAPACITY, STEP_MS);
+  BatteryModel seldom(CAPACITY, STEP_MS);
+  unsigned long often_steps = 0;
+  unsigned long seldom_steps = 0;
+  for (unsigned long now = 0; now <= 60000; now++) {
+    often_steps += often.update(now, CHARGE);
+    if (now % 373 == 0 || now == 60000) {
+      seldom_steps += seldom.update(now, CHARGE);
+    }
+  }
+  CHECK_EQUAL(often_steps, 600);
+  CHECK_EQUAL(seldom_steps, 600);
+  CHECK_EQUAL(often.level(), seldom.level());
+}
+
+void testCatchUpLimit() {
+  const unsigned int MAX_STEPS = BatteryModel::MAX_CATCH_UP_STEPS;
+
+  // Exactly the limit all gets added
+  BatteryModel at_limit(CAPACITY, STEP_MS);
+  at_limit.update(0, CHARGE);
+  CHECK_EQUAL(at_limit.update((unsigned long)MAX_STEPS * STEP_MS + 99, CHARGE), MAX_STEPS);
+  CHECK_EQUAL(at_limit.level(), (unsigned long)MAX_STEPS * CHARGE);
+  CHECK_EQUAL(at_limit.update((unsigned long)MAX_STEPS * STEP_MS + 100, CHARGE), 1U);
+
+  // A long stall: the steps past the limit are dropped, but the part of a
+  // step left over is still kept
+  BatteryModel stalled(CAPACITY, STEP_MS);
+  stalled.update(0, CHARGE);
+  CHECK_EQUAL(stalled.update(1000UL * STEP_MS + 30, CHARGE), MAX_STEPS);
+  CHECK_EQUAL(stalled.level(), (unsigned long)MAX_STEPS * CHARGE);
+  CHECK_EQUAL(stalled.update(1000UL * STEP_MS + 99, CHARGE), 0U);
+  CHECK_EQUAL(stalled.update(1000UL * STEP_MS + 100, CHARGE), 1U);
+  CHECK_EQUAL(stalled.update(1000UL * STEP_MS + 250, CHARGE), 1U);
+  CHECK_EQUAL(stalled.level(), (unsigned long)(MAX_STEPS + 2) * CHARGE);
+}
+
+void testMillisWrap() {
+  // Steps carry on across the wrap as if it weren't there
+  BatteryModel battery(CAPACITY, STEP_MS);
+  unsigned long start = LAST_MILLIS - 149;  // 150 ms before millis() reaches 0
+  battery.update(start, CHARGE);
+  CHECK_EQUAL(battery.update(start + 100, CHARGE), 1U);
+  CHECK_EQUAL(battery.update(49, CHARGE), 0U);  // start + 199, wrapped
+  CHECK_EQUAL(battery.update(50, CHARGE), 1U);
+  CHECK_EQUAL(battery.update(150, CHARGE), 1U);
+  CHECK_EQUAL(battery.level(), 3 * CHARGE);
+
+  // So does the catch-up limit
+  BatteryModel stalled(CAPACITY, STEP_MS);
+  stalled.update(start, CHARGE);
+  unsigned long after_stall = start + 1000UL * STEP_MS + 30;  // wraps
+  CHECK(after_stall < start);
+  CHECK_EQUAL(stalled.update(after_stall, CHARGE), BatteryModel::MAX_CATCH_UP_STEPS);
+  CHECK_EQUAL(stalled.update(after_stall + 70, CHARGE), 1U);
+}
+
+void testNoCharge() {
+  // A step with no light still passes: the clock moves on, the level doesn't
+  BatteryModel battery(CAPACITY, STEP_MS);
+  battery.update(0, CHARGE);
+  CHECK_EQUAL(battery.update(250, 0), 2U);
+  CHECK_EQUAL(battery.level(), 0);
+  CHECK_EQUAL(battery.update(300, CHARGE), 1U);  // the 50 ms left over is kept
+  CHECK_EQUAL(battery.level(), CHARGE);
+
+  // The charge is unsigned, so a "negative" one is really a huge one: it can
+  // only fill the battery, never take it past capacity or back round to empty
+  BatteryModel small(500, STEP_MS);
+  small.update(0, CHARGE);
+  small.update(100, CHARGE);
+  CHECK_EQUAL(small.update(60100, (unsigned int)-1), BatteryModel::MAX_CATCH_UP_STEPS);
+  CHECK_EQUAL(small.level(), 500);
+  CHECK(small.isFull());
+  small.update(60200, CHARGE);
+  CHECK_EQUAL(small.level(), 500);
+}
+
+void testFullAndReset() {
+  BatteryModel battery(50, STEP_MS);
+  battery.update(0, CHARGE);
+  battery.update(700, CHARGE);  // 49
+  CHECK(!battery.isFull());
+  battery.update(800, CHARGE);  // 56, stops at 50
+  CHECK_EQUAL(battery.level(), 50);
+  CHECK(battery.isFull());
+
+  battery.reset();
+  CHECK_EQUAL(battery.level(), 0);
+  CHECK_EQUAL(battery.update(5000, CHARGE), 0U);  // starts the clock again
+  CHECK_EQUAL(battery.update(5100, CHARGE), 1U);
+}
+
+}  // namespace
+
+int main() {
+  testStartsClock();
+  testNormalSteps();
+  testCatchUpLimit();
+  testMillisWrap();
+  testNoCharge();
+  testFullAndReset();
+  return checkResults("test_battery_model");
+}
@@ -0,0 +1,234 @@
+/*
+ * test_coroutine.cpp
+ *
+ * Checks Coroutine and the COROUTINE_... macros from coroutine.h: each
+ * resume() carries on from the last waiting point, the waits (YIELD, AWAIT,
+ * AWAIT_MS, AWAIT_KEY) hold until they should, COROUTINE_CALL() runs another
+ * coroutine from its start to its end, COROUTINE_EXIT() finishes early, and
+ * a finished coroutine only runs again after restart().
+ */
+
+#include "Arduino.h"
+#include "coroutine.h"
+#include "check.h"
+
+namespace {
+
+using arduino_shim::now_micros;
+using arduino_shim::now_millis;
+
+// Each step of a coroutine adds its letter, so "steps" shows how far it got.
+std::string steps;
+bool go = false;
+
+void waits(Coroutine &co) {
+  COROUTINE_BEGIN(co);
+  steps += 'a';
+  COROUTINE_YIELD();
+  steps += 'b';
+  COROUTINE_AWAIT(go);
+  steps += 'c';
+  COROUTINE_AWAIT_MS(500);
+  steps += 'd';
+  COROUTINE_END();
+}
+
+// resume() and return the steps it ran.
+std::string resumed(Coroutine &co, bool *running = NULL) {
+  steps.clear();
+  bool result = co.resume();
+  if (running != NULL) {
+    *running = result;
+  }
+  return steps;
+}
+
+void testWaits() {
+  now_millis = 1000;
+  go = false;
+  Coroutine co(waits);
+  bool running = false;
+  CHECK(resumed(co, &running) == "a");
+  CHECK(running);
+  CHECK(resumed(co) == "b");
+  CHECK(resumed(co) == "");  // waiting for go
+  CHECK(resumed(co) == "");
+  go = true;
+  now_millis = 2000;
+  CHECK(resumed(co) == "c");  // the 500 ms start now
+  now_millis = 2499;
+  CHECK(resumed(co, &running) == "");
+  CHECK(running);
+  now_millis = 2500;
+  CHECK(resumed(co, &running) == "d");
+  CHECK(!running);
+  CHECK(co.isDone());
+
+  // Done: resume() doesn't run it again...
+  CHECK(resumed(co, &running) == "");
+  CHECK(!running);
+
+  // ...until restart()
+  co.restart();
+  CHECK(!co.isDone());
+  CHECK(resumed(co) == "a");
+  CHECK(resumed(co) == "bc");  // go is still true, so no wait there
+
+  // The wait carries on across millis() wrapping round to 0
+  now_millis = (unsigned long)-1 - 99;
+  co.restart();
+  resumed(co);
+  CHECK(resumed(co) == "bc");
+  now_millis = 399;  // 499 ms later
+  CHECK(resumed(co) == "");
+  now_millis = 400;
+  CHECK(resumed(co) == "d");
+}
+
+// A stand-in for the Keypad library: hands out "keys" one getKey() at a time.
+const char NO_KEY = '\0';
+
+struct FakeKeypad {
+  const char *keys;
+
+  char getKey() {
+    return (*keys != '\0') ? *keys++ : NO_KEY;
+  }
+};
+
+FakeKeypad keypad = { "" };
+char key;
+
+void readsTwoKeys(Coroutine &co) {
+  COROUTINE_BEGIN(co);
+  COROUTINE_AWAIT_KEY(keypad, key);
+  steps += key;
+  COROUTINE_AWAIT_KEY(keypad, key);
+  steps += key;
+  COROUTINE_END();
+}
+
+void testAwaitKey() {
+  Coroutine co(readsTwoKeys);
+  CHECK(resumed(co) == "");
+  keypad.keys = "7";
+  CHECK(resumed(co) == "7");
+  CHECK(resumed(co) == "");
+  keypad.keys = "#";
+  bool running = true;
+  CHECK(resumed(co, &running) == "#");
+  CHECK(!running);
+}
+
+void child(Coroutine &co) {
+  COROUTINE_BEGIN(co);
+  steps += 'x';
+  COROUTINE_YIELD();
+  steps += 'y';
+  COROUTINE_END();
+}
+
+Coroutine child_co(child);
+
+void parent(Coroutine &co) {
+  COROUTINE_BEGIN(co);
+  steps += 'P';
+  COROUTINE_CALL(child_co);
+  steps += 'Q';
+  COROUTINE_CALL(child_co);  // from the start again, though it finished
+  steps += 'R';
+  COROUTINE_END();
+}
+
+void testCall() {
+  Coroutine co(parent);
+  CHECK(resumed(co) == "Px");
+  CHECK(!child_co.isDone());
+  CHECK(resumed(co) == "yQx");
+  bool running = true;
+  CHECK(resumed(co, &running) == "yR");
+  CHECK(!running);
+  CHECK(child_co.isDone());
+}
+
+bool stop_early = false;
+
+void exitsEarly(Coroutine &co) {
+  COROUTINE_BEGIN(co);
+  steps += '1';
+  COROUTINE_YIELD();
+  if (stop_early) {
+    COROUTINE_EXIT();
+  }
+  steps += '2';
+  COROUTINE_YIELD();
+  steps += '3';
+  COROUTINE_END();
+}
+
+void testExit() {
+  stop_early = true;
+  Coroutine co(exitsEarly);
+  resumed(co);
+  bool running = true;
+  CHECK(resumed(co, &running) == "");
+  CHECK(!running);
+  CHECK(co.isDone());
+  CHECK(resumed(co) == "");
+
+  // Restarted without exiting, it gets to the end
+  stop_early = false;
+  co.restart();
+  CHECK(resumed(co) == "1");
+  CHECK(resumed(co) == "2");
+  CHECK(resumed(co) == "3");
+  CHECK(co.isDone());
+}
+
+// Takes 10 us to check
+bool slowToCheck() {
+  now_micros += 10;
+  return go;
+}
+
+// Takes 40 us to get going and 100 us for its last step.
+void timed(Coroutine &co) {
+  COROUTINE_BEGIN(co);
+  now_micros += 40;
+  COROUTINE_AWAIT(slowToCheck());
+  now_micros += 100;
+  COROUTINE_END();
+}
+
+void testStats() {
+  now_micros = 0;
+  go = false;
+  Coroutine co(timed);
+  co.resume();  // 40 + 10 us
+  co.resume();  // 10 us, just checking
+  go = true;
+  co.resume();  // 10 + 100 us
+  co.resume();  // done, not run or counted
+
+  arduino_shim::PrintedText printed;
+  co.printStats(printed);
+  CHECK(printed.text == "resumes,min_us,avg_us,max_us\r\n"
+                        "3,10,56,110\r\n");
+
+  co.clearStats();
+  arduino_shim::PrintedText cleared;
+  co.printStats(cleared);
+  CHECK(cleared.text == "resumes,min_us,avg_us,max_us\r\n"
+                        "0,0,0,0\r\n");
+}
+
+}  // namespace
+
+int main() {
+  testWaits();
+  testAwaitKey();
+  testCall();
+  testExit();
+  testStats();
+  return checkResults("test_coroutine");
+}
@@ -0,0 +1,205 @@
+/*
+ * test_countdown_timer.cpp
+ *
+ * Checks CountdownTimer from countdown_timer.h, with Timer1 simulated cycle
+ * by cycle (see runCycles()), so cycle_clock.h's overflow and compare
+ * interrupts run on exactly the cycles they would on the HERO:
+ *
+ * - every tick comes on the exact clock cycle of its second: a 3.5 s
+ *   countdown ticks at 0.5, 1.5, 2.5 and 3.5 s, to the cycle
+ * - a 5 minute countdown is still exact at the end (it doesn't drift)
+ * - remainingMicros() and remainingMillis() between ticks
+ * - secondPassed() is true once per tick, and isSecondWaiting() shows a tick
+ *   without taking it
+ * - stop() stops the ticks
+ *
+ * On the HERO the cycle count wraps round to 0 after 268 seconds.  Here an
+ * unsigned long is 64 bits, so it doesn't, and the 5 minute countdown only
+ * checks for drift.
+ */
+
+#include "Arduino.h"
+#include "countdown_timer.h"
+#include "check.h"
+
+namespace {
+
+const unsigned long CYCLES_PER_SECOND = F_CPU;
+
+// Ticks seen by runCycles(), as cycles after "start_cycle"
+const int MAX_TICKS = 400;
+unsigned long tick_cycles[MAX_TICKS];
+int tick_count = 0;
+unsigned long start_cycle = 0;
+bool take_ticks = true;  // false leaves ticks for the test to find
+
+void noteTick() {
+  if (take_ticks && countdown_timer.secondPassed() && tick_count < MAX_TICKS) {
+    tick_cycles[tick_count++] = cycle_clock.now() - start_cycle;
+  }
+}
+
+/*
+ * Let "cycles" clock cycles pass.  Timer1 counts one per cycle, setting TOV1
+ * when it wraps round to 0 and OCF1B when it reaches OCR1B.  A flag whose
+ * interrupt is on runs the interrupt straight away (clearing the flag, as
+ * the HERO does on entering it), compare B first, as its vector comes first.
+ */
+void runCycles(unsigned long cycles) {
+  while (cycles > 0) {
+    unsigned long step = 65536UL - TCNT1;  // to the wrap around
+    unsigned long to_match = (uint16_t)(OCR1B - TCNT1);
+    if (to_match == 0) {
+      to_match = 65536UL;
+    }
+    if (to_match < step) {
+      step = to_match;
+    }
+    if (cycles < step) {
+      step = cycles;
+    }
+    TCNT1 = (uint16_t)(TCNT1 + step);
+    cycles -= step;
+
+    if (TCNT1 == OCR1B) {
+      TIFR1.raise(_BV(OCF1B));
+    }
+    if (TCNT1 == 0) {
+      TIFR1.raise(_BV(TOV1));
+    }
+    if ((TIFR1 & _BV(OCF1B)) && (TIMSK1 & _BV(OCIE1B))) {
+      TIFR1 = _BV(OCF1B);
+      TIMER1_COMPB_vect();
+      noteTick();
+    }
+    if ((TIFR1 & _BV(TOV1)) && (TIMSK1 & _BV(TOIE1))) {
+      TIFR1 = _BV(TOV1);
+      TIMER1_OVF_vect();
+      noteTick();
+    }
+  }
+}
+
+void runMillis(unsigned long ms) {
+  runCycles(ms * CycleClock::CYCLES_PER_MILLISECOND);
+}
+
+// Start a countdown part way through a Timer1 count, so no tick lines up
+// with a wrap around by chance.
+void startCountdown(unsigned long ms) {
+  cycle_clock.begin();
+  runCycles(12345);
+  tick_count = 0;
+  start_cycle = cycle_clock.now();
+  countdown_timer.start(ms);
+}
+
+void testTicksOnTheSecond() {
+  startCountdown(3500);
+  CHECK(countdown_timer.isRunning());
+  CHECK_EQUAL(countdown_timer.remainingMillis(), 3500);
+
+  runMillis(4000);
+  CHECK_EQUAL(tick_count, 4);
+  CHECK_EQUAL(tick_cycles[0], CYCLES_PER_SECOND / 2);
+  CHECK_EQUAL(tick_cycles[1], CYCLES_PER_SECOND * 3 / 2);
+  CHECK_EQUAL(tick_cycles[2], CYCLES_PER_SECOND * 5 / 2);
+  CHECK_EQUAL(tick_cycles[3], CYCLES_PER_SECOND * 7 / 2);
+  CHECK(countdown_timer.isFinished());
+  CHECK(!countdown_timer.isRunning());
+  CHECK_EQUAL(countdown_timer.remainingMicros(), 0);
+
+  // A whole number of seconds ticks first after 1 second
+  startCountdown(3000);
+  runMillis(3500);
+  CHECK_EQUAL(tick_count, 3);
+  CHECK_EQUAL(tick_cycles[0], CYCLES_PER_SECOND);
+  CHECK_EQUAL(tick_cycles[2], 3 * CYCLES_PER_SECOND);
+  CHECK(countdown_timer.isFinished());
+
+  // A countdown of 0 is finished straight away, with its tick at 0
+  startCountdown(0);
+  CHECK(countdown_timer.isFinished());
+  CHECK(countdown_timer.secondPassed());
+}
+
+void testNoDrift() {
+  startCountdown(300000);
+  runMillis(301000);
+  CHECK_EQUAL(tick_count, 300);
+  bool all_exact = true;
+  for (int tick = 0; tick < tick_count; tick++) {
+    all_exact &= tick_cycles[tick] == (tick + 1) * CYCLES_PER_SECOND;
+  }
+  CHECK(all_exact);
+  CHECK(countdown_timer.isFinished());
+}
+
+void testRemaining() {
+  startCountdown(2500);
+  runMillis(250);
+  CHECK_EQUAL(countdown_timer.remainingMicros(), 2250000);
+  runCycles(CycleClock::CYCLES_PER_MICROSECOND * 1000 - 1);  // 1 cycle short of 1 ms
+  CHECK_EQUAL(countdown_timer.remainingMicros(), 2249000);
+  CHECK_EQUAL(countdown_timer.remainingMillis(), 2249);  // rounded up
+  runCycles(1);
+  CHECK_EQUAL(countdown_timer.remainingMillis(), 2249);
+  runMillis(249);
+  CHECK_EQUAL(countdown_timer.remainingMillis(), 2000);  // the first tick is due now
+  runCycles(1);
+  CHECK_EQUAL(tick_count, 1);
+  CHECK_EQUAL(countdown_timer.remainingMillis(), 2000);
+  runMillis(2500);
+  CHECK_EQUAL(countdown_timer.remainingMillis(), 0);
+}
+
+void testSecondPassed() {
+  take_ticks = false;
+  startCountdown(2000);
+  CHECK(!countdown_timer.isSecondWaiting());
+  CHECK(!countdown_timer.secondPassed());
+  runMillis(999);
+  CHECK(!countdown_timer.isSecondWaiting());
+  runMillis(1);
+  CHECK(countdown_timer.isSecondWaiting());
+  CHECK(countdown_timer.isSecondWaiting());  // looking doesn't take it
+  CHECK(countdown_timer.secondPassed());
+  CHECK(!countdown_timer.isSecondWaiting());
+  CHECK(!countdown_timer.secondPassed());  // once per tick
+
+  // The last tick, at 0, is a second passed too
+  runMillis(1000);
+  CHECK(countdown_timer.isFinished());
+  CHECK(countdown_timer.secondPassed());
+  take_ticks = true;
+}
+
+void testStop() {
+  startCountdown(5000);
+  runMillis(1500);
+  CHECK_EQUAL(tick_count, 1);
+  countdown_timer.stop();
+  CHECK(!countdown_timer.isRunning());
+  CHECK_EQUAL(countdown_timer.remainingMicros(), 0);
+  runMillis(5000);
+  CHECK_EQUAL(tick_count, 1);
+  CHECK(!countdown_timer.isFinished());
+
+  // Started again, it counts from the new start
+  startCountdown(1500);
+  runMillis(2000);
+  CHECK_EQUAL(tick_count, 2);
+  CHECK_EQUAL(tick_cycles[0], CYCLES_PER_SECOND / 2);
+  CHECK(countdown_timer.isFinished());
+}
+
+}  // namespace
+
+int main() {
+  testTicksOnTheSecond();
+  testNoDrift();
+  testRemaining();
+  testSecondPassed();
+  testStop();
+  return checkResults("test_countdown_timer");
+}
@@ -0,0 +1,150 @@
+/*
+ * test_debouncer.cpp
+ *
+ * Checks VerticalDebouncer from debouncer.h with bounce patterns: a switch
+ * changes on exactly the SAMPLES'th (4th) different reading in a row, and
+ * any shorter glitch is ignored.  All 8 switches are also checked together
+ * against a plain one-counter-per-switch debouncer.
+ */
+
+#include "Arduino.h"
+#include "debouncer.h"
+#include "check.h"
+
+namespace {
+
+const byte SWITCH = _BV(2);  // the switch the single switch tests flip
+
+// Feed "reading" "times" times.  Returns the readings (1 = first) that
+// changed SWITCH, as bits: bit 0 for the first reading, bit 1 the second...
+unsigned int feed(VerticalDebouncer &debouncer, byte reading, byte times) {
+  unsigned int changed_on = 0;
+  for (byte i = 0; i < times; i++) {
+    if (debouncer.update(reading) & SWITCH) {
+      changed_on |= 1U << i;
+    }
+  }
+  return changed_on;
+}
+
+void testChangesOnFourthReading() {
+  CHECK_EQUAL(VerticalDebouncer::SAMPLES, 4);
+
+  VerticalDebouncer debouncer;
+  CHECK_EQUAL(feed(debouncer, SWITCH, 6), 1U << 3);  // turns on with the 4th reading only
+  CHECK_EQUAL(debouncer.state(), SWITCH);
+
+  CHECK_EQUAL(feed(debouncer, 0, 3), 0U);
+  CHECK_EQUAL(debouncer.update(0), SWITCH);  // 4th: turns off
+  CHECK_EQUAL(debouncer.released(), SWITCH);
+  CHECK_EQUAL(debouncer.pressed(), 0);
+  CHECK_EQUAL(debouncer.state(), 0);
+  CHECK_EQUAL(debouncer.update(0), 0);  // and stays off
+  CHECK_EQUAL(debouncer.released(), 0);
+
+  feed(debouncer, SWITCH, 3);
+  CHECK_EQUAL(debouncer.update(SWITCH), SWITCH);
+  CHECK_EQUAL(debouncer.pressed(), SWITCH);
+  CHECK_EQUAL(debouncer.released(), 0);
+}
+
+void testIgnoresGlitches() {
+  // Glitches of 1, 2 and 3 readings, each followed by the settled position
+  for (byte length = 1; length < VerticalDebouncer::SAMPLES; length++) {
+    VerticalDebouncer off;
+    CHECK_EQUAL(feed(off, SWITCH, length), 0U);
+    CHECK_EQUAL(feed(off, 0, 1), 0U);
+    CHECK_EQUAL(off.state(), 0);
+
+    VerticalDebouncer on(SWITCH);
+    CHECK_EQUAL(feed(on, 0, length), 0U);
+    CHECK_EQUAL(feed(on, SWITCH, 1), 0U);
+    CHECK_EQUAL(on.state(), SWITCH);
+
+    // A glitch doesn't count towards the next change: that still needs 4 in a row
+    CHECK_EQUAL(feed(off, SWITCH, 4), 1U << 3);
+  }
+
+  // Contacts bouncing: ON OFF ON ON OFF ON ON ON OFF - never 4 in a row
+  VerticalDebouncer bouncing;
+  const byte BOUNCES[] = { 1, 0, 1, 1, 0, 1, 1, 1, 0 };
+  for (byte bounce : BOUNCES) {
+    CHECK_EQUAL(bouncing.update(bounce ? SWITCH : 0), 0);
+  }
+  // ...then settling ON: the 4th ON after the last OFF turns it on
+  CHECK_EQUAL(feed(bouncing, SWITCH, 4), 1U << 3);
+}
+
+void testReset() {
+  VerticalDebouncer debouncer;
+  feed(debouncer, SWITCH, 3);
+  debouncer.reset(0);  // forgets the 3 readings
+  CHECK_EQUAL(feed(debouncer, SWITCH, 4), 1U << 3);
+
+  debouncer.reset(0xFF);
+  CHECK_EQUAL(debouncer.state(), 0xFF);
+  CHECK_EQUAL(debouncer.pressed(), 0);
+  CHECK_EQUAL(feed(debouncer, 0xFF & ~SWITCH, 4), 1U << 3);
+}
+
+// The same debouncing done the slow way, one counter per switch.
+struct PlainDebouncer {
+  byte state;
+  byte counts[8];
+
+  PlainDebouncer()
+    : state(0), counts() {}
+
+  byte update(byte reading) {
+    byte toggled = 0;
+    for (byte i = 0; i < 8; i++) {
+      byte bit = 1 << i;
+      if ((reading & bit) == (state & bit)) {
+        counts[i] = 0;
+      } else if (++counts[i] == VerticalDebouncer::SAMPLES) {
+        counts[i] = 0;
+        toggled |= bit;
+      }
+    }
+    state ^= toggled;
+    return toggled;
+  }
+};
+
+void testEightSwitchesTogether() {
+  // Each switch flips now and then, and bounces for a random time when it does
+  VerticalDebouncer debouncer;
+  PlainDebouncer plain;
+  byte positions = 0;
+  byte bouncing_for[8] = {};
+  srand(35);
+  bool all_match = true;
+  for (long n = 0; n < 100000; n++) {
+    byte reading = 0;
+    for (byte i = 0; i < 8; i++) {
+      if (bouncing_for[i] == 0 && rand() % 50 == 0) {
+        positions ^= 1 << i;
+        bouncing_for[i] = rand() % 8;
+      }
+      bool on = positions & (1 << i);
+      if (bouncing_for[i] > 0) {
+        bouncing_for[i]--;
+        on = rand() % 2;
+      }
+      reading |= on ? (1 << i) : 0;
+    }
+    byte toggled = debouncer.update(reading);
+    all_match &= toggled == plain.update(reading) && debouncer.state() == plain.state;
+  }
+  CHECK(all_match);
+}
+
+}  // namespace
+
+int main() {
+  testChangesOnFourthReading();
+  testIgnoresGlitches();
+  testReset();
+  testEightSwitchesTogether();
+  return checkResults("test_debouncer");
+}
@@ -0,0 +1,150 @@
+/*
+ * test_fixed_rate_loop.cpp
+ *
+ * Checks FixedRateLoop from fixed_rate_loop.h: ticks are due on a fixed beat
+ * however late each one starts, each tick's lateness lands in the right
+ * jitter bucket, a stall skips the ticks it missed (counted in the overrun
+ * histogram) and keeps the beat, and setPeriod() re-times from the last tick.
+ * The histograms are read back from printReport().
+ */
+
+#include "Arduino.h"
+#include "fixed_rate_loop.h"
+#include "check.h"
+
+namespace {
+
+// ready() at micros() "now"
+bool readyAt(FixedRateLoop &ticker, unsigned long now) {
+  arduino_shim::now_micros = now;
+  return ticker.ready();
+}
+
+// Line "line" (0 = first) of printReport()
+std::string reportLine(const FixedRateLoop &ticker, int line) {
+  arduino_shim::PrintedText printed;
+  ticker.printReport(printed);
+  size_t start = 0;
+  for (int skip = 0; skip < line; skip++) {
+    start = printed.text.find("\r\n", start) + 2;
+  }
+  return printed.text.substr(start, printed.text.find("\r\n", start) - start);
+}
+
+const int TOTALS_LINE = 0;
+const int JITTER_HEADING_LINE = 1;
+const int JITTER_LINE = 2;
+const int OVERRUN_HEADING_LINE = 3;
+const int OVERRUN_LINE = 4;
+
+void testJitterBuckets() {
+  const unsigned long PERIOD = 100000;  // us
+  FixedRateLoop ticker(100);
+  CHECK(readyAt(ticker, 0));  // tick 0 starts on the first call
+  CHECK(!readyAt(ticker, 0));
+  CHECK(!readyAt(ticker, PERIOD - 1));
+
+  // Tick n starts "late" us after its deadline: each bucket's edges
+  const unsigned long LATE[] = { 7, 8, 15, 16, 4095, 4096, 8191, 8192, PERIOD - 1 };
+  unsigned long deadline = 0;
+  for (unsigned long late : LATE) {
+    deadline += PERIOD;  // however late the last tick was
+    CHECK(!readyAt(ticker, deadline - 1));
+    CHECK(readyAt(ticker, deadline + late));
+    CHECK_EQUAL(ticker.lateness(), late);
+    CHECK(!readyAt(ticker, deadline + late));
+  }
+
+  CHECK_EQUAL(ticker.ticks(), 10);
+  CHECK_EQUAL(ticker.overruns(), 0);
+  CHECK(reportLine(ticker, TOTALS_LINE) == "ticks,10,overruns,0,max_late_us,99999");
+  CHECK(reportLine(ticker, JITTER_HEADING_LINE)
+        == "late_us,<8,<16,<32,<64,<128,<256,<512,<1024,<2048,<4096,<8192,>=8192");
+  CHECK(reportLine(ticker, JITTER_LINE) == "count,2,2,1,0,0,0,0,0,0,1,2,2");
+  CHECK(reportLine(ticker, OVERRUN_LINE) == "count,0,0,0,0");
+}
+
+void testOverruns() {
+  const unsigned long PERIOD = 200000;  // us
+  const unsigned long START = 1000;
+  FixedRateLoop ticker(200);
+  CHECK(readyAt(ticker, START));
+  CHECK(readyAt(ticker, START + PERIOD));
+
+  // A 450 ms stall: the tick due at START + 2 periods starts 450 ms late, so
+  // 2 ticks were missed.  They are skipped and the beat is kept: the next
+  // tick is due at START + 5 periods, not 200 ms after the late one.
+  CHECK(readyAt(ticker, START + 2 * PERIOD + 450000));
+  CHECK_EQUAL(ticker.overruns(), 1);
+  CHECK(!readyAt(ticker, START + 5 * PERIOD - 1));
+  CHECK(readyAt(ticker, START + 5 * PERIOD));
+  CHECK_EQUAL(ticker.lateness(), 0);
+  CHECK(reportLine(ticker, OVERRUN_LINE) == "count,0,1,0,0");
+
+  // Exactly one period late missed 1 tick; 5 periods late counts as 4 or more
+  CHECK(readyAt(ticker, START + 7 * PERIOD));
+  CHECK(!readyAt(ticker, START + 8 * PERIOD - 1));
+  CHECK(readyAt(ticker, START + 13 * PERIOD + 10));
+  CHECK(readyAt(ticker, START + 14 * PERIOD));
+
+  CHECK_EQUAL(ticker.overruns(), 3);
+  CHECK_EQUAL(ticker.ticks(), 7);
+  CHECK(reportLine(ticker, TOTALS_LINE) == "ticks,7,overruns,3,max_late_us,1000010");
+  CHECK(reportLine(ticker, OVERRUN_HEADING_LINE) == "missed,1,2,3,4+");
+  CHECK(reportLine(ticker, OVERRUN_LINE) == "count,1,1,0,1");
+  CHECK(reportLine(ticker, JITTER_LINE) == "count,4,0,0,0,0,0,0,0,0,0,0,3");
+
+  // clearStats() starts the counts again but not the beat
+  ticker.clearStats();
+  CHECK(reportLine(ticker, TOTALS_LINE) == "ticks,0,overruns,0,max_late_us,0");
+  CHECK(reportLine(ticker, OVERRUN_LINE) == "count,0,0,0,0");
+  CHECK(!readyAt(ticker, START + 15 * PERIOD - 1));
+  CHECK(readyAt(ticker, START + 15 * PERIOD));
+  CHECK_EQUAL(ticker.ticks(), 1);
+}
+
+void testSetPeriod() {
+  // Before the first tick it only changes the period
+  FixedRateLoop ticker(100);
+  ticker.setPeriod(50);
+  CHECK(readyAt(ticker, 7000));
+  CHECK(!readyAt(ticker, 56999));
+  CHECK(readyAt(ticker, 57000));
+
+  // Shorter: the next tick is due 20 ms after the last one (at 57 ms)
+  arduino_shim::now_micros = 60000;
+  ticker.setPeriod(20);
+  CHECK(!readyAt(ticker, 76999));
+  CHECK(readyAt(ticker, 77000));
+
+  // Longer: 300 ms after the last one, then every 300 ms
+  ticker.setPeriod(300);
+  CHECK(!readyAt(ticker, 376999));
+  CHECK(readyAt(ticker, 377000));
+  CHECK(!readyAt(ticker, 676999));
+  CHECK(readyAt(ticker, 677000));
+  CHECK_EQUAL(ticker.overruns(), 0);
+}
+
+void testMicrosWrap() {
+  // The beat carries on across micros() wrapping round to 0
+  const unsigned long LAST_MICROS = (unsigned long)-1;
+  FixedRateLoop ticker(100);
+  CHECK(readyAt(ticker, LAST_MICROS - 49999));
+  CHECK(!readyAt(ticker, LAST_MICROS));
+  CHECK(!readyAt(ticker, 49999));
+  CHECK(readyAt(ticker, 50000));
+  CHECK_EQUAL(ticker.lateness(), 0);
+  CHECK(readyAt(ticker, 150003));
+  CHECK_EQUAL(ticker.lateness(), 3);
+}
+
+}  // namespace
+
+int main() {
+  testJitterBuckets();
+  testOverruns();
+  testSetPeriod();
+  testMicrosWrap();
+  return checkResults("test_fixed_rate_loop");
+}
@@ -0,0 +1,286 @@
+/*
+ * test_quadrature_encoder.cpp
+ *
+ * Stress test for QuadratureEncoder's sequence counter (quadrature_encoder.h):
+ * snapshot(), velocity() and acceleration() must never return a count or
+ * click times that are half from before a click and half from after it,
+ * wherever service() interrupts them.
+ *
+ * To interrupt them everywhere, the test sets the processor's "trap flag",
+ * which stops it after every single instruction with a SIGTRAP.  The signal
+ * handler plays the part of the pin change interrupt: it calls service()
+ * after each instruction of the read, and turns the dial a step at the
+ * instructions the test picks.  Each read is repeated with the dial clicking
+ * at every instruction in turn, and every result must be one the encoder
+ * really had at some moment.
+ *
+ * On the computer the count is read in one instruction (on the HERO it takes
+ * two), so here only velocity() and acceleration(), which copy several
+ * values, can actually be caught half way.  snapshot() is still checked for a
+ * count and change that belong together.
+ *
+ * Setting the trap flag needs an x86-64 processor and Linux; anywhere else
+ * only the decoding checks at the start run.
+ */
+
+#include "Arduino.h"
+#include "quadrature_encoder.h"
+#include "check.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <signal.h>
+#include <ucontext.h>
+#define SINGLE_STEP_INTERRUPTS
+#endif
+
+namespace {
+
+const byte PIN_A = 2;  // PIND bit 2
+const byte PIN_B = 3;  // PIND bit 3
+
+QuadratureEncoder<PIN_A, PIN_B> encoder;
+
+// Pin states (B << 1 | A) for one click up: 11 -> 10 -> 00 -> 01 -> 11
+const byte CLICK_UP[4] = { 0b10, 0b00, 0b01, 0b11 };
+
+// Click n happens at micros() CLICK_TIME_BASE + n * CLICK_GAP, so the clicks
+// are evenly spaced: velocity() is 1000 clicks per second and acceleration() 0.
+const unsigned long CLICK_TIME_BASE = 5000000UL;
+const unsigned long CLICK_GAP = 1000;
+
+volatile byte dial_step = 0;        // steps turned so far (4 per click)
+volatile unsigned long clicks = 0;  // clicks the dial has made
+
+void setPins(byte state) {
+  PIND = ((state & 0b01) ? _BV(PIN_A) : 0) | ((state & 0b10) ? _BV(PIN_B) : 0);
+}
+
+// Turn the dial one step up, as the interrupt sees it.  The 4th step of a click
+// finishes it, at its click time.
+void stepDialUp() {
+  byte step = dial_step++ & 3;
+  if (step == 3) {
+    clicks++;
+    arduino_shim::now_micros = CLICK_TIME_BASE + clicks * CLICK_GAP;
+  }
+  setPins(CLICK_UP[step]);
+}
+
+void testDecoding() {
+  setPins(0b11);
+  encoder.begin();
+  for (int i = 0; i < 8; i++) {  // two clicks up
+    stepDialUp();
+    encoder.service();
+  }
+  CHECK_EQUAL(encoder.getCount(), 2);
+  CHECK_EQUAL(encoder.getChange(), 2);
+  CHECK_EQUAL(encoder.getChange(), 0);
+
+  // Half a click and back again doesn't count
+  setPins(0b10);
+  encoder.service();
+  setPins(0b00);
+  encoder.service();
+  setPins(0b10);
+  encoder.service();
+  setPins(0b11);
+  encoder.service();
+  CHECK_EQUAL(encoder.getCount(), 2);
+}
+
+#ifdef SINGLE_STEP_INTERRUPTS
+
+// The simulated interrupt: where the dial steps, counted in instructions.
+volatile long instruction = 0;     // instructions since interrupting started
+volatile long first_step_at = 0;   // instruction of the first dial step
+volatile long step_every = 1;      // instructions between dial steps
+volatile byte steps_left = 0;      // dial steps still to take
+volatile bool stop_interrupting = false;
+
+void onInstruction(int, siginfo_t *, void *context) {
+  ucontext_t *processor = (ucontext_t *)context;
+  if (stop_interrupting) {
+    processor->uc_mcontext.gregs[REG_EFL] &= ~0x100L;  // clear the trap flag
+    return;
+  }
+  if (steps_left > 0 && instruction >= first_step_at
+      && (instruction - first_step_at) % step_every == 0) {
+    stepDialUp();
+    steps_left--;
+  }
+  instruction++;
+  encoder.service();  // an interrupt after every instruction
+}
+
+// Set the trap flag: from the next instruction on, onInstruction() runs after each one.
+inline void startInterrupting() {
+  stop_interrupting = false;
+  instruction = 0;
+  asm volatile(
+    "lea -128(%%rsp), %%rsp\n\t"  // step over the red zone, it may hold our variables
+    "pushfq\n\t"
+    "orq $0x100, (%%rsp)\n\t"
+    "popfq\n\t"
+    "lea 128(%%rsp), %%rsp"
+    :
+    :
+    : "memory", "cc");
+}
+
+inline void stopInterrupting() {
+  stop_interrupting = true;
+}
+
+// What a read returned, and the clicks before and after it.
+struct ReadResult {
+  unsigned long clicks_before;
+  unsigned long clicks_after;
+  unsigned long now;  // micros() given to velocity() or acceleration()
+  long instructions;  // instructions the read took
+  QuadratureEncoder<PIN_A, PIN_B>::Snapshot snapshot;
+  long velocity;
+  long acceleration;
+};
+
+enum READ {
+  READ_SNAPSHOT,
+  READ_VELOCITY,
+  READ_ACCELERATION
+};
+
+// Read while the dial turns "steps" steps, the first after instruction
+// "first_step" of the read and then every "every" instructions.
+ReadResult readWhileTurning(READ read, long first_step, long every, byte steps) {
+  ReadResult result = {};
+  result.clicks_before = clicks;
+  // The time of the last click the read might see
+  result.now = CLICK_TIME_BASE + (clicks + ((dial_step & 3) + steps) / 4) * CLICK_GAP;
+  first_step_at = first_step;
+  step_every = every;
+  steps_left = steps;
+
+  startInterrupting();
+  if (read == READ_SNAPSHOT) {
+    result.snapshot = encoder.snapshot();
+  } else if (read == READ_VELOCITY) {
+    result.velocity = encoder.velocity(result.now);
+  } else {
+    result.acceleration = encoder.acceleration(result.now);
+  }
+  stopInterrupting();
+  result.instructions = instruction;
+
+  // Take any steps the read was too quick for
+  for (; steps_left > 0; steps_left--) {
+    stepDialUp();
+    encoder.service();
+  }
+  result.clicks_after = clicks;
+  return result;
+}
+
+// velocity() when the newest click is click "newest", worked out the slow way
+// for SPEED_WINDOW evenly spaced clicks.
+long expectedVelocity(unsigned long newest, unsigned long now) {
+  const unsigned long SPAN = (QuadratureEncoder<PIN_A, PIN_B>::SPEED_WINDOW - 1) * CLICK_GAP;
+  unsigned long waiting = now - (CLICK_TIME_BASE + newest * CLICK_GAP);
+  if (waiting * (SPAN / CLICK_GAP) > SPAN) {
+    return 1000000L / (long)waiting;  // slowing down: at most one click since the last
+  }
+  return 1000000L / (long)CLICK_GAP;
+}
+
+int last_snapshot_count;  // count from the last snapshot()
+
+/*
+ * true if "result" is something the encoder really had at one moment during
+ * the read: the count of one of the clicks it overlapped, or the velocity
+ * and acceleration of one of them.
+ */
+bool isWhole(READ read, const ReadResult &result) {
+  if (read == READ_SNAPSHOT) {
+    int count = result.snapshot.count;
+    bool whole = (unsigned long)count >= result.clicks_before
+                 && (unsigned long)count <= result.clicks_after
+                 && result.snapshot.change == count - last_snapshot_count;
+    last_snapshot_count = count;
+    return whole;
+  }
+  if (read == READ_VELOCITY) {
+    for (unsigned long seen = result.clicks_before; seen <= result.clicks_after; seen++) {
+      if (result.velocity == expectedVelocity(seen, result.now)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  return result.acceleration == 0;  // the clicks are evenly spaced
+}
+
+/*
+ * Read with the dial clicking at every instruction of the read in turn, for
+ * a single click, then for several quick clicks with steps 1 to 16
+ * instructions apart.  service() runs after every instruction throughout.
+ */
+void stressRead(READ read) {
+  // How long the read is without any clicks
+  long length = readWhileTurning(read, 0, 1, 0).instructions;
+  CHECK(length > 0);
+
+  for (long at = 0; at <= length; at++) {
+    // Take the dial to the last step of a click first, so the click finishes at "at"
+    while ((dial_step & 3) != 3) {
+      stepDialUp();
+      encoder.service();
+    }
+    ReadResult result = readWhileTurning(read, at, 1, 1);
+    if (!CHECK(isWhole(read, result))) {
+      printf("    torn by a click at instruction %ld of %ld\n", at, length);
+      return;
+    }
+  }
+
+  for (long every = 1; every <= 16; every++) {
+    for (long at = 0; at <= length; at++) {
+      ReadResult result = readWhileTurning(read, at, every, 12);  // 3 clicks
+      if (!CHECK(isWhole(read, result))) {
+        printf("    torn by clicks from instruction %ld, %ld instructions apart\n", at, every);
+        return;
+      }
+    }
+  }
+}
+
+void testReadsNeverTorn() {
+  struct sigaction action = {};
+  action.sa_sigaction = onInstruction;
+  action.sa_flags = SA_SIGINFO;
+  sigaction(SIGTRAP, &action, NULL);
+
+  // Fill the click times so velocity() and acceleration() have a full window
+  for (int i = 0; i < 4 * QuadratureEncoder<PIN_A, PIN_B>::SPEED_WINDOW; i++) {
+    stepDialUp();
+    encoder.service();
+  }
+  last_snapshot_count = encoder.snapshot().count;
+
+  stressRead(READ_SNAPSHOT);
+  stressRead(READ_VELOCITY);
+  stressRead(READ_ACCELERATION);
+  CHECK_EQUAL(encoder.getCount(), (long)clicks);
+}
+
+#endif  // SINGLE_STEP_INTERRUPTS
+
+}  // namespace
+
+int main() {
+  testDecoding();
+#ifdef SINGLE_STEP_INTERRUPTS
+  testReadsNeverTorn();
+#else
+  printf("test_quadrature_encoder: no single-stepping here, stress test skipped\n");
+#endif
+  return checkResults("test_quadrature_encoder");
+}
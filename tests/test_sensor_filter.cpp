@@ -0,0 +1,267 @@
+/*
+ * test_sensor_filter.cpp
+ *
+ * Checks the filters in sensor_filter.h against the same filters worked out
+ * with floating point numbers:
+ *
+ * - a steady input comes out unchanged (DC gain of exactly 1)
+ * - sine waves come out as big as the float filter says they should, and the
+ *   LowPassBiquad presets pass, cut off and stop where their names say
+ * - sample by sample, the integer filters stay within a count of the float
+ *   ones
+ * - MedianOf3Filter gives exactly the middle of the last three samples
+ */
+
+#include "Arduino.h"
+#include "sensor_filter.h"
+#include "check.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+// Sine input: centered on 512 and 400 either side, so it stays in analogRead()'s range.
+// (Started at its peak, so the highest frequency, 0.5, is +400, -400, +400 ...)
+const double SINE_CENTER = 512;
+const double SINE_AMPLITUDE = 400;
+
+const int SETTLE_SAMPLES = 2000;   // long enough for every filter here to settle
+const int MEASURE_SAMPLES = 4000;  // test frequencies fit a whole number of cycles in this
+
+unsigned int sineSample(double frequency, int n) {
+  return (unsigned int)lround(SINE_CENTER + SINE_AMPLITUDE * cos(2 * PI * frequency * n));
+}
+
+// Nearest frequency (in cycles per sample) with a whole number of cycles in MEASURE_SAMPLES.
+double measurableFrequency(double frequency) {
+  return lround(frequency * MEASURE_SAMPLES) / (double)MEASURE_SAMPLES;
+}
+
+/*
+ * Feed "filter" a sine wave at "frequency" and return how big the wave
+ * coming out is compared to the one going in.  Only the part of the output
+ * at "frequency" is measured, so the rounding noise isn't counted.
+ */
+template <typename FILTER>
+double measureGain(double frequency) {
+  FILTER filter;
+  for (int n = 0; n < SETTLE_SAMPLES; n++) {
+    filter.update(sineSample(frequency, n));
+  }
+  double sine_part = 0;
+  double cosine_part = 0;
+  for (int n = SETTLE_SAMPLES; n < SETTLE_SAMPLES + MEASURE_SAMPLES; n++) {
+    double out = filter.update(sineSample(frequency, n)) - SINE_CENTER;
+    sine_part += out * sin(2 * PI * frequency * n);
+    cosine_part += out * cos(2 * PI * frequency * n);
+  }
+  // A sine wave lines up with itself half the time on average, except at 0.5
+  // where every sample is a peak
+  double lined_up = (frequency == 0.5) ? 1.0 : 0.5;
+  return sqrt(sine_part * sine_part + cosine_part * cosine_part)
+         / (lined_up * MEASURE_SAMPLES * SINE_AMPLITUDE);
+}
+
+// Settle "filter" on "from", then step to "to" and return where it settles.
+template <typename FILTER>
+unsigned int settleAfterStep(unsigned int from, unsigned int to) {
+  FILTER filter;
+  for (int n = 0; n < SETTLE_SAMPLES; n++) {
+    filter.update(from);
+  }
+  unsigned int out = 0;
+  for (int n = 0; n < SETTLE_SAMPLES; n++) {
+    out = filter.update(to);
+  }
+  return out;
+}
+
+// The EMA in floating point: each sample moves the output 1/2^SHIFT of the way.
+struct FloatEma {
+  double alpha;
+  double y;
+  bool primed;
+
+  explicit FloatEma(int shift)
+    : alpha(1.0 / (1 << shift)), y(0), primed(false) {}
+
+  double update(double x) {
+    y = primed ? y + alpha * (x - y) : x;
+    primed = true;
+    return y;
+  }
+
+  double gain(double frequency) const {
+    double w = 2 * PI * frequency;
+    // H(z) = alpha / (1 - (1 - alpha) z^-1)
+    double re = 1 - (1 - alpha) * cos(w);
+    double im = (1 - alpha) * sin(w);
+    return alpha / sqrt(re * re + im * im);
+  }
+};
+
+// The biquad in floating point, from the same 2^14 scaled coefficients.
+struct FloatBiquad {
+  double b0, b1, b2, a1, a2;
+  double x1, x2, y1, y2;
+  bool primed;
+
+  FloatBiquad(int B0, int B1, int B2, int A1, int A2)
+    : b0(B0 / 16384.0), b1(B1 / 16384.0), b2(B2 / 16384.0), a1(A1 / 16384.0), a2(A2 / 16384.0),
+      x1(0), x2(0), y1(0), y2(0), primed(false) {}
+
+  double update(double x) {
+    if (!primed) {
+      x1 = x2 = y1 = y2 = x;
+      primed = true;
+    }
+    double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+    x2 = x1;
+    x1 = x;
+    y2 = y1;
+    y1 = y;
+    return y;
+  }
+
+  double gain(double frequency) const {
+    double w = 2 * PI * frequency;
+    double num_re = b0 + b1 * cos(w) + b2 * cos(2 * w);
+    double num_im = -b1 * sin(w) - b2 * sin(2 * w);
+    double den_re = 1 + a1 * cos(w) + a2 * cos(2 * w);
+    double den_im = -a1 * sin(w) - a2 * sin(2 * w);
+    return sqrt((num_re * num_re + num_im * num_im) / (den_re * den_re + den_im * den_im));
+  }
+};
+
+// The float version of a BiquadFilter, with its coefficients.
+template <int B0, int B1, int B2, int A1, int A2>
+FloatBiquad floatVersion(const BiquadFilter<B0, B1, B2, A1, A2> &) {
+  return FloatBiquad(B0, B1, B2, A1, A2);
+}
+
+// Largest difference between "FILTER" and its float "reference" on a noisy, wandering input.
+template <typename FILTER, typename REFERENCE>
+double largestDifference(REFERENCE reference) {
+  FILTER filter;
+  srand(26);
+  double largest = 0;
+  for (int n = 0; n < 20000; n++) {
+    double wander = 300 * sin(2 * PI * n / 5000.0) + 150 * sin(2 * PI * n / 37.0);
+    unsigned int sample = (unsigned int)lround(SINE_CENTER + wander) + rand() % 41 - 20;
+    double difference = fabs(filter.update(sample) - reference.update(sample));
+    if (difference > largest) {
+      largest = difference;
+    }
+  }
+  return largest;
+}
+
+template <byte SHIFT>
+void testEma() {
+  FloatEma reference(SHIFT);
+
+  CHECK_EQUAL(settleAfterStep<EmaFilter<SHIFT> >(0, 1023), 1023);
+  CHECK_EQUAL(settleAfterStep<EmaFilter<SHIFT> >(1023, 0), 0);
+  CHECK_EQUAL(settleAfterStep<EmaFilter<SHIFT> >(100, 517), 517);
+
+  const double frequencies[] = { 0.001, 0.01, 0.05, 0.2, 0.5 };
+  for (double frequency : frequencies) {
+    frequency = measurableFrequency(frequency);
+    CHECK_NEAR(measureGain<EmaFilter<SHIFT> >(frequency), reference.gain(frequency), 0.01);
+  }
+
+  // The shift drops the fraction, so the output runs a little low, but by less than a count
+  CHECK(largestDifference<EmaFilter<SHIFT> >(FloatEma(SHIFT)) < 1);
+}
+
+// "cutoff" is where the preset's name says it cuts off, in cycles per sample.
+template <typename Filter>
+void testLowPass(double cutoff) {
+  FloatBiquad reference = floatVersion(Filter());
+
+  // Before the first sample it reads 0
+  Filter fresh;
+  CHECK_EQUAL(fresh.value(), 0);
+
+  // DC gain: a steady input settles to exactly itself, from below and from above
+  CHECK_EQUAL(settleAfterStep<Filter>(0, 1023), 1023);
+  CHECK_EQUAL(settleAfterStep<Filter>(1023, 0), 0);
+  CHECK_EQUAL(settleAfterStep<Filter>(0, 1), 1);
+  CHECK_EQUAL(settleAfterStep<Filter>(600, 517), 517);
+
+  // The preset really is a low-pass with its cutoff where the name says (-3 dB)
+  CHECK_NEAR(reference.gain(0), 1.0, 0.0001);
+  CHECK_NEAR(reference.gain(cutoff), sqrt(0.5), 0.01);
+
+  // Pass band, cutoff and stop band all match the float filter
+  const double multiples[] = { 0.25, 0.5, 1, 2, 4 };
+  for (double multiple : multiples) {
+    double frequency = measurableFrequency(cutoff * multiple);
+    CHECK_NEAR(measureGain<Filter>(frequency), reference.gain(frequency), 0.005);
+  }
+
+  // Pass band: a quarter of the cutoff gets through almost untouched
+  CHECK(measureGain<Filter>(measurableFrequency(cutoff / 4)) > 0.99);
+
+  // Stop band: 2 octaves above the cutoff is down at least 24 dB (a 2-pole
+  // Butterworth), and the highest frequency we can sample is stopped
+  CHECK(measureGain<Filter>(measurableFrequency(cutoff * 4)) < 0.063);
+  CHECK(reference.gain(0.5) < 0.0001);
+  CHECK(measureGain<Filter>(0.5) < 0.003);
+
+  CHECK(largestDifference<Filter>(reference) <= 1);
+}
+
+void testMedian() {
+  // Exactly the middle of the last three samples, like sorting them would give
+  MedianOf3Filter filter;
+  unsigned int history[3];
+  srand(3);
+  bool all_match = true;
+  for (int n = 0; n < 10000; n++) {
+    unsigned int sample = rand() % 1024;
+    if (n == 0) {
+      history[0] = history[1] = history[2] = sample;  // the first sample fills the history
+    }
+    history[n % 3] = sample;
+    unsigned int sorted[3] = { history[0], history[1], history[2] };
+    std::sort(sorted, sorted + 3);
+    all_match &= filter.update(sample) == sorted[1];
+  }
+  CHECK(all_match);
+
+  // Single spikes never get through, in either direction
+  MedianOf3Filter spikes;
+  bool spike_seen = false;
+  for (int n = 0; n < 100; n++) {
+    unsigned int sample = (n % 7 == 3) ? 1023 : (n % 7 == 5) ? 0 : 500;
+    spike_seen |= spikes.update(sample) != 500;
+  }
+  CHECK(!spike_seen);
+
+  // A real step gets through on its second sample
+  MedianOf3Filter step;
+  step.update(500);
+  step.update(500);
+  CHECK_EQUAL(step.update(600), 500);
+  CHECK_EQUAL(step.update(600), 600);
+
+  // A steady input comes straight out, so it passes every frequency it doesn't mangle
+  CHECK_EQUAL(settleAfterStep<MedianOf3Filter>(0, 1023), 1023);
+  CHECK_NEAR(measureGain<MedianOf3Filter>(measurableFrequency(0.01)), 1.0, 0.01);
+}
+
+}  // namespace
+
+int main() {
+  testEma<3>();
+  testEma<5>();
+  testLowPass<LowPassBiquad2>(0.02);
+  testLowPass<LowPassBiquad5>(0.05);
+  testLowPass<LowPassBiquad10>(0.10);
+  testMedian();
+  return checkResults("test_sensor_filter");
+}
@@ -0,0 +1,148 @@
+/*
+ * test_soft_pwm.cpp
+ *
+ * Checks SoftPwm from soft_pwm.h by calling its interrupt by hand and adding
+ * up how long each pin is on, in timer counts:
+ *
+ * - every brightness from 0 to 255 is on for exactly that many of every 255
+ *   counts, averaged over the 3 cycles the shared low slice repeats over
+ * - no slice is shorter than 3 counts, so a late interrupt can't miss one
+ * - pins on different ports are driven together, and pins that aren't
+ *   attached are left alone
+ * - a new brightness starts with the next cycle, never part way through one
+ */
+
+#include "Arduino.h"
+#include "soft_pwm.h"
+#include "check.h"
+
+namespace {
+
+const byte SLICES_PER_CYCLE = 7;
+const byte DITHER_CYCLES = 3;
+const unsigned int COUNTS_PER_CYCLE = 255;
+
+const byte PIN_B = 13;  // PORTB bit 5
+const byte PIN_D = 5;   // PORTD bit 5
+const byte PIN_C = 14;  // A0, PORTC bit 0
+const byte SPARE_PIN = 9;  // PORTB bit 1, never attached
+
+bool pinIsOn(byte pin) {
+  byte port = (digitalPinToPort(pin) == PB) ? PORTB : (digitalPinToPort(pin) == PC) ? PORTC : PORTD;
+  return port & digitalPinToBitMask(pin);
+}
+
+// What one run of slices showed: counts each pin was on, and the shortest slice.
+struct OnTime {
+  unsigned int on_b;
+  unsigned int on_d;
+  unsigned int on_c;
+  unsigned int total;
+  unsigned int shortest_slice;
+};
+
+/*
+ * Run "slices" slices, starting with the one just begun (by begin() or the
+ * last interrupt).  A slice lasts OCR2A + 1 counts, showing what its
+ * interrupt wrote to the ports; then the next interrupt starts the next one.
+ */
+OnTime runSlices(unsigned int slices) {
+  OnTime on = { 0, 0, 0, 0, 0xFFFF };
+  for (unsigned int n = 0; n < slices; n++) {
+    unsigned int length = OCR2A + 1;
+    on.on_b += pinIsOn(PIN_B) ? length : 0;
+    on.on_d += pinIsOn(PIN_D) ? length : 0;
+    on.on_c += pinIsOn(PIN_C) ? length : 0;
+    on.total += length;
+    if (length < on.shortest_slice) {
+      on.shortest_slice = length;
+    }
+    soft_pwm.serviceInterrupt();
+  }
+  return on;
+}
+
+void testEveryBrightness() {
+  soft_pwm.attach(PIN_B);
+  bool all_exact = true;
+  unsigned int shortest_slice = 0xFFFF;
+  for (unsigned int brightness = 0; brightness <= 255; brightness++) {
+    soft_pwm.write(PIN_B, brightness);
+    soft_pwm.begin();
+    OnTime on = runSlices(DITHER_CYCLES * SLICES_PER_CYCLE);
+    if (on.on_b != DITHER_CYCLES * brightness || on.total != DITHER_CYCLES * COUNTS_PER_CYCLE) {
+      printf("    brightness %u: on %u of %u counts\n", brightness, on.on_b, on.total);
+      all_exact = false;
+    }
+    if (on.shortest_slice < shortest_slice) {
+      shortest_slice = on.shortest_slice;
+    }
+  }
+  CHECK(all_exact);
+  CHECK_EQUAL(shortest_slice, 3);
+  CHECK_EQUAL(soft_pwm.read(PIN_B), 255);
+
+  // Full brightness is on all the time, 0 is never on
+  soft_pwm.write(PIN_B, 255);
+  soft_pwm.begin();
+  CHECK_EQUAL(runSlices(10 * SLICES_PER_CYCLE).on_b, 10 * COUNTS_PER_CYCLE);
+  soft_pwm.write(PIN_B, 0);
+  soft_pwm.begin();
+  CHECK_EQUAL(runSlices(10 * SLICES_PER_CYCLE).on_b, 0);
+}
+
+void testPortsTogether() {
+  soft_pwm.attach(PIN_D);
+  soft_pwm.attach(PIN_C);
+  soft_pwm.write(PIN_B, 200);
+  soft_pwm.write(PIN_D, 1);
+  soft_pwm.write(PIN_C, 130);
+  digitalWrite(SPARE_PIN, HIGH);
+  soft_pwm.begin();
+
+  OnTime on = runSlices(DITHER_CYCLES * SLICES_PER_CYCLE);
+  CHECK_EQUAL(on.on_b, DITHER_CYCLES * 200);
+  CHECK_EQUAL(on.on_d, DITHER_CYCLES * 1);
+  CHECK_EQUAL(on.on_c, DITHER_CYCLES * 130);
+  CHECK(pinIsOn(SPARE_PIN));  // PORTB is shared with PIN_B, but this pin isn't touched
+
+  // The lowest bits spread over the 3 cycles: brightness 1 is on 3 counts in one of them
+  soft_pwm.begin();
+  unsigned int cycles_on = 0;
+  for (byte cycle = 0; cycle < DITHER_CYCLES; cycle++) {
+    unsigned int on_d = runSlices(SLICES_PER_CYCLE).on_d;
+    CHECK(on_d == 0 || on_d == 3);
+    cycles_on += (on_d > 0);
+  }
+  CHECK_EQUAL(cycles_on, 1);
+
+  soft_pwm.end();
+  CHECK(!pinIsOn(PIN_B) && !pinIsOn(PIN_D) && !pinIsOn(PIN_C));
+  CHECK(pinIsOn(SPARE_PIN));
+  CHECK_EQUAL(TIMSK2, 0);
+}
+
+void testChangeWaitsForNextCycle() {
+  soft_pwm.write(PIN_B, 0b11110000);
+  soft_pwm.write(PIN_D, 0);
+  soft_pwm.write(PIN_C, 0);
+  soft_pwm.begin();
+  OnTime first_part = runSlices(3);  // the shared slice and bits 2 and 3
+
+  // Changed part way through a cycle: the rest of this cycle still shows 0b11110000
+  soft_pwm.write(PIN_B, 0b00001111);
+  OnTime rest = runSlices(SLICES_PER_CYCLE - 3);
+  CHECK_EQUAL(first_part.on_b + rest.on_b, 0b11110000);
+
+  // ...and the next cycles show the new value
+  CHECK_EQUAL(runSlices(DITHER_CYCLES * SLICES_PER_CYCLE).on_b, DITHER_CYCLES * 0b00001111);
+}
+
+}  // namespace
+
+int main() {
+  testEveryBrightness();
+  testPortsTogether();
+  testChangeWaitsForNextCycle();
+  return checkResults("test_soft_pwm");
+}
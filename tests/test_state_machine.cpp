@@ -0,0 +1,214 @@
+/*
+ * test_state_machine.cpp
+ *
+ * Checks StateMachine from state_machine.h with a small three state table:
+ * events follow the table, ignored events and guards that say no change
+ * nothing, the old state's exit action runs before the new state's entry
+ * action, update() runs only the current state's "during" action, and
+ * printHistory() shows the last HISTORY_SIZE transitions, oldest first.
+ */
+
+#include "Arduino.h"
+#include "state_machine.h"
+#include "check.h"
+
+namespace {
+
+using arduino_shim::now_micros;
+using arduino_shim::now_millis;
+
+enum STATE { IDLE, ARMED, RUNNING };
+enum EVENT { ARM, START, STOP, EVENT_COUNT };
+
+// Each action adds itself: "+" entry, "-" exit, "~" during, then the state's letter.
+std::string actions;
+bool start_allowed = false;
+
+void enterIdle() {
+  actions += "+I";
+}
+void exitIdle() {
+  actions += "-I";
+}
+void enterArmed() {
+  actions += "+A";
+}
+void exitArmed() {
+  actions += "-A";
+}
+void duringArmed() {
+  actions += "~A";
+}
+void enterRunning() {
+  actions += "+R";
+}
+void duringRunning() {
+  actions += "~R";
+}
+
+bool canStart() {
+  return start_allowed;
+}
+
+const StateTransition TRANSITIONS[][EVENT_COUNT] PROGMEM = {
+  // ARM,           START,                 STOP
+  { { ARMED, NULL }, NO_TRANSITION,         NO_TRANSITION },   // IDLE
+  { { ARMED, NULL }, { RUNNING, canStart }, { IDLE, NULL } },  // ARMED
+  { NO_TRANSITION,   NO_TRANSITION,         { IDLE, NULL } },  // RUNNING
+};
+
+const StateActions ACTIONS[] PROGMEM = {
+  { enterIdle, exitIdle, NULL },            // IDLE
+  { enterArmed, exitArmed, duringArmed },   // ARMED
+  { enterRunning, NULL, duringRunning },    // RUNNING (no exit action)
+};
+
+// handle() "event" and return the actions it ran.
+std::string handled(StateMachine &machine, byte event, bool *changed = NULL) {
+  actions.clear();
+  bool result = machine.handle(event);
+  if (changed != NULL) {
+    *changed = result;
+  }
+  return actions;
+}
+
+void testTransitions() {
+  StateMachine machine(&TRANSITIONS[0][0], ACTIONS, EVENT_COUNT);
+  CHECK_EQUAL(machine.state(), NO_STATE);
+  CHECK(!machine.handle(ARM));  // not started yet
+
+  actions.clear();
+  machine.begin(IDLE);
+  CHECK(actions == "+I");
+  CHECK_EQUAL(machine.state(), IDLE);
+
+  // Ignored events change nothing
+  bool changed = true;
+  CHECK(handled(machine, START, &changed) == "");
+  CHECK(!changed);
+  CHECK(handled(machine, EVENT_COUNT, &changed) == "");  // not an event at all
+  CHECK(!changed);
+  CHECK_EQUAL(machine.state(), IDLE);
+
+  // Exit the old state, then enter the new one
+  CHECK(handled(machine, ARM, &changed) == "-I+A");
+  CHECK(changed);
+  CHECK_EQUAL(machine.state(), ARMED);
+
+  // A transition to the same state still leaves and enters it
+  CHECK(handled(machine, ARM, &changed) == "-A+A");
+  CHECK(changed);
+
+  // A state with no exit action just enters the next
+  start_allowed = true;
+  handled(machine, START);
+  CHECK(handled(machine, STOP) == "+I");
+  CHECK_EQUAL(machine.state(), IDLE);
+}
+
+void testGuard() {
+  StateMachine machine(&TRANSITIONS[0][0], ACTIONS, EVENT_COUNT);
+  machine.begin(ARMED);
+
+  // The guard says no: no actions, still ARMED
+  start_allowed = false;
+  bool changed = true;
+  CHECK(handled(machine, START, &changed) == "");
+  CHECK(!changed);
+  CHECK_EQUAL(machine.state(), ARMED);
+
+  start_allowed = true;
+  CHECK(handled(machine, START, &changed) == "-A+R");
+  CHECK(changed);
+  CHECK_EQUAL(machine.state(), RUNNING);
+}
+
+void testUpdateAndTime() {
+  now_millis = 5000;
+  StateMachine machine(&TRANSITIONS[0][0], ACTIONS, EVENT_COUNT);
+  machine.begin(IDLE);
+  now_millis = 5250;
+  CHECK_EQUAL(machine.timeInState(), 250);
+
+  actions.clear();
+  machine.update();  // IDLE has no "during" action
+  CHECK(actions == "");
+
+  machine.handle(ARM);
+  CHECK_EQUAL(machine.timeInState(), 0);
+  actions.clear();
+  machine.update();
+  machine.update();
+  CHECK(actions == "~A~A");
+
+  // A machine with no actions table at all
+  StateMachine bare(&TRANSITIONS[0][0], NULL, EVENT_COUNT);
+  actions.clear();
+  bare.begin(IDLE);
+  CHECK(bare.handle(ARM));
+  bare.update();
+  CHECK(actions == "");
+  CHECK_EQUAL(bare.state(), ARMED);
+}
+
+void testHistory() {
+  now_micros = 1000;
+  StateMachine machine(&TRANSITIONS[0][0], ACTIONS, EVENT_COUNT);
+  machine.begin(IDLE);
+
+  arduino_shim::PrintedText empty;
+  machine.printHistory(empty);
+  CHECK(empty.text == "from,to,event,micros,us_in_from\r\n");
+
+  now_micros = 2000;
+  machine.handle(ARM);  // IDLE -> ARMED
+  now_micros = 2500;
+  machine.handle(STOP);  // ARMED -> IDLE, 500 us in ARMED
+  arduino_shim::PrintedText two;
+  machine.printHistory(two);
+  CHECK(two.text == "from,to,event,micros,us_in_from\r\n"
+                    "0,1,0,2000,\r\n"
+                    "1,0,2,2500,500\r\n");
+
+  // Only the last HISTORY_SIZE (8) are kept: 10 transitions, 100 us apart
+  StateMachine busy(&TRANSITIONS[0][0], ACTIONS, EVENT_COUNT);
+  busy.begin(IDLE);
+  for (int n = 0; n < 10; n++) {
+    now_micros = 10000 + n * 100;
+    busy.handle((n % 2 == 0) ? ARM : STOP);
+  }
+  arduino_shim::PrintedText full;
+  busy.printHistory(full);
+  CHECK(full.text == "from,to,event,micros,us_in_from\r\n"
+                     "0,1,0,10200,\r\n"
+                     "1,0,2,10300,100\r\n"
+                     "0,1,0,10400,100\r\n"
+                     "1,0,2,10500,100\r\n"
+                     "0,1,0,10600,100\r\n"
+                     "1,0,2,10700,100\r\n"
+                     "0,1,0,10800,100\r\n"
+                     "1,0,2,10900,100\r\n");
+
+  // Ignored events and guards that say no aren't recorded: only ARM is
+  const std::string LAST_LINE = "0,1,0,20000,9100\r\n";
+  start_allowed = false;
+  now_micros = 20000;
+  busy.handle(STOP);
+  busy.handle(ARM);
+  busy.handle(START);
+  arduino_shim::PrintedText after_ignored;
+  busy.printHistory(after_ignored);
+  CHECK(after_ignored.text.substr(after_ignored.text.size() - LAST_LINE.size()) == LAST_LINE);
+  CHECK(after_ignored.text.find("10200") == std::string::npos);  // the oldest was dropped
+}
+
+}  // namespace
+
+int main() {
+  testTransitions();
+  testGuard();
+  testUpdateAndTime();
+  testHistory();
+  return checkResults("test_state_machine");
+}
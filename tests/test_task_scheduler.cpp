@@ -0,0 +1,244 @@
+/*
+ * test_task_scheduler.cpp
+ *
+ * Checks TaskScheduler from task_scheduler.h: tasks due together run in task
+ * number order, periodic tasks stay on their schedule when a little late, a
+ * task that missed a whole period counts an overrun and starts again from
+ * then, one-shot tasks run once and free their task number, and setPeriod()
+ * re-times a task from when it last ran.
+ */
+
+#include "Arduino.h"
+#include "task_scheduler.h"
+#include "check.h"
+
+namespace {
+
+using arduino_shim::now_millis;
+
+// Each task adds its letter, so "ran" shows which tasks ran and in what order.
+std::string ran;
+
+void taskA() {
+  ran += 'A';
+}
+
+void taskB() {
+  ran += 'B';
+}
+
+void taskC() {
+  ran += 'C';
+}
+
+// Takes 250 us, for the run time statistics
+void slowTask() {
+  ran += 'S';
+  arduino_shim::now_micros += 250;
+}
+
+// Run the scheduler at "now" and return the letters of the tasks that ran.
+std::string runAt(TaskScheduler &scheduler, unsigned long now) {
+  now_millis = now;
+  ran.clear();
+  scheduler.run();
+  return ran;
+}
+
+// The statistics line printStats() shows for "task".
+std::string statsLine(const TaskScheduler &scheduler, byte task) {
+  arduino_shim::PrintedText printed;
+  scheduler.printStats(printed);
+  size_t start = 0;
+  for (int line = 0; line < task + 1; line++) {  // skip the heading
+    start = printed.text.find("\r\n", start) + 2;
+  }
+  return printed.text.substr(start, printed.text.find("\r\n", start) - start);
+}
+
+void testOrder() {
+  now_millis = 1000;
+  TaskScheduler scheduler;
+  CHECK_EQUAL(scheduler.every(100, taskC), 0);
+  CHECK_EQUAL(scheduler.every(100, taskA), 1);
+  CHECK_EQUAL(scheduler.every(50, taskB), 2);
+
+  // All due straight away, then each on its own period, in task number order
+  CHECK(runAt(scheduler, 1000) == "CAB");
+  CHECK(runAt(scheduler, 1049) == "");
+  CHECK(runAt(scheduler, 1050) == "B");
+  CHECK(runAt(scheduler, 1100) == "CAB");
+  CHECK_EQUAL(scheduler.run(), 0);
+}
+
+void testStaysOnSchedule() {
+  now_millis = 0;
+  TaskScheduler scheduler;
+  byte task = scheduler.every(100, taskA);
+  CHECK(runAt(scheduler, 0) == "A");
+  CHECK(runAt(scheduler, 130) == "A");  // 30 ms late...
+  CHECK(runAt(scheduler, 199) == "");   // ...but still due at 200, not 230
+  CHECK(runAt(scheduler, 200) == "A");
+  CHECK(runAt(scheduler, 399) == "A");  // 99 ms late is not an overrun
+  CHECK(statsLine(scheduler, task) == "0,,4,0,0,0");
+
+  // millis() wrapping round to 0 doesn't upset it
+  const unsigned long LAST_MILLIS = (unsigned long)-1;
+  TaskScheduler wrapping;
+  now_millis = LAST_MILLIS - 49;
+  wrapping.every(100, taskA);
+  CHECK(runAt(wrapping, LAST_MILLIS - 49) == "A");
+  CHECK(runAt(wrapping, LAST_MILLIS) == "");
+  CHECK(runAt(wrapping, 49) == "");
+  CHECK(runAt(wrapping, 50) == "A");
+}
+
+void testOverrun() {
+  now_millis = 0;
+  TaskScheduler scheduler;
+  byte task = scheduler.every(100, taskA);
+  runAt(scheduler, 0);
+  runAt(scheduler, 100);
+
+  // Due at 200 but not run until 450: one overrun, and the schedule starts
+  // again from 450 instead of running 3 times to catch up
+  CHECK(runAt(scheduler, 450) == "A");
+  CHECK(runAt(scheduler, 451) == "");
+  CHECK(runAt(scheduler, 549) == "");
+  CHECK(runAt(scheduler, 550) == "A");
+  CHECK(statsLine(scheduler, task) == "0,,4,0,0,1");
+
+  // Exactly one period late is an overrun too
+  CHECK(runAt(scheduler, 750) == "A");
+  CHECK(statsLine(scheduler, task) == "0,,5,0,0,2");
+  CHECK(runAt(scheduler, 849) == "");
+  CHECK(runAt(scheduler, 850) == "A");
+}
+
+void testOneShots() {
+  now_millis = 0;
+  TaskScheduler scheduler;
+  byte periodic = scheduler.every(100, taskA);
+  byte once = scheduler.after(250, taskB);
+  CHECK_EQUAL(once, 1);
+  CHECK(scheduler.isActive(once));
+
+  CHECK(runAt(scheduler, 0) == "A");
+  CHECK(runAt(scheduler, 100) == "A");
+  CHECK(runAt(scheduler, 200) == "A");
+  CHECK(runAt(scheduler, 249) == "");
+  CHECK(runAt(scheduler, 250) == "B");
+  CHECK(!scheduler.isActive(once));
+  CHECK(runAt(scheduler, 300) == "A");  // B doesn't run again
+
+  // Its task number is free again, and the next task added takes it
+  byte replacement = scheduler.after(10, taskC);
+  CHECK_EQUAL(replacement, once);
+  CHECK(runAt(scheduler, 310) == "C");
+
+  // A cancelled task never runs, and its number is free too
+  byte cancelled = scheduler.after(10, taskB);
+  scheduler.cancel(cancelled);
+  CHECK(!scheduler.isActive(cancelled));
+  CHECK(runAt(scheduler, 400) == "A");
+  CHECK_EQUAL(scheduler.every(100, taskB), cancelled);
+  CHECK(scheduler.isActive(periodic));
+}
+
+void testFull() {
+  now_millis = 0;
+  TaskScheduler scheduler;
+  for (byte task = 0; task < TaskScheduler::MAX_TASKS; task++) {
+    CHECK_EQUAL(scheduler.every(100, taskA), task);
+  }
+  CHECK_EQUAL(scheduler.every(100, taskB), TaskScheduler::NO_TASK);
+  CHECK_EQUAL(scheduler.after(100, taskB), TaskScheduler::NO_TASK);
+  CHECK(!scheduler.isActive(TaskScheduler::NO_TASK));
+  CHECK_EQUAL(scheduler.run(), TaskScheduler::MAX_TASKS);
+}
+
+void testSetPeriod() {
+  now_millis = 0;
+  TaskScheduler scheduler;
+  byte task = scheduler.every(100, taskA);
+  runAt(scheduler, 0);  // next due at 100
+
+  // Shorter: due 50 ms after it last ran
+  now_millis = 30;
+  scheduler.setPeriod(task, 50);
+  CHECK(runAt(scheduler, 49) == "");
+  CHECK(runAt(scheduler, 50) == "A");
+
+  // Longer: due 200 ms after it last ran (at 50)
+  now_millis = 60;
+  scheduler.setPeriod(task, 200);
+  CHECK(runAt(scheduler, 249) == "");
+  CHECK(runAt(scheduler, 250) == "A");
+
+  // The same period again changes nothing
+  now_millis = 300;
+  scheduler.setPeriod(task, 200);
+  CHECK(runAt(scheduler, 449) == "");
+  CHECK(runAt(scheduler, 450) == "A");
+
+  // Shorter when that time has already passed: due straight away, not an overrun
+  now_millis = 600;
+  scheduler.setPeriod(task, 100);
+  CHECK(runAt(scheduler, 600) == "A");
+  CHECK(runAt(scheduler, 699) == "");
+  CHECK(runAt(scheduler, 700) == "A");
+  CHECK(statsLine(scheduler, task) == "0,,6,0,0,0");
+
+  // One-shot tasks and a period of 0 are ignored
+  byte once = scheduler.after(100, taskB);  // due at 800
+  scheduler.setPeriod(once, 10);
+  scheduler.setPeriod(task, 0);
+  CHECK(runAt(scheduler, 799) == "");
+  CHECK(runAt(scheduler, 800) == "AB");
+  CHECK(runAt(scheduler, 900) == "A");
+}
+
+void testRunNow() {
+  now_millis = 0;
+  TaskScheduler scheduler;
+  byte task = scheduler.every(100, taskA);
+  runAt(scheduler, 0);
+  now_millis = 40;
+  scheduler.runNow(task);
+  CHECK(runAt(scheduler, 40) == "A");
+  CHECK(runAt(scheduler, 139) == "");  // carries on from now
+  CHECK(runAt(scheduler, 140) == "A");
+}
+
+void testStats() {
+  now_millis = 0;
+  arduino_shim::now_micros = 0;
+  TaskScheduler scheduler;
+  scheduler.every(100, taskA, F("fast"));
+  byte slow = scheduler.every(100, slowTask, F("slow"));
+  runAt(scheduler, 0);
+  runAt(scheduler, 100);
+
+  arduino_shim::PrintedText printed;
+  scheduler.printStats(printed);
+  CHECK(printed.text == "task,name,runs,avg_us,max_us,overruns\r\n"
+                        "0,fast,2,0,0,0\r\n"
+                        "1,slow,2,250,250,0\r\n");
+
+  scheduler.clearStats();
+  CHECK(statsLine(scheduler, slow) == "1,slow,0,0,0,0");
+}
+
+}  // namespace
+
+int main() {
+  testOrder();
+  testStaysOnSchedule();
+  testOverrun();
+  testOneShots();
+  testFull();
+  testSetPeriod();
+  testRunNow();
+  testStats();
+  return checkResults("test_task_scheduler");
+}